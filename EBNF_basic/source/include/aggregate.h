@@ -0,0 +1,108 @@
+#ifndef _AGGREGATE_H_
+#define _AGGREGATE_H_
+
+#include <cstddef>     // std::size_t
+#include <cstdint>     // std::uint64_t
+#include <memory>      // std::unique_ptr
+#include <string>      // std::string
+#include <string_view> // std::string_view
+
+#include "parser.h"        // Parser::ResultType, Parser::required_int_type
+#include "bares_manager.h" // BaresManager::Result, BaresManager::Format
+
+/// Folds the results of many expressions into a few numbers, instead of writing them.
+/*!
+ * Every thread that evaluates expressions keeps its own accumulator and adds
+ * each result to it: a few additions and comparisons, no text and no output,
+ * nothing shared. When the input is over the accumulators are merged (in any
+ * order, the summary does not depend on it) and the summary is written once.
+ *
+ * Which parts are kept is chosen with Part flags:
+ * - SUM: how many lines gave a value, their sum and mean;
+ * - MINMAX: the smallest and the largest value;
+ * - ERRORS: how many lines ended with each result code (OK included);
+ * - HISTOGRAM: how many times each value came out.
+ *
+ * Only the lines that evaluate to a value (OK) take part in the sum, the
+ * extremes and the histogram. A value fits in 16 bits, so the sum is kept in
+ * 128 bits and cannot overflow; the histogram has one exact counter per
+ * possible value (it is only allocated when asked for).
+ */
+class alignas( 64 ) Aggregate { // One per thread: keep them on different cache lines.
+    public:
+        /// The parts of the summary, to be combined with "|".
+        enum Part : unsigned {
+            SUM       = 1u << 0, //!< Count, sum and mean of the values.
+            MINMAX    = 1u << 1, //!< Smallest and largest value.
+            ERRORS    = 1u << 2, //!< Number of lines of each result code.
+            HISTOGRAM = 1u << 3, //!< Number of times each value came out.
+            ALL       = SUM | MINMAX | ERRORS | HISTOGRAM
+        };
+
+        __extension__ typedef __int128 sum_type; //!< Wide enough for any number of 16-bit values.
+
+        /**
+         * @brief Creates an empty accumulator.
+         * @param parts the Part flags of what to keep.
+         */
+        explicit Aggregate( unsigned parts = 0 );
+
+        Aggregate( const Aggregate & other );
+        Aggregate & operator=( const Aggregate & other );
+
+        /// Adds the result of one expression.
+        void add( const BaresManager::Result & res ) {
+            m_lines++;
+            m_codes[res.status.type]++;
+            if ( res.status.type != Parser::ResultType::OK ) return;
+            m_sum += res.value;
+            if ( res.value < m_min ) m_min = res.value;
+            if ( res.value > m_max ) m_max = res.value;
+            if ( m_histogram ) m_histogram[bin( res.value )]++;
+        }
+
+        /// Adds what another accumulator has seen.
+        void merge( const Aggregate & other );
+
+        /**
+         * @brief Appends the summary.
+         * @param out receives the text.
+         * @param format TEXT (or CARET) for one "name: value" line per number, JSON for one object.
+         */
+        void append_summary( std::string & out, BaresManager::Format format = BaresManager::Format::TEXT ) const;
+
+        /**
+         * @brief Reads a comma separated list of parts, such as "sum,errors" or "all".
+         * @param list the list.
+         * @param parts receives the Part flags.
+         * @return false if a name is not known.
+         */
+        static bool parse_parts( std::string_view list, unsigned & parts );
+
+        /// The Part flags of what is kept.
+        unsigned parts( void ) const { return m_parts; }
+        /// The number of results added.
+        std::uint64_t lines( void ) const { return m_lines; }
+        /// The number of results with a given code.
+        std::uint64_t count( Parser::ResultType::code_t code ) const { return m_codes[code]; }
+        /// The sum of the values.
+        sum_type sum( void ) const { return m_sum; }
+
+    private:
+        using value_type = Parser::required_int_type;
+        static constexpr std::size_t N_CODES = Parser::ResultType::NESTING_TOO_DEEP + 1; //!< Number of result codes.
+        static constexpr std::size_t N_BINS = 1u << 16;                                  //!< One bin per 16-bit value.
+
+        /// The bin of a value in the histogram.
+        static std::size_t bin( value_type value ) { return static_cast< std::uint16_t >( value ); }
+
+        unsigned m_parts;                                //!< What the summary shows.
+        std::uint64_t m_lines {0};                       //!< Results added.
+        std::uint64_t m_codes[N_CODES] {};               //!< Results of each code.
+        sum_type m_sum {0};                              //!< Sum of the values.
+        value_type m_min;                                //!< Smallest value, the largest possible one if none.
+        value_type m_max;                                //!< Largest value, the smallest possible one if none.
+        std::unique_ptr< std::uint64_t[] > m_histogram;  //!< Counter of each value, by bin(), when kept.
+};
+
+#endif
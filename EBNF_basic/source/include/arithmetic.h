@@ -0,0 +1,150 @@
+#ifndef _ARITHMETIC_H_
+#define _ARITHMETIC_H_
+
+#include <cstdint> // std::uint64_t
+
+#include "parser.h" // Parser::input_int_type
+
+/// Operations shared by every way of evaluating a BARES expression.
+namespace bares {
+
+    using value_type = Parser::input_int_type; //!< The type the expressions are computed with.
+
+    /**
+     * @brief Gets the precedence of a binary operator.
+     * @param op the operator.
+     * @return 3 for "^", 2 for "*", "/" and "%", 1 for "+" and "-" and -1 for anything else.
+     */
+    constexpr int precedence( char op ) {
+        switch ( op ) {
+            case '^': return 3;
+            case '*':
+            case '/':
+            case '%': return 2;
+            case '+':
+            case '-': return 1;
+        }
+        return -1;
+    }
+
+    /**
+     * @brief Applies a binary operator.
+     *
+     * Results wrap around like two's complement integers (only the final value
+     * of an expression is checked against the range of the required type).
+     * A negative exponent gives 0 and anything to the 0 gives 1.
+     *
+     * @param op the operator.
+     * @param lhs the left operand.
+     * @param rhs the right operand.
+     * @param result receives the result; it is left untouched on a division by zero.
+     * @return false if it was a division (or remainder) by zero; true otherwise.
+     */
+    constexpr bool apply_operator( char op, value_type lhs, value_type rhs, value_type & result ) {
+        using unsigned_type = unsigned long long;
+        const auto a = static_cast< unsigned_type >( lhs );
+        const auto b = static_cast< unsigned_type >( rhs );
+        switch ( op ) {
+            case '+': result = static_cast< value_type >( a + b ); break;
+            case '-': result = static_cast< value_type >( a - b ); break;
+            case '*': result = static_cast< value_type >( a * b ); break;
+            case '/':
+                if ( rhs == 0 ) return false;
+                // The only quotient that does not fit: the smallest value divided by -1.
+                result = rhs == -1 ? static_cast< value_type >( 0 - a ) : lhs / rhs;
+                break;
+            case '%':
+                if ( rhs == 0 ) return false;
+                result = rhs == -1 ? 0 : lhs % rhs;
+                break;
+            case '^':
+                if ( rhs == 0 ) result = 1;
+                else if ( rhs < 0 ) result = 0;
+                else {
+                    // Exponentiation by squaring, the same value as multiplying rhs times.
+                    unsigned_type base { a }, power { 1 };
+                    for ( auto e = b; e != 0; e >>= 1 ) {
+                        if ( e & 1 ) power *= base;
+                        base *= base;
+                    }
+                    result = static_cast< value_type >( power );
+                }
+                break;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Gets the high half of the 128-bit product of two values.
+     * @param a the first factor.
+     * @param b the second factor.
+     * @return the 64 upper bits of a * b.
+     */
+    inline value_type mul_high( value_type a, value_type b ) {
+#ifdef __SIZEOF_INT128__
+        __extension__ typedef __int128 wide_type;
+        return static_cast< value_type >( ( static_cast< wide_type >( a ) * b ) >> 64 );
+#else
+        // Unsigned product from 32-bit halves, then corrected for the signs.
+        const auto ua = static_cast< std::uint64_t >( a ), ub = static_cast< std::uint64_t >( b );
+        const std::uint64_t a_lo = ua & 0xFFFFFFFF, a_hi = ua >> 32, b_lo = ub & 0xFFFFFFFF, b_hi = ub >> 32;
+        const std::uint64_t lo_lo = a_lo * b_lo, hi_lo = a_hi * b_lo, lo_hi = a_lo * b_hi, hi_hi = a_hi * b_hi;
+        const std::uint64_t mid = ( lo_lo >> 32 ) + ( hi_lo & 0xFFFFFFFF ) + lo_hi;
+        std::uint64_t high = hi_hi + ( hi_lo >> 32 ) + ( mid >> 32 );
+        if ( a < 0 ) high -= ub;
+        if ( b < 0 ) high -= ua;
+        return static_cast< value_type >( high );
+#endif
+    }
+
+    /// A multiplier and a shift that replace a division by a constant.
+    struct magic_divisor {
+        value_type multiplier; //!< The (signed) magic number.
+        unsigned shift;        //!< How much to shift the high half of the product.
+    };
+
+    /**
+     * @brief Finds the magic number of a divisor (Hacker's Delight, section 10-4).
+     * @param d the divisor, which must not be -1, 0 or 1.
+     * @return the multiplier and the shift to use with divide_magic().
+     */
+    inline magic_divisor compute_magic( value_type d ) {
+        const std::uint64_t two63 { std::uint64_t{1} << 63 };
+        const std::uint64_t ad = d < 0 ? 0 - static_cast< std::uint64_t >( d ) : static_cast< std::uint64_t >( d );
+        const std::uint64_t t = two63 + ( static_cast< std::uint64_t >( d ) >> 63 );
+        const std::uint64_t anc = t - 1 - t % ad; // Absolute value of nc.
+        unsigned p { 63 };
+        std::uint64_t q1 = two63 / anc, r1 = two63 - q1 * anc; // 2^p / |nc| and its remainder.
+        std::uint64_t q2 = two63 / ad, r2 = two63 - q2 * ad;   // 2^p / |d| and its remainder.
+        std::uint64_t delta;
+        do {
+            p++;
+            q1 *= 2; r1 *= 2;
+            if ( r1 >= anc ) { q1++; r1 -= anc; }
+            q2 *= 2; r2 *= 2;
+            if ( r2 >= ad ) { q2++; r2 -= ad; }
+            delta = ad - r2;
+        } while ( q1 < delta or ( q1 == delta and r1 == 0 ) );
+        auto m = static_cast< value_type >( q2 + 1 );
+        if ( d < 0 ) m = static_cast< value_type >( 0 - ( q2 + 1 ) );
+        return magic_divisor{ m, p - 64 };
+    }
+
+    /**
+     * @brief Divides by a constant with a multiplication and shifts, the same quotient as n / d.
+     * @param n the dividend.
+     * @param d the divisor (not -1, 0 or 1).
+     * @param magic what compute_magic() gave for d.
+     * @return the quotient, truncated toward zero.
+     */
+    inline value_type divide_magic( value_type n, value_type d, const magic_divisor & magic ) {
+        value_type q = mul_high( magic.multiplier, n );
+        if ( d > 0 and magic.multiplier < 0 ) q = static_cast< value_type >( static_cast< std::uint64_t >( q ) + static_cast< std::uint64_t >( n ) );
+        else if ( d < 0 and magic.multiplier > 0 ) q = static_cast< value_type >( static_cast< std::uint64_t >( q ) - static_cast< std::uint64_t >( n ) );
+        q >>= magic.shift;
+        return q + static_cast< value_type >( static_cast< std::uint64_t >( q ) >> 63 );
+    }
+
+} // namespace bares.
+
+#endif
@@ -0,0 +1,124 @@
+#ifndef _AST_H_
+#define _AST_H_
+
+#include <cstddef> // std::size_t
+#include <cstdint> // std::uint32_t, std::uint64_t
+#include <vector>  // std::vector
+
+#include "../lib/vector.h"  // class vector
+#include "../lib/stack.h"   // class stack
+#include "token_buffer.h"   // class TokenBuffer
+#include "bares_manager.h"  // BaresManager::Result
+
+/// The syntax tree of an expression, its nodes packed in one array.
+/*!
+ * Nodes are not allocated one by one and linked by pointers: they are appended
+ * to an arena (a single sc::vector) and refer to their operands by 32-bit
+ * indices. A node takes 24 bytes, the whole tree is one allocation, and the
+ * tree can be copied, kept or thrown away at once.
+ *
+ * The tree is built from the infix tokens of Parser (see Parser::build_ast()),
+ * so nodes are created in postfix order: the operands of a node always come
+ * before it. Evaluating the arena from the first node to the last is then the
+ * same as running the postfix list, each node reading the values its operands
+ * left in the arena.
+ *
+ * When sharing is on, a node equal to one already in the arena (same literal,
+ * or same operator on the same operands) is not created again: a hash table
+ * finds it and the existing index is used instead. Repeated subexpressions are
+ * then computed only once, and the tree becomes a DAG.
+ *
+ * The nodes created for a subtree take a contiguous range of the arena. A
+ * shared node is hoisted: it is computed (with what is below it) before any
+ * thread starts. A subtree whose operations read nothing outside its range,
+ * literals and hoisted nodes aside, is independent: evaluate() can give the
+ * biggest of them to other threads, then finish the nodes above them. Passes
+ * that rewrite the expression can work on the same arena.
+ *
+ * The results are those of BaresManager::evaluate(). A division by zero takes
+ * the result of the previous operation in postfix order, which is the previous
+ * node of the arena only when nothing is shared and everything runs on one
+ * thread; otherwise the tree is run again the slow way, in the order of the
+ * postfix list, when a division by zero happens.
+ */
+class Ast {
+    public:
+        using index_type = std::uint32_t;   //!< Position of a node in the arena.
+        using value_type = Parser::input_int_type; //!< A literal, or the result of an operation.
+
+        /// Index of no node.
+        static constexpr index_type NONE = ~index_type{0};
+
+        /// A node of the tree: a literal or a binary operation.
+        struct Node {
+            value_type value;  //!< The literal of a leaf; the result of an operation, once evaluated.
+            index_type lhs;    //!< Left operand, NONE for a leaf.
+            index_type rhs;    //!< Right operand, NONE for a leaf.
+            index_type first;  //!< First node created for this subtree; they all lie in [first, this node].
+            char op;           //!< The operator, 0 for a leaf.
+            bool independent;  //!< Whether the operations of the subtree only read nodes of its range (or hoisted).
+            bool hoisted;      //!< Whether the node is read from outside its subtree (or is below such a node).
+        };
+
+        /**
+         * @brief Builds the tree of an expression, forgetting the previous one.
+         * @param infix the tokens of a valid expression, as the parser leaves them.
+         * @param share whether equal subexpressions become a single node.
+         */
+        void build( const TokenBuffer & infix, bool share = true );
+
+        /**
+         * @brief Computes the expression.
+         * @param threads how many threads may compute independent subtrees at the same time.
+         * @param min_task subtrees with fewer nodes are not worth a thread.
+         * @return the same result BaresManager::evaluate() gives for the expression.
+         */
+        BaresManager::Result evaluate( std::size_t threads = 1, std::size_t min_task = 1u << 14 );
+
+        /// The number of nodes in the arena.
+        std::size_t size( void ) const { return m_nodes.size(); }
+        /// The number of nodes the tree would have without sharing (operands and operators of the expression).
+        std::size_t terms( void ) const { return m_terms; }
+        /// The root of the tree, NONE if there is none.
+        index_type root( void ) const { return m_root; }
+        /// The node at position `i` of the arena.
+        const Node & node( index_type i ) const { return m_nodes[i]; }
+
+        /// The bytes the tree takes: its nodes and the slots of the hash table.
+        std::size_t memory( void ) const {
+            return m_nodes.size() * sizeof( Node ) + m_table.size() * sizeof( index_type );
+        }
+        /// The bytes taken per node of the arena.
+        double bytes_per_node( void ) const {
+            return m_nodes.empty() ? 0.0 : static_cast< double >( memory() ) / static_cast< double >( m_nodes.size() );
+        }
+
+    private:
+        /// An operand while the tree is built: its node and where its newly created nodes start.
+        struct Operand {
+            index_type node;   //!< The node.
+            index_type first;  //!< Size of the arena when the operand started.
+        };
+
+        sc::vector< Node > m_nodes;         //!< The arena.
+        sc::vector< index_type > m_table;   //!< Open addressing hash table of the nodes, when sharing.
+        sta::stack< char > m_operators;     //!< Operators and "(" while building.
+        sta::stack< Operand > m_operands;   //!< Operands while building.
+        sta::stack< std::uint64_t > m_work; //!< Nodes to visit when hoisting, or in postfix order (index times 2, plus 1 once the operands are done).
+        sta::stack< value_type > m_values;  //!< Values while running in postfix order.
+        std::vector< index_type > m_tasks;  //!< Roots of the subtrees given to threads.
+        std::vector< index_type > m_hoisted; //!< The hoisted nodes, in arena order.
+        index_type m_root {NONE};           //!< The root of the tree.
+        std::size_t m_terms {0};            //!< Nodes before sharing.
+
+        index_type add( const Node & node );          // Appends a node, or finds an equal one.
+        void hoist( index_type i );                   // Marks a shared node and its subtree.
+        void reduce( void );                          // Builds the node of the operator on top.
+        bool run( std::size_t lo, std::size_t hi, value_type & last, bool skip_hoisted ); // Evaluates a range of the arena.
+        value_type run_postfix( bool & division_by_zero ); // Evaluates node by node in postfix order.
+        void pick_tasks( std::size_t threads, std::size_t min_task ); // Chooses the subtrees for threads.
+        /// The number of nodes created for the subtree of node `i`.
+        std::size_t weight( index_type i ) const { return i - m_nodes[i].first + 1; }
+};
+
+#endif
@@ -0,0 +1,115 @@
+#ifndef _ASYNC_EVALUATOR_H_
+#define _ASYNC_EVALUATOR_H_
+
+#include <coroutine> // std::coroutine_handle
+#include <cstddef>   // std::size_t
+#include <string>    // std::string
+#include <vector>    // std::vector
+
+#include "bares_manager.h" // class BaresManager
+#include "parser.h"        // Parser::DEFAULT_MAX_DEPTH
+
+/// Evaluates the expressions of many coroutines together, in batches.
+/*!
+ * A coroutine that awaits evaluate() is suspended and its expression joins the
+ * batch being gathered; nothing runs and no thread waits for it. The batch is
+ * evaluated in one pass, by a single BaresManager whose stacks are already
+ * warm, either when it is full (by the coroutine that fills it, which goes on
+ * without being suspended) or when the executor calls flush(). Then each
+ * coroutine of the batch is resumed, in order, with its result.
+ *
+ * The coroutines resumed by a batch may await again: their expressions go to
+ * the next batch, which is only evaluated once the current one is over, so
+ * the stack never grows with the number of batches.
+ *
+ * A BatchEvaluator is not thread-safe: it belongs to the thread of one
+ * executor, which resumes the coroutines. A coroutine must not be destroyed
+ * while it waits for its result.
+ */
+class BatchEvaluator {
+    public:
+        /// What a coroutine awaits: the result of its expression.
+        class Awaiter {
+            public:
+                /// Always suspends, unless the batch is evaluated right away (see await_suspend()).
+                bool await_ready( void ) const noexcept { return false; }
+                /// Joins the batch; false when the coroutine filled it and already has its result.
+                bool await_suspend( std::coroutine_handle<> waiting ) { return m_owner->enqueue( this, waiting ); }
+                /// The result of the expression.
+                BaresManager::Result await_resume( void ) const noexcept { return m_result; }
+
+            private:
+                friend class BatchEvaluator;
+                Awaiter( BatchEvaluator & owner, std::string expr ) : m_owner{ &owner }, m_expr{ std::move( expr ) } { /* empty */ }
+
+                BatchEvaluator * m_owner;          //!< Who evaluates it.
+                std::string m_expr;                //!< The expression.
+                std::coroutine_handle<> m_waiting; //!< The coroutine to resume.
+                BaresManager::Result m_result { Parser::ResultType{ Parser::ResultType::OK }, 0 }; //!< Its result.
+        };
+
+        /**
+         * @brief Creates an evaluator.
+         * @param batch_size a batch is evaluated as soon as it has this many expressions.
+         * @param max_depth how many parentheses may be open at the same time in an expression.
+         */
+        explicit BatchEvaluator( std::size_t batch_size = 64, std::size_t max_depth = Parser::DEFAULT_MAX_DEPTH );
+
+        /// Turn off copy constructor.
+        BatchEvaluator( const BatchEvaluator & ) = delete;
+        /// Turn off assignment operator.
+        BatchEvaluator & operator=( const BatchEvaluator & ) = delete;
+
+        /**
+         * @brief Evaluates an expression in the next batch: `co_await evaluator.evaluate( expr )`.
+         * @param expr the expression.
+         * @return what to await, which gives the same result as BaresManager::evaluate(expr).
+         */
+        Awaiter evaluate( std::string expr ) { return Awaiter{ *this, std::move( expr ) }; }
+
+        /**
+         * @brief Evaluates the expressions waiting, and those the resumed coroutines add, until there are none.
+         * @return how many coroutines were resumed.
+         */
+        std::size_t flush( void );
+
+        /// How many coroutines wait for a batch.
+        std::size_t pending( void ) const { return m_pending.size(); }
+        /// How many batches were evaluated.
+        std::size_t batches( void ) const { return m_batches; }
+
+        /// The evaluator of the calling thread, used by bares::evaluate_async().
+        static BatchEvaluator & local( void );
+
+    private:
+        std::size_t m_batch_size;          //!< Expressions that make a full batch.
+        BaresManager m_bm;                 //!< Evaluates every batch.
+        std::vector< Awaiter * > m_pending; //!< The batch being gathered.
+        std::vector< Awaiter * > m_batch;  //!< The batch being evaluated.
+        bool m_running {false};            //!< Whether a batch is being evaluated (or its coroutines resumed).
+        std::size_t m_batches {0};         //!< The number of batches.
+
+        bool enqueue( Awaiter * awaiter, std::coroutine_handle<> waiting ); // Adds an expression to the batch.
+        std::size_t run_batch( const Awaiter * current ); // Evaluates the batch and resumes its coroutines but one.
+};
+
+namespace bares {
+    /**
+     * @brief Evaluates an expression in the next batch of the evaluator of this thread.
+     * `BaresManager::Result res = co_await bares::evaluate_async( expr );`
+     * @param expr the expression.
+     * @return what to await, see BatchEvaluator::evaluate().
+     */
+    inline BatchEvaluator::Awaiter evaluate_async( std::string expr ) {
+        return BatchEvaluator::local().evaluate( std::move( expr ) );
+    }
+
+    /**
+     * @brief Evaluates what waits in the evaluator of this thread, see BatchEvaluator::flush().
+     * An executor calls it when it has nothing else to run.
+     * @return how many coroutines were resumed.
+     */
+    inline std::size_t flush_async( void ) { return BatchEvaluator::local().flush(); }
+} // namespace bares.
+
+#endif
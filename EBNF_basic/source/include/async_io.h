@@ -0,0 +1,128 @@
+#ifndef _ASYNC_IO_H_
+#define _ASYNC_IO_H_
+
+#include <cstddef>     // std::size_t
+#include <cstdint>     // std::uint64_t
+#include <memory>      // std::unique_ptr
+#include <string_view> // std::string_view
+
+#include "../lib/vector.h" // class vector
+
+/// Which system calls move the bytes of the input and of the output.
+enum class IoBackend {
+    AUTO,  //!< io_uring when the kernel allows it, read()/write() otherwise.
+    URING, //!< io_uring; falls back to read()/write() (with a warning) when it is not available.
+    SYNC   //!< Plain blocking read()/write().
+};
+
+class Uring; // The io_uring instance, only known inside async_io.cpp.
+
+/// Reads a file descriptor in big chunks, ahead of the consumer.
+/*!
+ * With io_uring the reads go straight into a few fixed buffers registered with
+ * the kernel (triple buffering by default): while the program works on one
+ * chunk, the next ones are already being filled, so it only waits when the
+ * device really is slower than the evaluation.
+ * Without io_uring the same interface is served by blocking read() calls.
+ */
+class AsyncInput {
+    public:
+        /**
+         * @brief Prepares to read a file descriptor (which is not closed by this class).
+         * @param fd where to read from.
+         * @param backend which system calls to use.
+         * @param buffer_size size of each buffer.
+         * @param n_buffers number of buffers (at least 2).
+         */
+        explicit AsyncInput( int fd, IoBackend backend = IoBackend::AUTO,
+                             std::size_t buffer_size = 1u << 18, std::size_t n_buffers = 3 );
+        /// Waits for the reads still in flight.
+        ~AsyncInput();
+        /// Turn off copy constructor.
+        AsyncInput( const AsyncInput & ) = delete;
+        /// Turn off assignment operator.
+        AsyncInput & operator=( const AsyncInput & ) = delete;
+
+        /**
+         * @brief Gets the next piece of the input.
+         * @return the bytes read, empty at the end of the input. They stay valid until the next call.
+         */
+        std::string_view next_chunk( void );
+
+        /// Tells whether io_uring is being used.
+        bool uses_uring( void ) const { return m_ring != nullptr; }
+
+    private:
+        int m_fd;                          //!< The file descriptor.
+        std::size_t m_buffer_size;         //!< Size of each buffer.
+        std::size_t m_n_buffers;           //!< Number of buffers.
+        char * m_memory;                   //!< All buffers, one after the other.
+        std::unique_ptr< Uring > m_ring;   //!< The io_uring instance, null when using read().
+        bool m_seekable;                   //!< Whether reads may be issued at explicit offsets.
+        std::uint64_t m_offset;            //!< Offset of the next read to issue.
+        sc::vector< int > m_result;        //!< Result of the read of each buffer, -1 while in flight.
+        sc::vector< std::uint64_t > m_pos; //!< Offset read into each buffer.
+        std::size_t m_next;                //!< The buffer whose data comes next.
+        std::size_t m_issued;              //!< How many buffers have a read issued (or done) ahead of m_next.
+        bool m_held;                       //!< Whether the caller holds the m_next - 1 buffer.
+        bool m_eof;                        //!< Whether the end of the input was reached.
+
+        void issue( void );                // Issues reads into the free buffers.
+        void wait( std::size_t buffer );   // Waits until the read of a buffer completes.
+        void drain( void );                // Waits for all reads in flight.
+};
+
+/// Writes to a file descriptor in big chunks, without waiting for the device.
+/*!
+ * Bytes are gathered in a fixed buffer; a full buffer is handed to io_uring and
+ * the program goes on filling the next one. It only waits when it wants to reuse
+ * a buffer whose write has not finished yet.
+ * Without io_uring the buffers are written with blocking write() calls.
+ */
+class AsyncOutput {
+    public:
+        /**
+         * @brief Prepares to write to a file descriptor (which is not closed by this class).
+         * @param fd where to write to.
+         * @param backend which system calls to use.
+         * @param buffer_size size of each buffer.
+         * @param n_buffers number of buffers (at least 2).
+         */
+        explicit AsyncOutput( int fd, IoBackend backend = IoBackend::AUTO,
+                              std::size_t buffer_size = 1u << 18, std::size_t n_buffers = 3 );
+        /// Writes what is left and waits for all writes.
+        ~AsyncOutput();
+        /// Turn off copy constructor.
+        AsyncOutput( const AsyncOutput & ) = delete;
+        /// Turn off assignment operator.
+        AsyncOutput & operator=( const AsyncOutput & ) = delete;
+
+        /// Appends bytes to the output.
+        void write( const char * data, std::size_t size );
+        /// Appends a string to the output.
+        void write( std::string_view text ) { write( text.data(), text.size() ); }
+        /// Sends everything written so far and waits until the device got it.
+        void flush( void );
+
+        /// Tells whether io_uring is being used.
+        bool uses_uring( void ) const { return m_ring != nullptr; }
+
+    private:
+        int m_fd;                          //!< The file descriptor.
+        std::size_t m_buffer_size;         //!< Size of each buffer.
+        std::size_t m_n_buffers;           //!< Number of buffers.
+        char * m_memory;                   //!< All buffers, one after the other.
+        std::unique_ptr< Uring > m_ring;   //!< The io_uring instance, null when using write().
+        bool m_seekable;                   //!< Whether writes may be issued at explicit offsets.
+        std::uint64_t m_offset;            //!< Offset of the next write to issue.
+        sc::vector< int > m_pending;       //!< Bytes being written from each buffer, 0 when it is free.
+        sc::vector< std::uint64_t > m_pos; //!< Offset written from each buffer.
+        std::size_t m_current;             //!< The buffer being filled.
+        std::size_t m_used;                //!< Bytes already in the current buffer.
+
+        void submit( void );               // Sends the current buffer and moves on to the next one.
+        void wait( std::size_t buffer );   // Waits until the write of a buffer completes.
+        void write_all( const char * data, std::size_t size, std::uint64_t offset ); // Blocking write.
+};
+
+#endif
@@ -1,22 +1,143 @@
 #ifndef _BARESMANAGER_H_
 #define _BARESMANAGER_H_
 
+#include <string_view> // std::string_view
+
 #include "parser.h"
+#include "token_buffer.h" // class TokenBuffer
+#include "../lib/stack.h" // class stack
+
+class Program; // A compiled expression (program.h).
+class Ast;     // The syntax tree of an expression (ast.h).
 
 class BaresManager {
     public:
+        /**
+         * @brief Creates a manager.
+         * @param max_depth how many parentheses may be open at the same time in an expression.
+         */
+        explicit BaresManager( std::size_t max_depth = Parser::DEFAULT_MAX_DEPTH ) : max_depth{ max_depth } { /* empty */ }
+
+        /// The outcome of evaluating a single expression: a code, a column and a value, no text.
+        struct Result {
+            Parser::ResultType status;       //!< Whether the expression was evaluated or what went wrong.
+            Parser::required_int_type value; //!< The value of the expression, only meaningful when `status` is OK.
+        };
+
+        /// How the results are written. The text of a result is only made when it is written.
+        enum class Format {
+            TEXT,  //!< The value, or the message of the error.
+            CARET, //!< Like TEXT, plus the expression and a "^" under the column of a syntax error.
+            JSON,  //!< One object per line: {"status":"OK","value":40} or {"status":"MISSING_TERM","column":5}.
+            BINARY //!< Fixed-width columns, written in blocks by ColumnWriter (columns.h); one result alone is written as TEXT.
+        };
+
         /**
          * @brief Send to the standard output the proper error messages.
          * @param result what happened in the operation.
          * @param str the expression that was analyzed.
+         * @param format how to write the message.
          */
-        void print_error_msg( const Parser::ResultType & result, const std::string &str );
+        void print_error_msg( const Parser::ResultType & result, const std::string &str, Format format = Format::TEXT );
 
         /**
          * @brief Parse a line and compute a expression.
          * @param expr the expression that will be calculated.
+         * @param format how to write the result.
+         */
+        void parse_and_compute(std::string expr, Format format = Format::TEXT);
+
+        /**
+         * @brief Parse and compute an expression without writing anything.
+         * @param expr the expression that will be calculated.
+         * @return Result the status and the value of the expression.
          */
-        void parse_and_compute(std::string expr);
+        Result evaluate(const std::string & expr);
+
+        /**
+         * @brief Parse and compute an expression a LineScanner has already looked at.
+         * @param expr the expression that will be calculated.
+         * @param invalid column of its first byte outside the alphabet, or std::string::npos if none.
+         * @return Result the same that evaluate(expr) gives.
+         */
+        Result evaluate(const std::string & expr, std::size_t invalid);
+
+        /// The outcome of evaluating a piece of a longer expression.
+        struct Piece {
+            Parser::ResultType status;    //!< The result of parsing the piece, or DIVISION_BY_ZERO.
+            Parser::input_int_type value; //!< Its value, before any range check.
+            bool borrowed;                //!< Whether a division by zero put in a result computed outside a term of its own.
+        };
+
+        /**
+         * @brief Parse and compute a piece of a longer expression, see SplitEvaluator.
+         * A division by zero puts the result of the previous operation in place of
+         * the quotient. When there is no previous operation, or when it is a "+" or
+         * a "-" (maybe the one between two pieces), that result may not be the one
+         * the whole expression would have there: `borrowed` tells.
+         * @param expr the piece, which must be a valid expression on its own.
+         * @return Piece the status, the unchecked value and whether a result was borrowed.
+         */
+        Piece evaluate_piece(const std::string & expr);
+
+        /**
+         * @brief Parse an expression and compile it into a program, without computing it.
+         * @param expr the expression that will be compiled.
+         * @param program receives the program, when the expression is valid.
+         * @return Parser::ResultType the result of the parsing or, for a valid expression, the
+         * program's diagnostic (a division by a literal zero, with the column of the operator).
+         */
+        Parser::ResultType compile(const std::string & expr, Program & program);
+
+        /**
+         * @brief Parse an expression and build its syntax tree, without computing it.
+         * @param expr the expression.
+         * @param ast receives the tree, when the expression is valid.
+         * @param share whether equal subexpressions become a single node of the tree.
+         * @return Parser::ResultType the result of the parsing.
+         */
+        Parser::ResultType build_ast(const std::string & expr, Ast & ast, bool share = true);
+
+        /**
+         * @brief Parse an expression and give its tokens in postfix order, without computing it.
+         * @param expr the expression.
+         * @param out receives the postfix tokens, with their columns, when the expression is valid.
+         * @return Parser::ResultType the result of the parsing.
+         */
+        Parser::ResultType to_postfix(const std::string & expr, TokenBuffer & out);
+
+        /**
+         * @brief Append to a string the line the program prints for a result.
+         * @param res the result of an evaluation.
+         * @param out the string that receives the text, including the line break.
+         */
+        static void append_result( const Result & res, std::string & out );
+
+        /**
+         * @brief Append to a string the text of a result in a given format.
+         * @param res the result of an evaluation.
+         * @param out the string that receives the text, including the line break(s).
+         * @param format how to write it.
+         * @param expr the expression, only read by Format::CARET.
+         */
+        static void append_result( const Result & res, std::string & out, Format format, std::string_view expr = {} );
+
+        /**
+         * @brief The name of a result code, as Format::JSON writes it.
+         * @param code the code.
+         * @return its name in the enumeration, such as "MISSING_TERM".
+         */
+        static const char * code_name( Parser::ResultType::code_t code );
+
+        /**
+         * @brief Whether the column of a result points at something in the expression.
+         * @param code the code of the result.
+         * @return false for OK, DIVISION_BY_ZERO and OVERFLOW_ERROR, true for the syntax errors.
+         */
+        static constexpr bool has_column( Parser::ResultType::code_t code ) {
+            return code != Parser::ResultType::OK and code != Parser::ResultType::DIVISION_BY_ZERO
+                   and code != Parser::ResultType::OVERFLOW_ERROR;
+        }
 
         /**
          * @brief Function to analyze the precedence of operators.
@@ -27,6 +148,8 @@ class BaresManager {
 
         /**
          * @brief Convert infix expression to postfix expression.
+         * The operator stack is sized once from the depth the parser recorded, so
+         * this must follow a successful parse_and_tokenize() (as in evaluate()).
          * @see The implementation was inspired by the website:
          * https://www.geeksforgeeks.org/stack-set-2-infix-to-postfix/
          */
@@ -34,13 +157,23 @@ class BaresManager {
 
         /**
          * @brief Calculates the postfix expression.
+         * Like infix_to_postfix(), it relies on the depth the parser recorded.
          */
         void calculate(void);
         
     private:
+        /// Computes the postfix list, without the range check of calculate().
+        Parser::input_int_type run_postfix(bool & borrowed);
+
         Parser::ResultType status; //!< The status of the program, if has an error or no.
-        sc::vector<Token> tokens;   //!< The tokens used during the program.
+        TokenBuffer tokens;         //!< The tokens used during the program.
+        TokenBuffer postfix;        //!< Where infix_to_postfix() builds the list that replaces `tokens`.
         Parser::required_int_type final_value; //!< The final value of the expression that was calculated.
+        std::size_t max_depth; //!< How many parentheses may be open at the same time.
+        std::size_t operator_depth {0}; //!< Most operators and "(" infix_to_postfix() has on its stack (from the parser).
+        std::size_t operand_depth {0};  //!< Most values calculate() has on its stack (from the parser).
+        sta::stack<std::size_t> operators; //!< The stack of infix_to_postfix() (positions in `tokens`), kept from one expression to the next.
+        sta::stack<Parser::input_int_type> operands; //!< The stack of calculate(), kept from one expression to the next.
 };
 
 #endif
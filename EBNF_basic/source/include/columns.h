@@ -0,0 +1,147 @@
+#ifndef _COLUMNS_H_
+#define _COLUMNS_H_
+
+#include <cstddef> // std::size_t
+#include <cstdint> // std::uint8_t, std::uint32_t, std::uint64_t
+#include <string>  // std::string
+#include <vector>  // std::vector
+
+#include "parser.h"        // Parser::ResultType
+#include "bares_manager.h" // BaresManager::Result
+
+/// The results of many expressions as fixed-width binary columns.
+/*!
+ * Nothing is turned into text: a program that reads the file maps it in
+ * memory and finds each number at a known place. Every number is little-endian.
+ *
+ * The file starts with a header of 64 bytes:
+ * | offset | size | field                                         |
+ * |--------|------|-----------------------------------------------|
+ * | 0      | 8    | magic, "BARESCOL"                             |
+ * | 8      | 4    | version, 1                                    |
+ * | 12     | 4    | size of this header, 64                       |
+ * | 16     | 4    | bytes of a value, 2 (Parser::required_int_type) |
+ *
+ * Blocks follow, each one made of the results of consecutive lines:
+ * | offset       | size         | field                                      |
+ * |--------------|--------------|--------------------------------------------|
+ * | 0            | 8            | size of the whole block, padding included  |
+ * | 8            | 4            | `rows`, the number of lines                |
+ * | 12           | 4            | `errors`, lines with a column (see below)  |
+ * | 16           | 4            | offset of the values, from the block start |
+ * | 20           | 4            | offset of the codes                        |
+ * | 24           | 4            | offset of the columns                      |
+ * | values       | 2 * rows     | int16, the value of each line (0 if none)  |
+ * | codes        | rows         | uint8, the Parser::ResultType::code_t      |
+ * | columns      | 4 * errors   | uint32, the column (from 0) of each syntax error, in line order |
+ *
+ * Only the syntax errors have a column (BaresManager::has_column()); the k-th
+ * of them in the codes takes the k-th column. The header of a block takes
+ * 64 bytes, and every block and every column starts at a multiple of 64 bytes
+ * (zero padded), so each column is aligned for its type once the file is mapped.
+ */
+namespace columns {
+    constexpr char MAGIC[8] = { 'B', 'A', 'R', 'E', 'S', 'C', 'O', 'L' }; //!< The first bytes of the file.
+    constexpr std::uint32_t VERSION = 1;      //!< The version of the layout.
+    constexpr std::size_t HEADER_SIZE = 64;   //!< Bytes of the file header, and of the header of a block.
+    constexpr std::size_t ALIGNMENT = 64;     //!< Blocks and columns start at multiples of this.
+}
+
+/// Gathers results and writes them in blocks of columns.
+class ColumnWriter {
+    public:
+        /**
+         * @brief Creates a writer.
+         * @param block_rows full() tells when this many results are waiting.
+         */
+        explicit ColumnWriter( std::size_t block_rows = 1u << 16 );
+
+        /// Appends the header of the file, which goes before the first block.
+        static void append_header( std::string & out );
+
+        /// Adds a result to the block being gathered.
+        void add( const BaresManager::Result & res ) {
+            m_values.push_back( res.value );
+            m_codes.push_back( static_cast< std::uint8_t >( res.status.type ) );
+            if ( BaresManager::has_column( res.status.type ) ) m_columns.push_back( res.status.at_col );
+        }
+
+        /// Whether the block has reached the number of results asked for.
+        bool full( void ) const { return m_values.size() >= m_block_rows; }
+
+        /// Appends the block of the results gathered so far (nothing if there are none), and starts a new one.
+        void append_block( std::string & out );
+
+    private:
+        std::size_t m_block_rows;                 //!< Results per block.
+        std::vector< Parser::required_int_type > m_values; //!< The values of the block.
+        std::vector< std::uint8_t > m_codes;      //!< The codes of the block.
+        std::vector< std::uint32_t > m_columns;   //!< The columns of the syntax errors of the block.
+};
+
+/// A file of result columns, mapped in memory.
+class ColumnFile {
+    public:
+        /// A block of the file.
+        class Block {
+            public:
+                /// The number of results.
+                std::size_t rows( void ) const { return m_rows; }
+                /// The number of syntax errors, which have a column.
+                std::size_t errors( void ) const { return m_errors; }
+                /// The value of the i-th result.
+                Parser::required_int_type value( std::size_t i ) const;
+                /// The code of the i-th result.
+                Parser::ResultType::code_t code( std::size_t i ) const;
+                /// The column of the k-th syntax error.
+                std::uint32_t column( std::size_t k ) const;
+
+            private:
+                friend class ColumnFile;
+                const unsigned char * m_values {nullptr};  //!< Start of the values.
+                const unsigned char * m_codes {nullptr};   //!< Start of the codes.
+                const unsigned char * m_columns {nullptr}; //!< Start of the columns.
+                std::size_t m_rows {0};                    //!< Number of results.
+                std::size_t m_errors {0};                  //!< Number of columns.
+        };
+
+        /**
+         * @brief Maps a file of columns and checks its header.
+         * @param fd the open file (which is not closed by this class).
+         * @throw std::runtime_error if it cannot be mapped, or is not such a file.
+         */
+        explicit ColumnFile( int fd );
+        /// Unmaps the file.
+        ~ColumnFile();
+        /// Turn off copy constructor.
+        ColumnFile( const ColumnFile & ) = delete;
+        /// Turn off assignment operator.
+        ColumnFile & operator=( const ColumnFile & ) = delete;
+
+        /**
+         * @brief Gets the next block.
+         * @param block receives it.
+         * @return false after the last block.
+         * @throw std::runtime_error if the block does not fit in the file.
+         */
+        bool next( Block & block );
+
+        /// Calls `sink` with the Result of every line, in order.
+        template < typename Sink >
+        void for_each( Sink sink ) {
+            Block block;
+            while ( next( block ) )
+                for ( std::size_t i {0}, k {0}; i < block.rows(); i++ ) {
+                    const Parser::ResultType::code_t code = block.code( i );
+                    const auto col = BaresManager::has_column( code ) ? block.column( k++ ) : 0u;
+                    sink( BaresManager::Result{ Parser::ResultType{ code, col }, block.value( i ) } );
+                }
+        }
+
+    private:
+        const unsigned char * m_data; //!< The mapped file.
+        std::size_t m_size;           //!< Its size.
+        std::size_t m_next;           //!< Offset of the next block.
+};
+
+#endif
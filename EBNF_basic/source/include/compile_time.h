@@ -0,0 +1,288 @@
+#ifndef _COMPILE_TIME_H_
+#define _COMPILE_TIME_H_
+
+#include <cstddef>     // std::size_t
+#include <limits>      // std::numeric_limits
+#include <string_view> // std::string_view
+#include <vector>      // std::vector, usable in constant expressions since C++20
+
+#include "parser.h"        // Parser::ResultType
+#include "bares_manager.h" // BaresManager::Result
+#include "arithmetic.h"    // bares::precedence(), bares::apply_operator()
+
+/// Evaluation of BARES expressions in constant expressions.
+/*!
+ * Parser and BaresManager keep their state in sc::vector and std::string
+ * members that cannot live in a constant expression, so this is the same
+ * pipeline written as constexpr functions: the grammar of Parser (same
+ * productions, same error codes at the same columns), the conversion to
+ * postfix of BaresManager::infix_to_postfix() and the calculation of
+ * BaresManager::calculate(), with the arithmetic of arithmetic.h.
+ *
+ * bares::evaluate() gives, at compile time or at run time, the very Result of
+ * BaresManager::evaluate() (`bares --verify` checks that on every line).
+ * bares::eval<"...">() computes a literal expression while compiling:
+ * ```
+ *   constexpr short x = bares::eval< "(2+3)*8" >(); // 40, no code at run time.
+ *   bares::eval< "2 + * 3" >();                     // Does not compile.
+ * ```
+ * An expression that does not give a value is a compile error, raised by
+ * bares::invalid_expression< code, column > (the column counts from 1, like
+ * the messages of the program, and is 0 for a division by zero or an overflow,
+ * which have none).
+ */
+namespace bares {
+
+    namespace detail {
+
+        /// The tokens of an expression, as Parser stores them.
+        struct ct_token {
+            Token::token_t kind; //!< The type of the token.
+            value_type value;    //!< The value of an operand, or the symbol of any other token.
+        };
+
+        /// The grammar of Parser, in constexpr functions.
+        class ct_parser {
+            public:
+                /// Starts parsing an expression, with at most `max_depth` parentheses open at the same time.
+                constexpr ct_parser( std::string_view expr, std::size_t max_depth ) : m_expr{ expr }, m_max_depth{ max_depth } { /* empty */ }
+
+                /// Parses and tokenizes the expression, as Parser::parse_and_tokenize().
+                constexpr Parser::ResultType parse_and_tokenize( void ) {
+                    skip_ws();
+                    if ( end_input() )
+                        m_result = Parser::ResultType{ Parser::ResultType::UNEXPECTED_END_OF_EXPRESSION, here() };
+                    else if ( expression() ) {
+                        skip_ws();
+                        if ( not end_input() )
+                            m_result = Parser::ResultType{ Parser::ResultType::EXTRANEOUS_SYMBOL, here() };
+                    }
+                    return m_result;
+                }
+
+                /// The tokens found, valid after a successful parse.
+                constexpr const std::vector< ct_token > & tokens( void ) const { return m_tokens; }
+
+            private:
+                using size_type = Parser::ResultType::size_type;
+
+                std::string_view m_expr;          //!< The expression.
+                std::size_t m_max_depth;          //!< How many parentheses may be open at the same time.
+                std::size_t m_curr {0};           //!< The current character.
+                std::size_t m_begin_token {0};    //!< The beginning of the current candidate token.
+                Parser::ResultType m_result {};   //!< The result so far.
+                std::vector< ct_token > m_tokens; //!< The tokens.
+
+                /// Std::isspace() in the "C" locale.
+                static constexpr bool is_space( char c ) { return c == ' ' or ( c >= '\t' and c <= '\r' ); }
+
+                constexpr bool end_input( void ) const { return m_curr == m_expr.size(); }
+                constexpr size_type here( void ) const { return static_cast< size_type >( m_curr ); }
+                constexpr size_type token_location( void ) const { return static_cast< size_type >( m_begin_token ); }
+                constexpr void skip_ws( void ) { while ( not end_input() and is_space( m_expr[m_curr] ) ) m_curr++; }
+                constexpr void begin_token( void ) { skip_ws(); m_begin_token = m_curr; }
+                constexpr void push( Token::token_t kind, value_type value ) { m_tokens.push_back( ct_token{ kind, value } ); }
+
+                /// Consumes the current character if it is in [lo, hi].
+                constexpr bool accept( char lo, char hi ) {
+                    if ( end_input() or m_expr[m_curr] < lo or m_expr[m_curr] > hi ) return false;
+                    m_curr++;
+                    return true;
+                }
+                constexpr bool accept( char c ) { return accept( c, c ); }
+
+                /// <integer> := "0" | ["-"],<natural_number>;
+                constexpr bool integer( void ) {
+                    if ( accept( '0' ) ) return true;
+                    accept( '-' );
+                    if ( not accept( '1', '9' ) ) return false;
+                    while ( accept( '0', '9' ) ) /* empty */ ;
+                    return true;
+                }
+
+                /// An integer term, checked against the range, as Parser::term().
+                constexpr bool term( void ) {
+                    begin_token();
+                    if ( not integer() ) return false;
+                    // What std::stoll() gives, the largest value when there are too many digits.
+                    std::size_t i { m_begin_token };
+                    const bool negative { m_expr[i] == '-' };
+                    if ( negative ) i++;
+                    value_type value {0};
+                    for ( ; i < m_curr; i++ ) {
+                        const value_type digit { m_expr[i] - '0' };
+                        if ( value > ( std::numeric_limits< value_type >::max() - digit ) / 10 ) {
+                            value = std::numeric_limits< value_type >::max();
+                            break;
+                        }
+                        value = value * 10 + digit;
+                    }
+                    if ( negative and value != std::numeric_limits< value_type >::max() ) value = -value;
+                    if ( value < std::numeric_limits< Parser::required_int_type >::min() or
+                         value > std::numeric_limits< Parser::required_int_type >::max() ) {
+                        m_result = Parser::ResultType{ Parser::ResultType::INTEGER_OUT_OF_RANGE, token_location() };
+                        return false;
+                    }
+                    push( Token::token_t::OPERAND, value );
+                    return true;
+                }
+
+                /// A binary operator, as Parser::accept_operator().
+                constexpr bool accept_operator( void ) {
+                    for ( char op : { '-', '+', '*', '/', '%', '^' } )
+                        if ( accept( op ) ) {
+                            push( Token::token_t::OPERATOR, op );
+                            return true;
+                        }
+                    return false;
+                }
+
+                /// <expr> := <term>,{ <operator>,<term> }; with the explicit stack of Parser::expression().
+                constexpr bool expression( void ) {
+                    std::vector< bool > open;
+                    bool after_op { false };
+                    for ( ;; ) {
+                        if ( not term() and m_result.type == Parser::ResultType::OK ) {
+                            if ( accept( '(' ) ) {
+                                if ( open.size() >= m_max_depth )
+                                    m_result = Parser::ResultType{ Parser::ResultType::NESTING_TOO_DEEP, here() - 1 };
+                                else {
+                                    push( Token::token_t::OPEN_PARENTHESES, '(' );
+                                    begin_token();
+                                    open.push_back( after_op );
+                                    after_op = false;
+                                    continue;
+                                }
+                            }
+                            else
+                                m_result = Parser::ResultType{ Parser::ResultType::ILL_FORMED_INTEGER, here() };
+                        }
+                        for ( ;; ) {
+                            if ( m_result.type != Parser::ResultType::OK ) {
+                                if ( after_op and m_result.type == Parser::ResultType::ILL_FORMED_INTEGER )
+                                    m_result.type = Parser::ResultType::MISSING_TERM;
+                                if ( open.empty() or m_result.type == Parser::ResultType::NESTING_TOO_DEEP )
+                                    return false;
+                                m_result = Parser::ResultType{ Parser::ResultType::ILL_FORMED_INTEGER, token_location() };
+                                after_op = open.back();
+                                open.pop_back();
+                                continue;
+                            }
+                            skip_ws();
+                            if ( accept_operator() ) {
+                                after_op = true;
+                                break;
+                            }
+                            if ( open.empty() ) return true;
+                            begin_token();
+                            if ( accept( ')' ) )
+                                push( Token::token_t::CLOSE_PARENTHESES, ')' );
+                            else
+                                m_result = Parser::ResultType{ Parser::ResultType::MISSING_CLOSING, token_location() };
+                            after_op = open.back();
+                            open.pop_back();
+                        }
+                    }
+                }
+        };
+
+        /// Converts infix tokens to postfix, as BaresManager::infix_to_postfix().
+        constexpr std::vector< ct_token > to_postfix( const std::vector< ct_token > & infix ) {
+            std::vector< ct_token > postfix, operators;
+            for ( const ct_token & tk : infix ) {
+                if ( tk.kind == Token::token_t::OPERAND )
+                    postfix.push_back( tk );
+                else if ( tk.kind == Token::token_t::OPEN_PARENTHESES )
+                    operators.push_back( tk );
+                else if ( tk.kind == Token::token_t::CLOSE_PARENTHESES ) {
+                    while ( operators.back().kind != Token::token_t::OPEN_PARENTHESES ) {
+                        postfix.push_back( operators.back() );
+                        operators.pop_back();
+                    }
+                    operators.pop_back();
+                }
+                else {
+                    while ( not operators.empty() and
+                            precedence( static_cast< char >( tk.value ) ) <= precedence( static_cast< char >( operators.back().value ) ) ) {
+                        postfix.push_back( operators.back() );
+                        operators.pop_back();
+                    }
+                    operators.push_back( tk );
+                }
+            }
+            while ( not operators.empty() ) {
+                postfix.push_back( operators.back() );
+                operators.pop_back();
+            }
+            return postfix;
+        }
+    }
+
+    /**
+     * @brief Parses and computes an expression, in a constant expression or not.
+     * @param expr the expression.
+     * @param max_depth how many parentheses may be open at the same time.
+     * @return the same Result as BaresManager::evaluate().
+     */
+    constexpr BaresManager::Result evaluate( std::string_view expr, std::size_t max_depth = Parser::DEFAULT_MAX_DEPTH ) {
+        detail::ct_parser parser { expr, max_depth };
+        Parser::ResultType status = parser.parse_and_tokenize();
+        if ( status.type != Parser::ResultType::OK ) return BaresManager::Result{ status, 0 };
+
+        std::vector< value_type > operands;
+        value_type result {0};
+        for ( const detail::ct_token & tk : detail::to_postfix( parser.tokens() ) ) {
+            if ( tk.kind == Token::token_t::OPERAND ) {
+                operands.push_back( tk.value );
+                continue;
+            }
+            const value_type rhs { operands.back() };
+            operands.pop_back();
+            const value_type lhs { operands.back() };
+            operands.pop_back();
+            if ( not apply_operator( static_cast< char >( tk.value ), lhs, rhs, result ) )
+                status = Parser::ResultType{ Parser::ResultType::DIVISION_BY_ZERO };
+            operands.push_back( result );
+        }
+        if ( operands.size() == 1 ) result = operands.back();
+        if ( result < std::numeric_limits< Parser::required_int_type >::min() or
+             result > std::numeric_limits< Parser::required_int_type >::max() )
+            return BaresManager::Result{ Parser::ResultType{ Parser::ResultType::OVERFLOW_ERROR }, 0 };
+        return BaresManager::Result{ status, static_cast< Parser::required_int_type >( result ) };
+    }
+
+    /// A string literal given as a template argument.
+    template < std::size_t N >
+    struct fixed_string {
+        char text[N] {}; //!< The characters, with the final '\0'.
+
+        /// Copies a string literal.
+        constexpr fixed_string( const char ( &str )[N] ) {
+            for ( std::size_t i {0}; i < N; i++ ) text[i] = str[i];
+        }
+        /// The characters, without the final '\0'.
+        constexpr std::string_view view( void ) const { return std::string_view{ text, N - 1 }; }
+    };
+
+    /// Instantiated for an expression that has no value; the compiler names the code and the column (from 1, 0 if none).
+    template < Parser::ResultType::code_t Code, Parser::ResultType::size_type Column >
+    struct invalid_expression {
+        static_assert( Code == Parser::ResultType::OK, "the BARES expression given to bares::eval<>() is not valid" );
+        static constexpr bool ok { Code == Parser::ResultType::OK };
+    };
+
+    /**
+     * @brief Computes a literal expression while compiling.
+     * @tparam Expr the expression.
+     * @return its value; an invalid expression, a division by zero or an overflow does not compile.
+     */
+    template < fixed_string Expr >
+    consteval Parser::required_int_type eval( void ) {
+        constexpr BaresManager::Result result = evaluate( Expr.view() );
+        static_assert( invalid_expression< result.status.type,
+                                           BaresManager::has_column( result.status.type ) ? result.status.at_col + 1 : 0 >::ok );
+        return result.value;
+    }
+}
+
+#endif
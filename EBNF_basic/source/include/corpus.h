@@ -0,0 +1,36 @@
+#ifndef _CORPUS_H_
+#define _CORPUS_H_
+
+#include <cstddef> // std::size_t
+#include <random>  // std::mt19937
+#include <string>  // std::string
+
+/// Generates random BARES expressions with a skewed size distribution.
+/*!
+ * Most expressions are tiny (a handful of terms), some are medium sized and a few
+ * are very long and deeply nested, which is what real feeds look like and what
+ * the parallel modes have to cope with.
+ * All expressions are syntactically valid; some of them still end up in a
+ * division by zero or in an overflow.
+ */
+class CorpusGenerator {
+    public:
+        /// Creates a generator; the same seed always produces the same corpus.
+        explicit CorpusGenerator( unsigned seed = 1 ) : m_rng{ seed } { /* empty */ }
+
+        /// Returns a new random expression.
+        std::string next( void );
+
+    private:
+        std::mt19937 m_rng;                    //!< The source of randomness.
+        static constexpr std::size_t max_depth = 200; //!< Deepest parenthesis nesting generated.
+
+        /// Returns true with probability `p`.
+        bool coin( double p );
+        /// Appends a random operand.
+        void operand( std::string & out );
+        /// Appends an expression with `terms` operands, at a given nesting depth.
+        void expression( std::string & out, std::size_t terms, std::size_t depth, double nesting );
+};
+
+#endif
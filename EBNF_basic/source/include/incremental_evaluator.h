@@ -0,0 +1,127 @@
+#ifndef _INCREMENTAL_EVALUATOR_H_
+#define _INCREMENTAL_EVALUATOR_H_
+
+#include <cstddef>     // std::size_t
+#include <cstdint>     // std::uint8_t, std::uint32_t
+#include <string>      // std::string
+#include <string_view> // std::string_view
+#include <vector>      // std::vector
+
+#include "bares_manager.h" // class BaresManager
+#include "parser.h"        // Parser::ResultType
+
+/// Evaluates an expression again after each small edit, without parsing all of it.
+/*!
+ * The expression is kept as a list of lexemes (runs of digits and single
+ * symbols, white space left out) and as the tree of its parentheses: each
+ * group remembers its "(" and its ")", and what the Parser would come to on
+ * its own terms, where a nested group counts as a single term. That outcome
+ * is either the (unchecked) value of the group or the error the Parser would
+ * carry out of it, with its column taken from the "(".
+ *
+ * An edit lexes the text around it again, then parses the innermost group
+ * that holds it and, while the outcome changes, the groups around it up to
+ * the whole expression: the work of a keystroke is the terms of those groups,
+ * not the length of the expression. Adding or removing parentheses changes the
+ * tree, but only inside the lowest group around the edit that keeps its ")"
+ * (or keeps having none): the groups in it are built again first, and those
+ * that are not around the edit keep their outcomes. Unbalanced parentheses
+ * need nothing special: a "(" without a ")" holds the rest of the expression
+ * and a stray ")" is an ordinary symbol.
+ *
+ * The results are those of BaresManager::evaluate(). A division by zero (that
+ * puts the result of another operation in its place) is left to it.
+ */
+class IncrementalEvaluator {
+    public:
+        /**
+         * @brief Creates an evaluator of the empty expression.
+         * @param max_depth how many parentheses may be open at the same time.
+         */
+        explicit IncrementalEvaluator( std::size_t max_depth = Parser::DEFAULT_MAX_DEPTH );
+
+        /**
+         * @brief Starts over with a new expression.
+         * @param expr the expression.
+         * @return the same that BaresManager::evaluate(expr) gives.
+         */
+        BaresManager::Result set( std::string_view expr );
+
+        /**
+         * @brief Replaces part of the expression.
+         * @param at where the edit starts; it must not be past the end of the expression.
+         * @param erase how many bytes are removed from there.
+         * @param insert what is put in their place.
+         * @return the result of the edited expression.
+         */
+        BaresManager::Result edit( std::size_t at, std::size_t erase, std::string_view insert );
+
+        /**
+         * @brief Changes the expression to a new version, editing only what differs from the current one.
+         * @param expr the new version.
+         * @return the same that BaresManager::evaluate(expr) gives.
+         */
+        BaresManager::Result update( std::string_view expr );
+
+        /// The current expression.
+        const std::string & text( void ) const { return m_text; }
+        /// The result of the current expression.
+        const BaresManager::Result & result( void ) const { return m_result; }
+        /// How many groups (the whole expression being one) the last change parsed.
+        std::size_t reparsed( void ) const { return m_reparsed; }
+
+    private:
+        /// What a lexeme is.
+        enum class Kind : std::uint8_t {
+            DIGITS,   //!< A run of digits.
+            OPEN,     //!< A "(".
+            CLOSE,    //!< A ")".
+            OPERATOR, //!< One of "+-*/%^".
+            OTHER     //!< Any other byte that is not white space.
+        };
+
+        /// A piece of the expression.
+        struct Lexeme {
+            std::uint32_t pos;   //!< Its column.
+            std::uint32_t len;   //!< Its length, more than 1 only for digits.
+            std::uint32_t group; //!< The group a "(" opens.
+            Kind kind;           //!< What it is.
+        };
+
+        /// What the Parser comes to on a group.
+        struct Outcome {
+            Parser::ResultType status;    //!< OK, or the error, with its column counted from the "(" of the group.
+            Parser::input_int_type value; //!< The value, when the status is OK.
+            bool div;                     //!< Whether a division by zero happened inside.
+        };
+
+        /// A pair of parentheses, or the whole expression (group 0).
+        struct Group {
+            std::size_t open;   //!< Index of its "(" in the lexemes (not used by group 0).
+            std::size_t close;  //!< Index of its ")", or the number of lexemes if it has none.
+            std::size_t parent; //!< The group it is in.
+            std::size_t depth;  //!< How many parentheses are open in it, counting its own.
+            Outcome out;        //!< What it comes to.
+        };
+
+        std::size_t m_max_depth;           //!< How many parentheses may be open at the same time.
+        BaresManager m_bm;                 //!< Evaluates the expressions with a division by zero.
+        std::string m_text;                //!< The expression.
+        std::vector< Lexeme > m_lex;       //!< Its lexemes, by column.
+        std::vector< Lexeme > m_fresh;     //!< The lexemes of an edited span.
+        std::vector< Group > m_groups;     //!< Its groups, in the order of their "(".
+        std::vector< Group > m_inside;     //!< The groups built again inside another.
+        std::vector< std::size_t > m_open; //!< The groups still open while the tree is built.
+        std::vector< std::size_t > m_stale; //!< The groups built again that must be parsed.
+        BaresManager::Result m_result { Parser::ResultType{ Parser::ResultType::OK }, 0 }; //!< The result of the expression.
+        std::size_t m_reparsed {0};        //!< Groups parsed by the last change.
+
+        void lex( std::size_t from, std::size_t to, std::vector< Lexeme > & out ) const; // The lexemes of a span of the text.
+        void build( void );                         // Builds the tree and the outcome of each group.
+        void rebuild( std::size_t top, std::size_t n_old, std::size_t from, std::size_t to ); // Builds again the groups inside a group.
+        Outcome parse( std::size_t g ) const;       // What a group comes to, from its terms and the outcomes of its children.
+        std::size_t origin( std::size_t g ) const;  // The column the outcome of a group is counted from.
+        BaresManager::Result finish( void );        // Makes the result from the outcome of group 0.
+};
+
+#endif
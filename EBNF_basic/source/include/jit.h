@@ -0,0 +1,108 @@
+#ifndef _JIT_H_
+#define _JIT_H_
+
+#include <cstddef> // std::size_t
+#include <cstdint> // std::uint8_t
+#include <mutex>   // std::mutex
+#include <vector>  // std::vector
+
+#include "program.h"       // class Program
+#include "bares_manager.h" // BaresManager::Result
+
+/// Executable memory shared by many JitPrograms.
+/*!
+ * The code of a program takes a few hundred bytes. Giving each program pages of
+ * its own wastes memory and, worse, TLB entries when many programs run in turn.
+ * The arena packs them into big chunks instead. Each chunk is mapped twice from
+ * the same memory file, once writable (to copy code in) and once executable (to
+ * run it), so no page is ever writable and executable at the same time and code
+ * can be added while other threads run what is already there.
+ */
+class CodeArena {
+    public:
+        /**
+         * @brief Creates an empty arena.
+         * @param chunk_size size of each chunk of memory.
+         */
+        explicit CodeArena( std::size_t chunk_size = 1u << 20 ) : m_chunk_size{ chunk_size } { /* empty */ }
+        /// Releases all the memory: the programs that use it cannot run anymore.
+        ~CodeArena();
+        /// Turn off copy constructor.
+        CodeArena( const CodeArena & ) = delete;
+        /// Turn off assignment operator.
+        CodeArena & operator=( const CodeArena & ) = delete;
+
+        /**
+         * @brief Copies machine code into the arena.
+         * @param code the code.
+         * @param size its size in bytes.
+         * @return where the code can be run; null if the system gives no executable memory this way.
+         */
+        const void * install( const std::uint8_t * code, std::size_t size );
+
+    private:
+        /// A piece of memory, seen through its two mappings.
+        struct Chunk {
+            void * writable;   //!< Where the code is written.
+            void * executable; //!< Where the same code is run.
+            std::size_t size;  //!< Size of both mappings.
+        };
+
+        std::mutex m_lock;             //!< Programs may be compiled by many threads.
+        std::size_t m_chunk_size;      //!< Size of a new chunk.
+        std::vector< Chunk > m_chunks; //!< The chunks, the last one is being filled.
+        std::size_t m_used {0};        //!< Bytes used in the last chunk.
+};
+
+/// A compiled expression turned into native x86-64 code.
+/*!
+ * Each instruction of the Program becomes a few machine instructions in a
+ * buffer allocated with mmap() and then made executable (never writable and
+ * executable at the same time). The values of the stack machine live in
+ * registers (the deepest ones in the native stack frame), so running the code
+ * has no dispatch, no loads of instructions and no pushes or pops.
+ *
+ * The range check of the final value is done inline. A division by zero makes
+ * the native code give up, and the interpreter runs the program instead, since
+ * that case has its own rules (the previous result takes the place of the
+ * operands). The interpreter is also used when the JIT is not available
+ * (another architecture, or mmap() refused).
+ */
+class JitProgram {
+    public:
+        /**
+         * @brief Translates a program into native code.
+         * @param program the program, which is copied for the interpreter fallback.
+         * @param arena where to put the code (it must outlive this object); null to map pages just for it.
+         */
+        explicit JitProgram( const Program & program, CodeArena * arena = nullptr );
+        /// Releases the native code.
+        ~JitProgram();
+        /// Turn off copy constructor.
+        JitProgram( const JitProgram & ) = delete;
+        /// Turn off assignment operator.
+        JitProgram & operator=( const JitProgram & ) = delete;
+
+        /**
+         * @brief Runs the program, giving the same result as Program::run().
+         * @return the status and the value of the expression.
+         */
+        BaresManager::Result run( void ) const;
+
+        /// Tells whether native code is being used (otherwise everything goes to the interpreter).
+        bool native( void ) const { return m_entry != nullptr; }
+
+        /// Tells whether this build and this system can generate native code at all.
+        static bool supported( void );
+
+    private:
+        /// The signature of the generated code: 0 = OK (value stored), 1 = overflow, 2 = use the interpreter.
+        using entry_type = int (*)( Parser::input_int_type * value );
+
+        Program m_program;   //!< The program, for the fallback.
+        void * m_memory;     //!< The executable buffer, when it is not in an arena.
+        std::size_t m_size;  //!< Size of the buffer.
+        entry_type m_entry;  //!< The generated code, null if there is none.
+};
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef _LATENCY_H_
+#define _LATENCY_H_
+
+#include <cstddef> // std::size_t
+#include <cstdint> // std::uint64_t
+#include <string>  // std::string
+
+/// Counts durations, to tell their percentiles without keeping each one.
+/*!
+ * A duration, in nanoseconds, falls in one of the ranges [2^k, 2^(k+1)), and
+ * each range is cut into SUB buckets of the same width: a percentile is known
+ * to 1/SUB of its value (about 3%) at any scale, from a fixed table. Adding a
+ * duration is a count of leading zeros and an increment, and two histograms
+ * merge by adding their tables.
+ */
+class LatencyHistogram {
+    public:
+        static constexpr unsigned SUB_BITS = 5;                   //!< log2 of the buckets of a power of two.
+        static constexpr std::uint64_t SUB = 1u << SUB_BITS;      //!< Buckets of a power of two.
+
+        /// Adds a duration.
+        void add( std::uint64_t ns ) {
+            m_counts[index( ns )]++;
+            m_count++;
+            if ( ns > m_max ) m_max = ns;
+        }
+
+        /// Adds the durations of another histogram.
+        void merge( const LatencyHistogram & other );
+
+        /// Forgets every duration.
+        void clear( void );
+
+        /// The number of durations.
+        std::uint64_t count( void ) const { return m_count; }
+        /// The longest duration.
+        std::uint64_t max( void ) const { return m_max; }
+
+        /**
+         * @brief The duration that a fraction of the others do not exceed.
+         * @param q the fraction, from 0 to 1 (0.99 for the 99th percentile).
+         * @return the upper bound of the bucket where it falls (at most max()), 0 if there are none.
+         */
+        std::uint64_t percentile( double q ) const;
+
+        /**
+         * @brief Appends a line with the count, p50, p90, p99, p99.9 and the maximum, in microseconds.
+         * @param out the string that receives the text, including the line break.
+         */
+        void append_summary( std::string & out ) const;
+
+    private:
+        static constexpr std::size_t N_BUCKETS = ( 64 - SUB_BITS + 1 ) << SUB_BITS; //!< Enough for any 64-bit duration.
+
+        /// The bucket of a duration: exact below 2 * SUB, then SUB buckets per power of two.
+        static std::size_t index( std::uint64_t ns ) {
+            if ( ns < 2 * SUB ) return static_cast< std::size_t >( ns );
+            const unsigned shift { 63u - static_cast< unsigned >( __builtin_clzll( ns ) ) - SUB_BITS };
+            return ( static_cast< std::size_t >( shift ) << SUB_BITS ) + static_cast< std::size_t >( ns >> shift );
+        }
+
+        std::uint64_t m_counts[N_BUCKETS] {}; //!< How many durations fell in each bucket.
+        std::uint64_t m_count {0};            //!< The number of durations.
+        std::uint64_t m_max {0};              //!< The longest one.
+};
+
+#endif
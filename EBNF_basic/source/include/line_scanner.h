@@ -0,0 +1,68 @@
+#ifndef _LINE_SCANNER_H_
+#define _LINE_SCANNER_H_
+
+#include <cstddef>     // std::size_t
+#include <cstdint>     // std::uint64_t
+#include <string_view> // std::string_view
+
+/// Splits a text into lines and finds, in each one, the first byte the parser cannot accept.
+/*!
+ * The text is classified 64 bytes at a time with SIMD instructions (AVX2 when
+ * the processor has it, SSE2 otherwise, plain C++ on other architectures): one
+ * bit mask tells where the line breaks are, another where the bytes outside the
+ * BARES alphabet are (anything Parser::lexer() does not know: letters, ".",
+ * "="...). The white space std::isspace() knows, "\r" included, is accepted, as
+ * Parser::skip_ws() skips it. Walking the lines is then a matter of counting
+ * bits, and a line with a bad byte is known before it is ever parsed, see
+ * BaresManager::evaluate().
+ *
+ * Lines are split the same way std::getline() does.
+ */
+class LineScanner {
+    public:
+        /// Column of a line without any bad byte.
+        static constexpr std::size_t npos = std::string_view::npos;
+
+        /// A line and what the scanner found in it.
+        struct Line {
+            std::string_view text; //!< The line, without its line break.
+            std::size_t invalid;   //!< Column of the first byte outside the alphabet, or npos.
+        };
+
+        /**
+         * @brief Starts scanning a text.
+         * @param text the text, which must outlive the scanner and the lines it gives.
+         */
+        explicit LineScanner( std::string_view text );
+
+        /**
+         * @brief Gets the next line.
+         * @param line receives the line.
+         * @return false when there are no more lines.
+         */
+        bool next( Line & line );
+
+        /**
+         * @brief Tells whether the parser knows a byte.
+         * @param c the byte.
+         * @return true for digits, operators, parentheses and white space (the bytes
+         * Parser::skip_ws() skips, "\n" included).
+         */
+        static bool accepted( char c ) {
+            return ( c >= '(' and c <= '9' and c != ',' and c != '.' ) or
+                   c == ' ' or ( c >= '\t' and c <= '\r' ) or c == '%' or c == '^';
+        }
+
+    private:
+        static constexpr std::size_t BLOCK = 64; //!< Bytes classified at a time, one per bit of a mask.
+
+        std::string_view m_text;   //!< The text being scanned.
+        std::size_t m_pos;         //!< Where the next line begins.
+        std::size_t m_block;       //!< Where the block of the masks begins.
+        std::uint64_t m_newlines;  //!< Line breaks of the block, from m_pos on.
+        std::uint64_t m_invalid;   //!< Bytes of the block outside the alphabet, from m_pos on.
+
+        void load( void ); // Classifies the block at m_block.
+};
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef _OPTIONS_H_
+#define _OPTIONS_H_
+
+#include <cstddef>  // std::size_t
+#include <iostream> // std::ostream
+#include <string>   // std::string
+
+#include "async_io.h"      // enum class IoBackend
+#include "parser.h"        // Parser::DEFAULT_MAX_DEPTH
+#include "bares_manager.h" // enum class BaresManager::Format
+
+/// The settings of a run of the program, taken from the command line.
+struct Options {
+    bool batch {false};         //!< Read the whole input and evaluate it with the work-stealing scheduler.
+    bool pipeline {false};      //!< Overlap reading, evaluating and writing in a three-stage pipeline.
+    bool split {false};         //!< Evaluate each long line in pieces, on several threads.
+    std::size_t threads {0};    //!< Number of worker threads, 0 means one per hardware thread.
+    std::size_t max_depth {Parser::DEFAULT_MAX_DEPTH}; //!< How many parentheses may be open at the same time.
+    bool verify {false};        //!< Check the compiled engines against the reference evaluation instead of printing results.
+    std::size_t generate {0};   //!< When not zero, write this many random expressions instead of evaluating.
+    unsigned seed {1};          //!< Seed of the generated corpus.
+    std::string input;          //!< File with the expressions, empty means the standard input.
+    std::string output;         //!< File for the results, empty means the standard output.
+    IoBackend io {IoBackend::AUTO}; //!< Which system calls read the input and write the output.
+    BaresManager::Format format {BaresManager::Format::TEXT}; //!< How the results (and errors) are written.
+    bool decode {false};        //!< Write the results of a --format binary file as text instead of evaluating.
+    std::string cache;          //!< File of the compiled lines of the input (see ProgramCache), empty for none.
+    unsigned aggregate {0};     //!< The Aggregate::Part flags to write a summary instead of each result, 0 for none.
+    bool sheet {false};         //!< Read definitions ("name = expression") that may use each other, see Sheet.
+    bool incremental {false};   //!< Take each line as a new version of the one before, see IncrementalEvaluator.
+    std::string serve;          //!< Path of the Unix domain socket to serve the clients on (see EvalServer), empty for none.
+    bool help {false};          //!< Only show the usage message.
+};
+
+/**
+ * @brief Reads the command line arguments.
+ * @param argc number of arguments.
+ * @param argv the arguments.
+ * @param opt receives the settings.
+ * @return true if the arguments are valid; false otherwise (after reporting the problem to std::cerr).
+ */
+bool parse_options( int argc, char * argv[], Options & opt );
+
+/**
+ * @brief Writes the usage message.
+ * @param os where to write it.
+ * @param prog name of the program.
+ */
+void print_usage( std::ostream & os, const char * prog );
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef _PAREN_INDEX_H_
+#define _PAREN_INDEX_H_
+
+#include <cstddef>     // std::size_t, std::ptrdiff_t
+#include <cstdint>     // std::uint32_t
+#include <string_view> // std::string_view
+
+#include "../lib/vector.h" // class vector
+#include "../lib/stack.h"  // class stack
+
+/// Where the parentheses of a line are and how they nest, found before parsing it.
+/*!
+ * A structural pass in the spirit of simdjson: the line is read 16 bytes at a
+ * time, each "(" counting +1 and each ")" -1, and a vector prefix sum (four
+ * shifts and adds) gives the nesting depth after every byte of the block. The
+ * highest and the lowest depth of the block come out of the same registers,
+ * so the deepest nesting of the line and the first ")" that closes nothing
+ * are known without looking at the bytes one by one. Blocks without any
+ * parenthesis cost a single comparison.
+ *
+ * On request, match() also lists the positions of the parentheses with the
+ * one matching each of them. A line where they do not balance can never be a
+ * valid expression, which the parser uses to skip building tokens for it.
+ */
+class ParenIndex {
+    public:
+        /// Position of something that is not there.
+        static constexpr std::size_t npos = std::string_view::npos;
+
+        /**
+         * @brief Measures the parentheses of a line, forgetting the previous one.
+         * @param line the text, which does not need to outlive the call.
+         */
+        void build( std::string_view line );
+
+        /**
+         * @brief Finds the positions of the parentheses and pairs them, for who needs them.
+         * @param line the same text given to build().
+         */
+        void match( std::string_view line );
+
+        /// The number of "(" minus the number of ")".
+        std::ptrdiff_t balance( void ) const { return m_balance; }
+        /// The highest count of "(" minus ")" at any point of the line.
+        std::size_t max_depth( void ) const { return m_max_depth; }
+        /// Position of the first ")" that closes nothing, or npos.
+        std::size_t stray( void ) const { return m_stray; }
+        /// Whether every parenthesis has its match.
+        bool balanced( void ) const { return m_balance == 0 and m_stray == npos; }
+
+        /// The number of parentheses, both kinds (after match()).
+        std::size_t size( void ) const { return m_position.size(); }
+        /// Position in the line of the k-th parenthesis.
+        std::size_t position( std::size_t k ) const { return m_position[k]; }
+        /// Index (for position()) of the parenthesis matching the k-th one, or npos (after match()).
+        std::size_t partner( std::size_t k ) const { return m_partner[k] == NONE ? npos : m_partner[k]; }
+
+    private:
+        static constexpr std::uint32_t NONE = ~std::uint32_t{0}; //!< No partner.
+
+        std::ptrdiff_t m_balance {0};           //!< "(" minus ")".
+        std::size_t m_max_depth {0};            //!< Deepest nesting.
+        std::size_t m_stray {npos};             //!< First ")" without its "(".
+        sc::vector< std::uint32_t > m_position; //!< Where each parenthesis is.
+        sc::vector< std::uint32_t > m_partner;  //!< The parenthesis matching each one.
+        sta::stack< std::uint32_t > m_open;     //!< The "(" still unmatched, while pairing them.
+};
+
+#endif
@@ -17,18 +17,24 @@
 #include "../lib/vector.h" // class vector
 #include "../lib/stack.h"  // class stack
 #include "token.h"         // struct Token.
+#include "token_buffer.h"  // class TokenBuffer.
+#include "paren_index.h"   // class ParenIndex.
+
+class Ast; // The syntax tree of an expression (ast.h).
 
 /// This class represents a parser that **validates** and **tokenizes** an expression.
 /*!
  * This class does two tasks:
  *
- * 1. It implements a recursive descendent parser that validates expressions according to a EBNF grammar.
+ * 1. It implements a descendent parser that validates expressions according to a EBNF grammar.
+ *    Parentheses are handled with an explicit stack instead of recursion, so deeply
+ *    nested input costs no native stack and the depth can be limited.
  * 2. While validating an expression, it also tokenizes the input expression into its components, creating a list of tokens.
  *
  * The grammar is:
  * ```
- *   <expr>            := <term>,{ ("+"|"-"),<term> };
- *   <term>            := <integer>;
+ *   <expr>            := <term>,{ ("+"|"-"|"*"|"/"|"%"|"^"),<term> };
+ *   <term>            := "(",<expr>,")" | <integer>;
  *   <integer>         := "0" | ["-"],<natural_number>;
  *   <natural_number>  := <digit_excl_zero>,{<digit>};
  *   <digit_excl_zero> := "1" | "2" | "3" | "4" | "5" | "6" | "7" | "8" | "9";
@@ -54,7 +60,8 @@ class Parser
                     INTEGER_OUT_OF_RANGE,
                     MISSING_CLOSING,
                     DIVISION_BY_ZERO,
-                    OVERFLOW_ERROR
+                    OVERFLOW_ERROR,
+                    NESTING_TOO_DEEP //!< More open parentheses than the parser accepts.
             };
 
             //=== Members (public).
@@ -62,7 +69,7 @@ class Parser
             size_type at_col; //!< Stores the column number where the error happened.
 
             /// Default contructor.
-            explicit ResultType( code_t type_=OK , size_type col_=0u )
+            explicit constexpr ResultType( code_t type_=OK , size_type col_=0u )
                     : type{ type_ }
                     , at_col{ col_ }
             { /* empty */ }
@@ -72,15 +79,29 @@ class Parser
         typedef short int required_int_type; //!< The interger type we accept as valid for an expression.
         typedef long long int input_int_type; //!< The integer type that we read from the input, which should be larger than  he required integer range (so we can identify input errors).
 
+        /// How many parentheses may be open at the same time, unless told otherwise.
+        static constexpr std::size_t DEFAULT_MAX_DEPTH = 4096;
+
         //==== Public interface
         /// Parses and tokenizes an input source expression.  Return the result as a struct.
         ResultType parse_and_tokenize( std::string e_ );
         /// Retrieves the list of tokens created during the partins process.
         sc::vector< Token > get_tokens( void ) const;
+        /// The tokens created during the parsing process, as they are stored.
+        const TokenBuffer & tokens( void ) const { return m_tokens; }
+        /// The most values on the operand stack while the last expression is calculated in postfix order.
+        std::size_t operand_depth( void ) const { return m_max_operands; }
+        /// The most operators and "(" on the stack while the last expression is converted to postfix.
+        std::size_t operator_depth( void ) const { return m_max_pending; }
+        /// Builds the syntax tree of the last expression, which must be valid; `share` merges equal subexpressions.
+        void build_ast( Ast & ast, bool share = true ) const;
+        /// The parentheses of the last expression, indexed before it was parsed.
+        const ParenIndex & parens( void ) const { return m_parens; }
 
         //==== Special methods
-        /// Default constructor
-        Parser() = default;
+        /// Constructor.
+        /// @param max_depth how many parentheses may be open at the same time.
+        explicit Parser( std::size_t max_depth = DEFAULT_MAX_DEPTH ) : m_max_depth{ max_depth } { /* empty */ }
         /// Default destructor
         ~Parser() = default;
         /// Turn off copy constructor. We do not need it.
@@ -111,8 +132,16 @@ class Parser
         std::string m_expr;                     //!< The source expression to be parsed
         std::string::iterator m_it_curr_symb;   //!< Pointer to the current char inside the expression.
         std::string::iterator m_begin_token;    //!< Pointer to the beginning of the current candidate token.
-        sc::vector<Token> m_tk_list;           //!< Resulting list of tokens extracted from the expression.
+        TokenBuffer m_tokens;                   //!< Resulting list of tokens extracted from the expression.
         ResultType m_result;                    //!< The result for the current expression (either error of OK).
+        std::size_t m_max_depth;                //!< How many parentheses may be open at the same time.
+        // The conversion to postfix and the calculation, replayed on counters as tokens are found.
+        sta::stack< char > m_pending;           //!< Operators and "(" the conversion would have on its stack.
+        std::size_t m_operands {0};             //!< Values the calculation would have on its stack.
+        std::size_t m_max_pending {0};          //!< Most elements ever in m_pending.
+        std::size_t m_max_operands {0};         //!< Most values ever in m_operands.
+        ParenIndex m_parens;                    //!< Where the parentheses of the expression are.
+        bool m_tokenize {true};                 //!< Whether the tokens are worth keeping (the parentheses balance).
 
         //=== Support parser methods.
         void begin_token();                     //!< Begins the process of token formation, keeping track of the first character that makes up the token inside the input string.
@@ -124,6 +153,10 @@ class Parser
         void next_symbol( void );                // Advances iterator to the next char in the expression.
         bool peek( terminal_symbol_t c_ ) const; // Peeks the current character (NOT USED HERE).
         bool accept( terminal_symbol_t c_ );     // Tries to accept the requested symbol.
+        bool accept_operator( void );            // Tries to accept any binary operator, storing its token.
+        void count_operand( void );              // Replays an operand on the depth counters.
+        void count_operator( char op );          // Replays an operator on the depth counters.
+        void count_parenthesis( char p );        // Replays a "(" or a ")" on the depth counters.
         //bool expect( terminal_symbol_t c_ );   // Skips any WS/Tab and tries to accept the requested symbol.
         void skip_ws( void );                    // Skips any WS/Tab ans stops at the next character.
         bool end_input( void ) const;            // Checks whether we reached the end of the expression string.
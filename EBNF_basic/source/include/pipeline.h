@@ -0,0 +1,98 @@
+#ifndef _PIPELINE_H_
+#define _PIPELINE_H_
+
+#include <atomic>   // std::atomic
+#include <cstddef>  // std::size_t
+#include <memory>   // std::unique_ptr
+#include <mutex>    // std::mutex
+#include <string>   // std::string
+
+#include "../lib/ring_queue.h"    // class spsc_ring, class mpmc_ring
+#include "../lib/sequence_ring.h" // class sequence_ring
+#include "bares_manager.h"        // class BaresManager
+#include "async_io.h"             // class AsyncInput, class AsyncOutput
+#include "aggregate.h"            // class Aggregate
+
+/// Evaluates a stream of expressions with three overlapping stages.
+/*!
+ * The stages run at the same time, so the time to read, to evaluate and to
+ * write do not add up anymore: the throughput is that of the slowest stage.
+ *
+ * 1. The **reader** fills blocks with whole lines of the input.
+ * 2. **N evaluators** take blocks from a lock-free MPMC ring and compute each line.
+ * 3. The **writer** (the calling thread) takes the evaluated blocks back in input
+ *    order from a sequence ring and writes their text.
+ *
+ * The blocks come from a fixed pool and the writer hands them back to the reader
+ * through a lock-free SPSC ring, so memory stays bounded and a slow stage makes
+ * the others wait (backpressure) instead of piling up data.
+ *
+ * With Format::BINARY each block of the input becomes a block of columns
+ * (see ColumnWriter), which the writer puts after the header of the file.
+ *
+ * With aggregate() the evaluators make no text: each one folds its results
+ * into its own accumulator, and the writer only recycles the blocks.
+ */
+class Pipeline {
+    public:
+        /**
+         * @brief Creates a pipeline.
+         * @param evaluators number of evaluator threads, 0 means one per hardware thread.
+         * @param max_depth how many parentheses may be open at the same time in an expression.
+         * @param format how the results are written.
+         * @param block_size the reader puts at least this many bytes of input in each block.
+         */
+        explicit Pipeline( std::size_t evaluators = 0, std::size_t max_depth = Parser::DEFAULT_MAX_DEPTH,
+                           BaresManager::Format format = BaresManager::Format::TEXT,
+                           std::size_t block_size = 1u << 16 );
+
+        /// Turn off copy constructor.
+        Pipeline( const Pipeline & ) = delete;
+        /// Turn off assignment operator.
+        Pipeline & operator=( const Pipeline & ) = delete;
+
+        /**
+         * @brief Evaluates every line of the input, writing the results in order.
+         * @param in where the expressions come from, one per line.
+         * @param out where the results go, one per line.
+         */
+        void run( AsyncInput & in, AsyncOutput & out );
+
+        /**
+         * @brief Evaluates every line of the input and folds the results.
+         * @param in where the expressions come from, one per line.
+         * @param parts the Aggregate::Part flags of what to keep.
+         * @return the results of all evaluators, merged.
+         */
+        Aggregate aggregate( AsyncInput & in, unsigned parts );
+
+    private:
+        /// A piece of the input made of whole lines, plus the text of their results.
+        struct Block {
+            std::size_t seq {0}; //!< Position of the block in the input.
+            std::string text;    //!< The lines, each one ended by a line break (except maybe the very last).
+            std::string out;     //!< The results of the lines, ready to be written.
+        };
+
+        std::size_t m_n_evaluators;          //!< Number of evaluator threads.
+        std::size_t m_max_depth;             //!< How many parentheses may be open in an expression.
+        BaresManager::Format m_format;       //!< How the results are written.
+        std::size_t m_block_size;            //!< Minimum number of bytes in each block.
+        std::size_t m_n_blocks;              //!< Number of blocks in the pool.
+        std::unique_ptr< Block[] > m_blocks; //!< The pool of blocks.
+        sc::spsc_ring< Block * > m_free;     //!< Writer -> reader: blocks ready for reuse.
+        sc::mpmc_ring< Block * > m_work;     //!< Reader -> evaluators: blocks to evaluate.
+        sc::sequence_ring< Block * > m_done; //!< Evaluators -> writer: evaluated blocks, by sequence.
+        std::atomic< std::size_t > m_total;  //!< Number of blocks read, known once the input is over.
+        std::size_t m_base;                  //!< Sequence of the first block of the run (m_done goes on across runs).
+        Block * m_spare;                     //!< A free block the reader took but did not need.
+        unsigned m_parts;                    //!< The Aggregate::Part flags in aggregate(), 0 to write the results.
+        Aggregate m_totals;                  //!< What the evaluators folded, in aggregate().
+        std::mutex m_totals_lock;            //!< Protects m_totals while the evaluators merge into it.
+
+        void read( AsyncInput & in );   // The reader stage.
+        void evaluate( void );          // The evaluator stage.
+        void drive( AsyncInput & in, AsyncOutput * out ); // Runs the three stages.
+};
+
+#endif
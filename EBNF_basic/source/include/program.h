@@ -0,0 +1,110 @@
+#ifndef _PROGRAM_H_
+#define _PROGRAM_H_
+
+#include <cstddef> // std::size_t
+#include <cstdint> // std::int32_t, std::uint8_t, std::uint16_t
+
+#include "../lib/vector.h" // class vector
+#include "token_buffer.h"  // class TokenBuffer
+#include "parser.h"        // Parser::input_int_type, Parser::ResultType
+#include "arithmetic.h"    // bares::magic_divisor
+#include "bares_manager.h" // BaresManager::Result
+
+/// One instruction of a compiled expression.
+struct Instr {
+    /// The operations; the binary ones are coded by their own symbol.
+    /*!
+     * The `_CONST` ones are superinstructions: a PUSH fused with the operator
+     * that follows it, which then works on the value on top and `arg`.
+     */
+    enum class op_t : std::uint8_t {
+        PUSH = 0,      //!< Pushes `arg`.
+        DIV_CONST = 1, //!< Replaces the value on top by its quotient by `arg`, with the magic divisor `aux`.
+        MOD_CONST = 2, //!< Replaces the value on top by its remainder by `arg`, with the magic divisor `aux`.
+        ADD_CONST = 3, //!< Adds `arg` to the value on top.
+        SUB_CONST = 4, //!< Subtracts `arg` from the value on top.
+        MUL_CONST = 5, //!< Multiplies the value on top by `arg`.
+        POW_CONST = 6, //!< Raises the value on top to the power `arg`.
+        ADD = '+',  //!< Replaces the two values on top by their sum.
+        SUB = '-',  //!< Replaces the two values on top by their difference.
+        MUL = '*',  //!< Replaces the two values on top by their product.
+        DIV = '/',  //!< Replaces the two values on top by their quotient.
+        MOD = '%',  //!< Replaces the two values on top by the remainder of their division.
+        POW = '^'   //!< Replaces the two values on top by the power.
+    };
+
+    op_t op;           //!< What to do.
+    std::uint16_t aux; //!< Index of the magic divisor in the program, for DIV_CONST and MOD_CONST.
+    std::int32_t arg;  //!< The value pushed by PUSH, or the constant operand of a superinstruction.
+
+    /// Tells whether the instruction takes one value from the stack and puts one back.
+    bool in_place( void ) const { return op != op_t::PUSH and op <= op_t::POW_CONST; }
+};
+
+/// An expression compiled into a program for a stack machine.
+/*!
+ * A postfix list of tokens is already the order in which a stack machine
+ * evaluates the expression. Compiling it once turns every token into a small
+ * instruction (no strings, no conversions left) that can be run as many times
+ * as needed by the interpreter in run(), or turned into native code by JitProgram.
+ *
+ * A peephole pass fuses every literal with the operator that consumes it, the
+ * pattern `x 2 *` becoming a single "multiply by 2", so that half the
+ * dispatches and stack movements are gone. Divisions and remainders by a
+ * literal become a multiplication by a magic number and a few shifts, which
+ * costs a fraction of a hardware division. A literal zero divisor is found
+ * here already, see diagnostic().
+ */
+class Program {
+    public:
+        using value_type = Parser::input_int_type; //!< The type the program computes with.
+
+        /**
+         * @brief Compiles a list of tokens in postfix order.
+         * @param postfix the tokens, as BaresManager::infix_to_postfix() leaves them.
+         * @return the program.
+         */
+        static Program compile( const TokenBuffer & postfix );
+
+        /**
+         * @brief Runs the program, giving the same result as BaresManager::calculate().
+         * @return the status and the value of the expression.
+         */
+        BaresManager::Result run( void ) const;
+
+        /**
+         * @brief Runs instructions kept somewhere else, such as a ProgramCache mapped in memory.
+         * @param code the instructions.
+         * @param size how many there are.
+         * @param divisors the magic divisors they refer to.
+         * @param max_depth the most values they ever have on the stack.
+         * @return the status and the value of the expression.
+         */
+        static BaresManager::Result run( const Instr * code, std::size_t size,
+                                         const bares::magic_divisor * divisors, std::size_t max_depth );
+
+        /// The instructions.
+        const sc::vector< Instr > & code( void ) const { return m_code; }
+        /// The magic divisors, in the order `aux` counts them.
+        const sc::vector< bares::magic_divisor > & divisors( void ) const { return m_divisors; }
+        /// The most values the program ever has on its stack.
+        std::size_t max_depth( void ) const { return m_max_depth; }
+        /// The magic divisor an instruction refers to.
+        const bares::magic_divisor & divisor( const Instr & in ) const { return m_divisors[in.aux]; }
+
+        /**
+         * @brief Tells what is already known to go wrong before running.
+         * @return DIVISION_BY_ZERO at the column of the first operator whose divisor is a literal zero, or OK.
+         */
+        const Parser::ResultType & diagnostic( void ) const { return m_diagnostic; }
+
+    private:
+        sc::vector< Instr > m_code;                      //!< The instructions.
+        sc::vector< bares::magic_divisor > m_divisors;   //!< The magic numbers of the constant divisors.
+        std::size_t m_max_depth {0};                     //!< The most values on the stack at the same time.
+        Parser::ResultType m_diagnostic { Parser::ResultType::OK }; //!< What compile() found out.
+
+        void peephole( void ); // Fuses literals with their operators.
+};
+
+#endif
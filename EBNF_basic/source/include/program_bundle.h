@@ -0,0 +1,153 @@
+#ifndef _PROGRAM_BUNDLE_H_
+#define _PROGRAM_BUNDLE_H_
+
+#include <cstddef> // std::size_t
+#include <cstdint> // std::uint32_t, std::uint64_t
+#include <string>  // std::string
+
+#include "../lib/vector.h" // class vector
+#include "program.h"       // class Program, struct Instr
+#include "bares_manager.h" // class BaresManager
+
+/// Many compiled expressions in one block of bytes, run where they lie.
+/*!
+ * A program that needs thousands of expressions at startup would parse and
+ * compile every one of them. A bundle holds them compiled: the Writer turns
+ * Programs into bytes once, and later a ProgramBundle maps those bytes (or is
+ * given them in memory) and runs each program in place, without parsing,
+ * copying or allocating. Opening a bundle checks it once, so a damaged or
+ * foreign file is refused instead of being run.
+ *
+ * The layout is fixed and little-endian, and every reference is an offset
+ * from the start of the bundle, so a bundle can be moved, copied, or embedded
+ * anywhere in a bigger file:
+ *
+ * | offset | size   | field                                                   |
+ * |--------|--------|---------------------------------------------------------|
+ * | 0      | 8      | magic, "BARESBDL"                                       |
+ * | 8      | 2 + 2  | version: major (a reader refuses others), minor         |
+ * | 12     | 4      | flags, 0                                                |
+ * | 16     | 8      | number of entries                                       |
+ * | 24     | 8      | offset of the directory                                 |
+ * | 32     | 8      | size of the bundle                                      |
+ * | 40     | 24     | tag: three numbers for the owner of the bundle          |
+ *
+ * The directory has one entry of 32 bytes per expression: the code and the
+ * column of its status (a parse error, or the Program::diagnostic() of a
+ * valid one), the offset of its program (0 for an expression that does not
+ * parse), its numbers of instructions and of magic divisors, and its stack
+ * depth. A program is its magic divisors (16 bytes each) then its
+ * instructions (8 bytes each: op, 0, aux, arg), starting at a multiple of 8
+ * bytes. Running a program can only fail with a division by zero or an
+ * overflow, which have no column, and the one column a valid expression may
+ * have is its diagnostic, in its entry: a program keeps no columns of its
+ * instructions.
+ *
+ * The expressions have no variables, so there is no table of variable slots;
+ * a later version would add one with a new minor number.
+ */
+class ProgramBundle {
+    public:
+        static constexpr std::uint16_t MAJOR = 2; //!< Readers refuse bundles of another major version.
+        static constexpr std::uint16_t MINOR = 0; //!< Additions that older readers may ignore.
+
+        /// Builds a bundle.
+        class Writer {
+            public:
+                /// Adds a valid expression, as compiled. @return its index in the bundle.
+                std::size_t add( const Program & program );
+                /// Adds an expression that does not parse. @return its index in the bundle.
+                std::size_t add( const Parser::ResultType & status );
+                /// Parses, compiles and adds an expression. @return its index in the bundle.
+                std::size_t add( BaresManager & bm, const std::string & expr );
+
+                /// Sets the three numbers of the tag of the bundle.
+                void tag( std::uint64_t a, std::uint64_t b, std::uint64_t c ) { m_tag[0] = a; m_tag[1] = b; m_tag[2] = c; }
+                /// The number of expressions added.
+                std::size_t size( void ) const { return m_entries.size(); }
+
+                /// Appends the bundle.
+                void append_to( std::string & out ) const;
+
+            private:
+                /// A directory entry, before the offsets are known.
+                struct Entry {
+                    Parser::ResultType status; //!< Its status.
+                    std::uint64_t body;        //!< Offset of its program among the bodies, or ~0 if none.
+                    std::uint32_t size;        //!< Number of instructions.
+                    std::uint32_t divisors;    //!< Number of magic divisors.
+                    std::uint64_t depth;       //!< Stack depth.
+                };
+                sc::vector< Entry > m_entries; //!< The directory.
+                std::string m_bodies;          //!< The programs, one after the other.
+                std::uint64_t m_tag[3] {};     //!< The tag.
+                Program m_program;             //!< Compiled by add( bm, expr ).
+        };
+
+        /**
+         * @brief Maps a file that holds a bundle, and checks it.
+         * @param fd the open file (which is not closed by this class).
+         * @param offset where the bundle starts in the file, a multiple of 8.
+         * @throw std::runtime_error if it cannot be mapped, or is not a valid bundle.
+         */
+        explicit ProgramBundle( int fd, std::size_t offset = 0 );
+
+        /**
+         * @brief Uses a bundle already in memory, which is neither copied nor freed, and checks it.
+         * @param data the bundle, aligned to 8 bytes.
+         * @param size bytes available from `data` on.
+         * @throw std::runtime_error if it is not a valid bundle.
+         */
+        ProgramBundle( const void * data, std::size_t size );
+
+        /// Unmaps the file, if the bundle mapped one.
+        ~ProgramBundle();
+        /// Turn off copy constructor.
+        ProgramBundle( const ProgramBundle & ) = delete;
+        /// Turn off assignment operator.
+        ProgramBundle & operator=( const ProgramBundle & ) = delete;
+
+        /// The number of expressions.
+        std::size_t size( void ) const { return m_count; }
+        /// The bytes the bundle takes.
+        std::size_t bytes( void ) const { return m_bytes; }
+        /// One of the three numbers of the tag.
+        std::uint64_t tag( std::size_t i ) const { return load< 8 >( m_data + 40 + 8 * i ); }
+        /// The minor version of the bundle.
+        std::uint16_t minor( void ) const { return static_cast< std::uint16_t >( load< 2 >( m_data + 10 ) ); }
+
+        /// The status of the i-th expression: its parse error, or what compiling it found out.
+        Parser::ResultType status( std::size_t i ) const;
+        /// Whether the i-th expression has a program (it parses).
+        bool has_program( std::size_t i ) const { return load< 8 >( entry( i ) + 8 ) != 0; }
+        /// The number of instructions of the i-th expression.
+        std::size_t instructions( std::size_t i ) const { return load< 4 >( entry( i ) + 16 ); }
+
+        /**
+         * @brief Runs the i-th expression where it lies.
+         * @return what BaresManager::evaluate() gives for it.
+         */
+        BaresManager::Result run( std::size_t i ) const;
+
+    private:
+        const unsigned char * m_data; //!< The bundle.
+        std::size_t m_bytes;          //!< Its size.
+        std::size_t m_count;          //!< Number of expressions.
+        const unsigned char * m_dir;  //!< The directory.
+        void * m_map;                 //!< The mapping, when the bundle mapped a file.
+        std::size_t m_map_size;       //!< Its size.
+
+        /// Reads a little-endian number (one load on such machines).
+        template < std::size_t Bytes >
+        static std::uint64_t load( const unsigned char * p ) {
+            std::uint64_t value {0};
+            for ( std::size_t b {0}; b < Bytes; b++ ) value |= std::uint64_t{ p[b] } << ( 8 * b );
+            return value;
+        }
+        /// The directory entry of the i-th expression.
+        const unsigned char * entry( std::size_t i ) const { return m_dir + 32 * i; }
+
+        void check( std::size_t available ); // Checks the header, the directory and every program.
+};
+
+#endif
@@ -0,0 +1,79 @@
+#ifndef _PROGRAM_CACHE_H_
+#define _PROGRAM_CACHE_H_
+
+#include <cstddef> // std::size_t
+#include <cstdint> // std::uint64_t
+
+#include "../lib/vector.h"  // class vector
+#include "program_bundle.h" // class ProgramBundle
+#include "bares_manager.h"  // class BaresManager
+#include "line_scanner.h"   // LineScanner::Line
+#include "async_io.h"       // class AsyncOutput
+
+/// The compiled programs of every line of an input file, kept in a file for the next runs.
+/*!
+ * Running the same big input again and again (with other options, another
+ * output format...) would lex, parse and compile every line every time. The
+ * cache does it once: it is a ProgramBundle with one expression per line,
+ * either the result of its parsing, when it is not valid, or its Program,
+ * ready to run. A later run maps the file in memory and runs the instructions
+ * right where they are: no text is touched.
+ *
+ * A cache is tied to its input: the tag of the bundle keeps the size and the
+ * modification time of the input file and the --max-depth of the parse, and a
+ * cache that does not match them is built again.
+ */
+class ProgramCache {
+    public:
+        /// What a cache was built from.
+        struct Source {
+            std::uint64_t size {0};      //!< Size of the input file.
+            std::uint64_t mtime {0};     //!< Its modification time, in nanoseconds.
+            std::uint64_t max_depth {0}; //!< How many parentheses could be open in an expression.
+        };
+
+        /**
+         * @brief Describes an input file.
+         * @param fd the open file.
+         * @param max_depth the limit of nested parentheses of the parser.
+         * @return its Source, all zeros if it is not a regular file.
+         */
+        static Source describe( int fd, std::size_t max_depth );
+
+        /**
+         * @brief Compiles every line and writes the cache.
+         * @param lines the lines of the input.
+         * @param source what the input is.
+         * @param bm parses and compiles the lines.
+         * @param out where the cache goes.
+         */
+        static void build( const sc::vector< LineScanner::Line > & lines, const Source & source,
+                           BaresManager & bm, AsyncOutput & out );
+
+        /**
+         * @brief Maps a cache file and checks it.
+         * @param fd the open file (which is not closed by this class).
+         * @throw std::runtime_error if it is not a bundle this program can read.
+         */
+        explicit ProgramCache( int fd ) : m_bundle{ fd } { /* empty */ }
+
+        /// Whether the cache was built from this input.
+        bool matches( const Source & source ) const;
+        /// The number of lines.
+        std::size_t lines( void ) const { return m_bundle.size(); }
+
+        /**
+         * @brief Runs every line, in order.
+         * @param sink called with the BaresManager::Result of each line.
+         */
+        template < typename Sink >
+        void for_each( Sink sink ) const {
+            for ( std::size_t i {0}; i < m_bundle.size(); i++ )
+                sink( m_bundle.run( i ) );
+        }
+
+    private:
+        ProgramBundle m_bundle; //!< The programs, mapped.
+};
+
+#endif
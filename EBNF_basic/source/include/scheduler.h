@@ -0,0 +1,134 @@
+#ifndef _SCHEDULER_H_
+#define _SCHEDULER_H_
+
+#include <atomic>      // std::atomic
+#include <condition_variable> // std::condition_variable
+#include <cstddef>     // std::size_t
+#include <deque>       // std::deque
+#include <functional>  // std::function
+#include <memory>      // std::unique_ptr
+#include <mutex>       // std::mutex
+#include <string>      // std::string
+#include <string_view> // std::string_view
+#include <thread>      // std::thread
+#include <vector>      // std::vector
+
+#include "../lib/vector.h"        // class vector
+#include "../lib/sequence_ring.h" // class sequence_ring
+#include "bares_manager.h"        // class BaresManager
+#include "line_scanner.h"         // class LineScanner
+#include "aggregate.h"            // class Aggregate
+
+/// A half-open range of input lines, [first, last).
+struct LineRange {
+    std::size_t first; //!< Index of the first line of the range.
+    std::size_t last;  //!< Index past the last line of the range.
+};
+
+/// Evaluates many expressions in parallel with a work-stealing scheduler.
+/*!
+ * Every worker owns a deque of line ranges. A worker takes ranges from the back
+ * of its own deque and, when it runs dry, steals from the front of the deque of
+ * another worker, so big ranges are stolen and small ones stay local.
+ * While a worker walks its range it keeps splitting off the upper half whenever
+ * its deque is empty or somebody is looking for work (lazy binary splitting),
+ * so long, deeply nested lines do not leave the other cores idle.
+ *
+ * Results are published in a sequence ring indexed by line number and the
+ * calling thread hands them to the sink strictly in input order. The numbering
+ * goes on from one run() to the next, so the same scheduler can run many batches.
+ * The worker threads start with the first batch and stay, parked on a condition
+ * variable, between batches, so a batch does not pay for creating threads.
+ * Lines are only given to the workers inside a window of the ring capacity
+ * ahead of the last line handed out, so no worker ever waits for a slot.
+ *
+ * aggregate() needs no order: each worker folds its results into an
+ * accumulator of its own, and those are merged once every line is done.
+ */
+class WorkStealingScheduler {
+    public:
+        /// Receives the result of each line, in input order.
+        using sink_type = std::function< void( std::size_t, const BaresManager::Result & ) >;
+
+        /**
+         * @brief Creates a scheduler.
+         * @param workers number of worker threads, 0 means one per hardware thread.
+         * @param max_depth how many parentheses may be open at the same time in an expression.
+         * @param grain ranges up to this many lines are not split any further.
+         * @param window how many lines may be in flight ahead of the output (a power of two).
+         */
+        explicit WorkStealingScheduler( std::size_t workers = 0,
+                                        std::size_t max_depth = Parser::DEFAULT_MAX_DEPTH,
+                                        std::size_t grain = 8, std::size_t window = 1u << 16 );
+
+        /// Stops the worker threads.
+        ~WorkStealingScheduler();
+        /// Turn off copy constructor.
+        WorkStealingScheduler( const WorkStealingScheduler & ) = delete;
+        /// Turn off assignment operator.
+        WorkStealingScheduler & operator=( const WorkStealingScheduler & ) = delete;
+
+        /**
+         * @brief Evaluates all the lines and hands each result to the sink, in order.
+         * @param lines the expressions to evaluate, as split_lines() gives them.
+         * @param sink called by the calling thread for every line, in input order.
+         */
+        void run( const sc::vector< LineScanner::Line > & lines, const sink_type & sink );
+
+        /**
+         * @brief Evaluates all the lines and folds the results, in no particular order.
+         * @param lines the expressions to evaluate, as split_lines() gives them.
+         * @param parts the Aggregate::Part flags of what to keep.
+         * @return the results of all workers, merged.
+         */
+        Aggregate aggregate( const sc::vector< LineScanner::Line > & lines, unsigned parts );
+
+        /**
+         * @brief Splits a text into lines, the same way std::getline() does.
+         * @param text the text, which must outlive the returned views.
+         * @return the lines, without the line breaks, each with its first byte outside the alphabet.
+         */
+        static sc::vector< LineScanner::Line > split_lines( const std::string & text );
+
+        /// The number of worker threads.
+        std::size_t workers( void ) const { return m_n_workers; }
+
+    private:
+        /// The state owned by each worker thread.
+        struct Worker {
+            std::mutex lock;                 //!< Protects the deque.
+            std::deque< LineRange > tasks;   //!< The ranges waiting to be processed.
+            std::atomic< std::size_t > size; //!< Number of ranges in the deque, read without the lock.
+            BaresManager manager;            //!< Each worker evaluates with its own manager.
+            Aggregate totals;                //!< What the worker has folded, in aggregate().
+        };
+
+        std::size_t m_n_workers;                              //!< Number of worker threads.
+        std::unique_ptr< Worker[] > m_workers;                //!< One entry per worker thread.
+        std::size_t m_grain;                                  //!< Ranges up to this size are not split.
+        sc::sequence_ring< BaresManager::Result > m_ring;     //!< Where the results wait to be written.
+        std::size_t m_base;                                   //!< Sequence number of line 0 in the ring (the lines of the runs before).
+        const sc::vector< LineScanner::Line > * m_lines;      //!< The lines of the current run.
+        std::atomic< std::size_t > m_thieves;                 //!< How many workers are looking for work.
+        std::atomic< std::size_t > m_folded;                  //!< Lines folded so far, in aggregate().
+        bool m_aggregating;                                   //!< Whether the workers fold instead of publishing.
+        std::atomic< bool > m_done;                           //!< Tells the workers to finish.
+        std::vector< std::thread > m_threads;                 //!< The workers, started by the first batch.
+        std::mutex m_park_lock;                               //!< Protects m_round, m_busy and m_quit.
+        std::condition_variable m_wake;                       //!< Wakes the parked workers for a batch.
+        std::condition_variable m_idle;                       //!< Tells that every worker is parked again.
+        std::size_t m_round;                                  //!< Number of batches started.
+        std::size_t m_busy;                                   //!< Workers not parked yet since the last start.
+        bool m_quit;                                          //!< Tells the workers to exit.
+
+        void park( std::size_t id );                     // The life of a worker thread: a batch each time it wakes.
+        void start( void );                              // Wakes the workers for a batch.
+        void finish( void );                             // Ends the batch and waits for the workers to park.
+        void work( std::size_t id );                     // The loop of a worker thread.
+        void process( std::size_t id, LineRange range ); // Evaluates a range, splitting it on demand.
+        void push( std::size_t id, LineRange range );    // Pushes a range at the back of a deque.
+        bool pop( std::size_t id, LineRange & range );   // Takes a range from the back of the own deque.
+        bool steal( std::size_t id, LineRange & range ); // Takes a range from the front of other deques.
+};
+
+#endif
@@ -0,0 +1,119 @@
+#ifndef _SERVER_H_
+#define _SERVER_H_
+
+#include <cstddef> // std::size_t
+#include <cstdint> // std::uint32_t, std::uint64_t
+#include <memory>  // std::unique_ptr
+#include <string>  // std::string
+#include <vector>  // std::vector
+
+#include "../lib/vector.h"  // class vector
+#include "bares_manager.h"  // class BaresManager
+#include "scheduler.h"      // class WorkStealingScheduler
+#include "line_scanner.h"   // LineScanner::Line
+#include "latency.h"        // class LatencyHistogram
+
+/// Evaluates the requests of local clients, which connect to a Unix domain socket.
+/*!
+ * A single thread runs an event loop on epoll (level-triggered): it accepts
+ * the clients, reads what each one sent, and writes back the responses that
+ * are ready, without ever blocking on a slow client. The protocol is the one
+ * of wire.h.
+ *
+ * Each round of the loop reads every client that has something to send, then
+ * takes all the whole requests it got, from all the clients, as one batch:
+ * a big batch is shared among the threads of a WorkStealingScheduler, a small
+ * one is evaluated by the loop itself. Each client then gets the responses to
+ * its requests, in order.
+ *
+ * Each connection keeps its own buffers (its arena): the bytes it sent, where
+ * the requests are evaluated in place, and the responses it has not taken yet.
+ * They only grow, are reused from one round to the next, and go to the next
+ * client of the slot. A client that does not read its responses is not read
+ * either while more than OUT_LIMIT bytes wait for it.
+ *
+ * The latency of a request goes from the round that read it to the moment its
+ * response is ready to be sent. Their percentiles are given to the clients
+ * that ask (wire::STATS) and written to std::cerr when the server stops, on
+ * SIGINT or SIGTERM.
+ */
+class EvalServer {
+    public:
+        static constexpr std::size_t OUT_LIMIT = 1u << 20; //!< Bytes waiting for a client that stop reading it.
+
+        /**
+         * @brief Creates the socket and starts listening on it.
+         * @param path where the socket is made; a socket left there by a server that stopped is removed.
+         * @param threads evaluator threads of the big batches, 0 means one per hardware thread.
+         * @param max_depth how many parentheses may be open at the same time in an expression.
+         * @param parallel_batch batches of at least this many requests go to the threads (when there are more than one).
+         * @throw std::runtime_error if the socket cannot be made.
+         */
+        explicit EvalServer( std::string path, std::size_t threads = 1,
+                             std::size_t max_depth = Parser::DEFAULT_MAX_DEPTH, std::size_t parallel_batch = 256 );
+        /// Closes every connection and removes the socket.
+        ~EvalServer();
+        /// Turn off copy constructor.
+        EvalServer( const EvalServer & ) = delete;
+        /// Turn off assignment operator.
+        EvalServer & operator=( const EvalServer & ) = delete;
+
+        /// Serves the clients until SIGINT or SIGTERM.
+        void run( void );
+
+        /// The latencies of the requests answered so far.
+        const LatencyHistogram & latency( void ) const { return m_latency; }
+        /// The number of batches evaluated so far.
+        std::uint64_t batches( void ) const { return m_batches; }
+
+    private:
+        /// A client.
+        struct Connection {
+            int fd {-1};              //!< Its socket, -1 for a free slot.
+            std::string in;           //!< The bytes it sent that are not answered yet, then free space.
+            std::size_t filled {0};   //!< How many bytes of `in` it sent.
+            std::size_t framed {0};   //!< How many of them were taken as requests.
+            std::string out;          //!< The responses it has not taken yet.
+            std::size_t sent {0};     //!< How many of them were sent.
+            std::uint32_t events {0}; //!< What epoll watches for it.
+            bool eof {false};         //!< Whether it sends nothing else.
+            bool broken {false};      //!< Whether it is closed without sending what is left.
+            bool touched {false};     //!< Whether it is in m_touched.
+        };
+
+        /// A whole request of the current batch.
+        struct Request {
+            std::size_t conn;      //!< The slot of the connection.
+            std::size_t line;      //!< The index in m_lines, or STATS.
+            std::uint64_t arrived; //!< When it was read, in nanoseconds.
+        };
+        static constexpr std::size_t STATS = static_cast< std::size_t >( -1 ); //!< A Request for the latencies.
+
+        std::string m_path;                   //!< Where the socket is.
+        int m_listen {-1};                    //!< The listening socket.
+        int m_epoll {-1};                     //!< The epoll instance.
+        int m_signals {-1};                   //!< The signalfd of SIGINT and SIGTERM.
+        std::size_t m_parallel_batch;         //!< Smallest batch given to the threads.
+        BaresManager m_bm;                    //!< Evaluates the small batches.
+        std::unique_ptr< WorkStealingScheduler > m_scheduler; //!< Evaluates the big batches, null with one thread.
+        std::vector< std::unique_ptr< Connection > > m_conns; //!< The clients, by slot.
+        std::vector< std::size_t > m_free;    //!< The free slots.
+        std::vector< std::size_t > m_touched; //!< The connections read or written in this round.
+        std::vector< Request > m_requests;    //!< The requests of the batch, in order of arrival.
+        sc::vector< LineScanner::Line > m_lines; //!< Their expressions, in the `in` of their connections.
+        std::vector< BaresManager::Result > m_results; //!< The result of each line.
+        std::string m_expr;                   //!< An expression being evaluated by the loop.
+        LatencyHistogram m_latency;           //!< The latencies of the requests answered so far.
+        std::uint64_t m_batches {0};          //!< The number of batches.
+
+        void release( void );                      // Closes what is open and removes the socket.
+        void accept_all( void );                   // Accepts the clients that are waiting.
+        void receive( std::size_t c, std::uint64_t now ); // Reads a client and takes its whole requests.
+        void evaluate( void );                     // Evaluates the lines of the batch.
+        void respond( void );                      // Appends the response of each request.
+        void flush( std::size_t c );               // Sends what a client may take, and watches it again.
+        void touch( std::size_t c );               // Adds a connection to m_touched.
+        void close_conn( std::size_t c );          // Closes a connection and frees its slot.
+};
+
+#endif
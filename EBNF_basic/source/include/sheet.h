@@ -0,0 +1,169 @@
+#ifndef _SHEET_H_
+#define _SHEET_H_
+
+#include <cstddef>       // std::size_t
+#include <cstdint>       // std::uint8_t, std::uint32_t
+#include <string>        // std::string
+#include <string_view>   // std::string_view
+#include <unordered_map> // std::unordered_map
+#include <vector>        // std::vector
+
+#include "bares_manager.h" // class BaresManager
+#include "parser.h"        // Parser::ResultType
+
+/// Named expressions that refer to each other, kept up to date.
+/*!
+ * Each definition gives a name to an expression, which may use the names of
+ * other definitions as operands: `a = 3*b + 2`. A name stands for the value
+ * of its definition, which must be a valid result (in the range of the
+ * required type), exactly as if that value had been written in its place.
+ *
+ * A definition is parsed once, when it is set: every name is replaced by a
+ * one digit literal of the same width, so the Parser checks the syntax (and
+ * reports the same columns) and the names become slots in the postfix list.
+ * The definitions and the names they use make a dependency graph. Its cycles
+ * are found with Tarjan's algorithm, and a definition in a cycle has no value
+ * (without looking at its inputs). With each cycle taken as a single node the
+ * graph is a DAG, and each definition gets the level of the longest path that
+ * reaches it, so all the definitions of a level only use lower levels and can
+ * be computed at the same time. A change
+ * to the names a definition uses only moves the levels downstream of it,
+ * unless it may close or open a cycle, or too many changes come in a row:
+ * then the whole graph is searched again.
+ *
+ * recompute() only computes what is dirty: the definitions that were set,
+ * then, level by level, those that use a definition whose value changed.
+ * When a level has enough work, it is shared among threads, which meet at a
+ * barrier before the next level.
+ */
+class Sheet {
+    public:
+        /// Why a definition has no value, other than the result of its expression.
+        enum class Issue : std::uint8_t {
+            NONE = 0,  //!< The result of its expression stands (which may be an error).
+            UNDEFINED, //!< It uses a name that is not defined.
+            CYCLE,     //!< It uses itself, through other definitions or not.
+            NO_VALUE   //!< It uses a definition that has no value.
+        };
+
+        /// What a definition came to.
+        struct Cell {
+            Issue issue {Issue::UNDEFINED}; //!< Why there is no value, besides the result.
+            BaresManager::Result result { Parser::ResultType{ Parser::ResultType::OK }, 0 }; //!< The result of the expression.
+            std::size_t at_col {0};         //!< Column of the name that is undefined or has no value.
+            std::size_t other {0};          //!< Index of that name.
+
+            /// Whether there is a value that other definitions can use.
+            bool has_value( void ) const {
+                return issue == Issue::NONE and result.status.type == Parser::ResultType::OK;
+            }
+            bool operator==( const Cell & rhs ) const {
+                return issue == rhs.issue and result.status.type == rhs.result.status.type
+                       and result.status.at_col == rhs.result.status.at_col and result.value == rhs.result.value
+                       and at_col == rhs.at_col and other == rhs.other;
+            }
+        };
+
+        static constexpr std::size_t npos = static_cast< std::size_t >( -1 ); //!< No such name.
+
+        /**
+         * @brief Creates an empty sheet.
+         * @param threads how many threads recompute() may use (0 = one per core).
+         * @param max_depth how many parentheses may be open in an expression.
+         */
+        explicit Sheet( std::size_t threads = 1, std::size_t max_depth = Parser::DEFAULT_MAX_DEPTH );
+
+        /**
+         * @brief Splits a line of the form `name = expression`.
+         * @param line the line.
+         * @param name receives the name.
+         * @param expr_at receives where the expression starts in the line.
+         * @return false if the line is not a definition.
+         */
+        static bool split_definition( std::string_view line, std::string_view & name, std::size_t & expr_at );
+
+        /**
+         * @brief Defines a name, or changes its definition; nothing is computed until recompute().
+         * @param name the name, a letter or "_" followed by letters, digits and "_".
+         * @param expr its expression.
+         * @param col the column of the expression in the line it came from, added to those reported.
+         * @return the index of the name.
+         */
+        std::size_t set( std::string_view name, std::string_view expr, std::size_t col = 0 );
+
+        /**
+         * @brief Computes the definitions that were set, and those that depend on a value that changes.
+         * @return how many definitions were computed.
+         */
+        std::size_t recompute( void );
+
+        /// The number of names, defined or only used.
+        std::size_t size( void ) const { return m_nodes.size(); }
+        /// The index of a name, or npos.
+        std::size_t find( std::string_view name ) const;
+        /// The i-th name.
+        const std::string & name( std::size_t i ) const { return m_nodes[i].name; }
+        /// Whether the i-th name has a definition.
+        bool defined( std::size_t i ) const { return m_nodes[i].defined; }
+        /// What the i-th definition came to at the last recompute().
+        const Cell & cell( std::size_t i ) const { return m_nodes[i].cell; }
+        /// Whether the last recompute() changed the i-th definition.
+        bool changed( std::size_t i ) const { return m_nodes[i].changed == m_round; }
+        /// The number of levels of the graph.
+        std::size_t levels( void ) const { return m_buckets.size(); }
+
+        /**
+         * @brief Appends the line that shows a definition: "name = value", or the name and why it has none.
+         * @param i the index of the name.
+         * @param out the string that receives the text, including the line break.
+         */
+        void append_cell( std::size_t i, std::string & out ) const;
+
+    private:
+        /// An element of a postfix list: an operand (a literal or a name) or an operator.
+        struct Term {
+            Parser::input_int_type value; //!< The literal, when it is not a name.
+            std::uint32_t input;          //!< Position of the name in Node::inputs, or NO_INPUT.
+            char op;                      //!< The operator, or 0 for an operand.
+            bool negate;                  //!< Whether the name came with an unary minus.
+        };
+        static constexpr std::uint32_t NO_INPUT = static_cast< std::uint32_t >( -1 ); //!< A Term that is a literal.
+
+        /// A name, and its definition.
+        struct Node {
+            std::string name;                //!< The name.
+            bool defined {false};            //!< Whether it has a definition (or is only used by others).
+            Parser::ResultType status;       //!< How its expression parsed.
+            std::vector< Term > terms;       //!< The postfix list of its expression.
+            std::size_t depth {0};           //!< Most operands on the stack while computing it.
+            std::vector< std::size_t > inputs;     //!< The names it uses, each once.
+            std::vector< std::size_t > input_cols; //!< The column of the first use of each input.
+            std::vector< std::size_t > outputs;    //!< The definitions that use it.
+            bool in_cycle {false};           //!< Whether it is in a cycle.
+            bool dirty {false};              //!< Whether it must be computed at the next recompute().
+            bool queued {false};             //!< Whether it is in the bucket of its level.
+            std::size_t level {0};           //!< Length of the longest path that reaches it.
+            std::size_t changed {0};         //!< The last round that changed its cell.
+            std::size_t seen {0};            //!< The last search of relink() that reached it.
+            Cell cell;                       //!< What it came to.
+        };
+
+        std::size_t m_n_threads;           //!< Threads of recompute().
+        BaresManager m_bm;                 //!< Parses the definitions.
+        std::vector< Node > m_nodes;       //!< Every name.
+        std::unordered_map< std::string, std::size_t > m_index; //!< Index of each name.
+        bool m_reshaped {false};           //!< Whether the graph changed in a way only reshape() handles.
+        std::size_t m_work {0};            //!< Nodes relink() visited since the last reshape().
+        std::size_t m_search {0};          //!< Number of searches of relink().
+        std::vector< std::vector< std::size_t > > m_buckets; //!< The dirty nodes of each level.
+        std::vector< std::size_t > m_dirty; //!< The nodes set since the last recompute().
+        std::size_t m_round {0};           //!< Number of recompute() calls.
+
+        std::size_t intern( std::string_view name ); // The index of a name, added if new.
+        void reshape( void );                          // Finds the cycles and the levels again.
+        void relink( std::size_t n, std::vector< std::size_t > inputs ); // Changes the names a definition uses.
+        void compute( std::size_t n );                 // Computes one definition.
+        void schedule( std::size_t n );                // Puts a node in the bucket of its level.
+};
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef _SPLIT_EVALUATOR_H_
+#define _SPLIT_EVALUATOR_H_
+
+#include <cstddef> // std::size_t
+#include <string>  // std::string
+
+#include "../lib/vector.h" // class vector
+#include "parser.h"        // Parser::DEFAULT_MAX_DEPTH
+#include "paren_index.h"   // class ParenIndex
+#include "bares_manager.h" // class BaresManager
+
+/// Evaluates a single very long expression on several threads.
+/*!
+ * The terms joined by "+" and "-" outside any parenthesis are the lowest
+ * precedence level of an expression, so cutting a line right before some of
+ * these operators gives pieces that can be parsed and computed on their own.
+ * The parenthesis index tells which operators are outside every parenthesis.
+ * Each piece after the first is computed as `0 <op> <rest of the piece>`, so
+ * its operator comes along, and the values of the pieces are simply added up
+ * (the sums wrap around exactly like the operations of the whole expression).
+ *
+ * The results are the same as BaresManager::evaluate() on the whole line:
+ * - A piece that does not parse means the line does not either. The whole line
+ *   is then parsed again, one thread, to report the error at the right column.
+ * - The final value is checked against the range only once, at the end.
+ * - A division by zero takes the result of the operation before it. When that
+ *   operation could be in another piece (see BaresManager::evaluate_piece()),
+ *   the whole line is computed again on one thread.
+ *
+ * Lines shorter than `min_length`, or without such operators, are evaluated
+ * the usual way.
+ */
+class SplitEvaluator {
+    public:
+        /**
+         * @brief Creates an evaluator.
+         * @param threads how many pieces to compute at the same time, 0 means one per hardware thread.
+         * @param max_depth how many parentheses may be open at the same time in an expression.
+         * @param min_length lines shorter than this (in bytes) are not split.
+         */
+        explicit SplitEvaluator( std::size_t threads = 0, std::size_t max_depth = Parser::DEFAULT_MAX_DEPTH,
+                                 std::size_t min_length = 1u << 16 );
+
+        /**
+         * @brief Parse and compute an expression, in pieces if it is long enough.
+         * @param expr the expression.
+         * @return the same result BaresManager::evaluate() gives.
+         */
+        BaresManager::Result evaluate( const std::string & expr );
+
+        /// How many pieces the last expression was split into (1 if it was not).
+        std::size_t pieces( void ) const { return m_cuts.size() + 1; }
+
+    private:
+        std::size_t m_n_threads;           //!< How many pieces to compute at the same time.
+        std::size_t m_max_depth;           //!< How many parentheses may be open at the same time.
+        std::size_t m_min_length;          //!< Shorter lines are not split.
+        BaresManager m_manager;            //!< Evaluates the lines that are not split, and the fallbacks.
+        ParenIndex m_parens;               //!< The parentheses of the current line.
+        sc::vector< std::size_t > m_cuts;  //!< Positions of the operators the line is cut before.
+
+        void find_cuts( const std::string & expr ); // Picks the operators to cut at.
+};
+
+#endif
@@ -0,0 +1,91 @@
+#ifndef _STREAM_PARSER_H_
+#define _STREAM_PARSER_H_
+
+#include <cstddef>     // std::size_t
+#include <functional>  // std::function
+#include <string_view> // std::string_view
+
+#include "../lib/stack.h"  // class stack
+#include "parser.h"        // Parser::ResultType
+#include "bares_manager.h" // BaresManager::Result
+
+/// Parses and evaluates expressions that arrive in pieces of any size.
+/*!
+ * Parser::parse_and_tokenize() needs a whole line in a string. This class is a
+ * state machine instead: it takes the input one chunk at a time, the chunks may
+ * break the text anywhere (inside a number, inside nested parentheses, between
+ * the "\r" and the "\n"), and it hands out the result of each line as soon as its
+ * line break arrives.
+ *
+ * Nothing of the line is kept: tokens go straight into an operator stack and an
+ * operand stack (shunting-yard), which only grow with the nesting depth, so the
+ * memory does not depend on the length of the lines.
+ *
+ * The results, including the error codes and columns, are the same that
+ * BaresManager::evaluate() gives for the same line.
+ */
+class StreamParser {
+    public:
+        /// Receives the result of each line, in input order.
+        using sink_type = std::function< void( const BaresManager::Result & ) >;
+
+        /**
+         * @brief Creates a parser waiting for the first line.
+         * @param max_depth how many parentheses may be open at the same time.
+         */
+        explicit StreamParser( std::size_t max_depth = Parser::DEFAULT_MAX_DEPTH );
+
+        /**
+         * @brief Parses the next piece of the input.
+         * @param chunk the bytes, which do not need to outlive the call.
+         * @param sink called with the result of every line completed by this chunk.
+         */
+        void feed( std::string_view chunk, const sink_type & sink );
+
+        /**
+         * @brief Ends the input, the same way std::getline() does.
+         * @param sink called with the result of the last line, if it had no line break.
+         */
+        void finish( const sink_type & sink );
+
+    private:
+        /// What the parser expects at the current position.
+        enum class state_t {
+            TERM,   //!< The beginning of a term (at the start, after an operator or after a "(").
+            MINUS,  //!< The rest of a term that began with a "-".
+            NUMBER, //!< More digits of a number.
+            AFTER,  //!< An operator, a ")" or the end, after a whole term.
+            FAILED  //!< Nothing: the line has an error, skip to its end.
+        };
+
+        using size_type = Parser::ResultType::size_type;
+        using code_t = Parser::ResultType::code_t;
+
+        std::size_t m_max_depth;                   //!< How many parentheses may be open at the same time.
+        state_t m_state;                           //!< What comes next.
+        size_type m_col;                           //!< Column of the current byte in the line.
+        size_type m_begin;                         //!< Column where the last token began (Parser's begin_token()).
+        bool m_at_start;                           //!< Whether the line has been only white space so far.
+        bool m_after_op;                           //!< Whether the current term follows an operator.
+        bool m_outer_after_op;                     //!< Whether the outermost "(" follows an operator.
+        std::size_t m_depth;                       //!< Number of open parentheses.
+        bool m_negative;                           //!< Whether the number being read began with a "-".
+        Parser::input_int_type m_number;           //!< Absolute value of the number being read (capped).
+        Parser::ResultType m_result;               //!< The error of the line, if any.
+        sta::stack< char > m_operators;            //!< Pending operators and open parentheses.
+        sta::stack< Parser::input_int_type > m_operands; //!< Values computed so far.
+        Parser::input_int_type m_last;             //!< Result of the last operation.
+        bool m_division_by_zero;                   //!< Whether some division by zero happened.
+
+        void reset( void );                                    // Gets ready for a new line.
+        void step( char c );                                   // Consumes one byte of a line.
+        void end_line( const sink_type & sink );               // Finishes the current line.
+        bool end_number( void );                               // Pushes the number just read.
+        void fail( code_t code, size_type col, std::size_t level ); // Records an error.
+        void reduce( void );                                   // Applies the operator on top of the stack.
+        void push_operator( char op );                         // Pushes an operator, applying those it beats.
+        void open_parenthesis( void );                         // Opens a nested expression.
+        void close_parenthesis( void );                        // Applies everything back to the "(".
+};
+
+#endif
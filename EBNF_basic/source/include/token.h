@@ -1,6 +1,7 @@
 #ifndef _TOKEN_H_
 #define _TOKEN_H_
 
+#include <cstddef>  // std::size_t
 #include <string>   // std::string
 #include <iostream> // std::ostream
 
@@ -24,11 +25,13 @@ struct Token
 
         std::string value; //!< The token value as a string.
         token_t type;      //!< The token type, which is either token_t::OPERAND or token_t::OPERATOR.
+        std::size_t col;   //!< Column of the token in the expression, for compile time diagnostics.
 
         /// Construtor default.
-        explicit Token( std::string value_="", token_t type_ = token_t::OPERAND )
+        explicit Token( std::string value_="", token_t type_ = token_t::OPERAND, std::size_t col_ = 0 )
             : value( value_ )
             , type( type_ )
+            , col( col_ )
         {/* empty */}
 
         /// Just to help us debug the code.
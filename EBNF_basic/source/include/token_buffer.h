@@ -0,0 +1,99 @@
+#ifndef _TOKEN_BUFFER_H_
+#define _TOKEN_BUFFER_H_
+
+#include <cstddef> // std::size_t
+#include <cstdint> // std::uint8_t, std::int64_t, std::uint32_t
+#include <string>  // std::to_string
+
+#include "../lib/vector.h" // class vector
+#include "token.h"         // struct Token
+
+/// A list of tokens kept as a structure of arrays.
+/*!
+ * Instead of one Token (a string, a type and a column) per element, the kind,
+ * the value and the column of every token live in three separate arrays. An
+ * operand keeps its value already converted to an integer, an operator or a
+ * parenthesis keeps its symbol. The passes that walk the list read only the
+ * arrays they need (the calculation never touches the columns), a few bytes
+ * per token with nothing to convert and no string to copy.
+ */
+class TokenBuffer {
+    public:
+        using kind_type = std::uint8_t;   //!< How a Token::token_t is stored.
+        using value_type = std::int64_t;  //!< The value of an operand, or the symbol of any other token.
+        using col_type = std::uint32_t;   //!< The column of a token in the expression.
+
+        /// The number of tokens.
+        std::size_t size( void ) const { return m_kind.size(); }
+        /// Whether there is no token at all.
+        bool empty( void ) const { return m_kind.empty(); }
+
+        /// Removes every token, keeping the memory for the next expression.
+        void clear( void ) {
+            m_kind.clear();
+            m_value.clear();
+            m_col.clear();
+        }
+
+        /// Makes room for `n` tokens.
+        void reserve( std::size_t n ) {
+            m_kind.reserve( n );
+            m_value.reserve( n );
+            m_col.reserve( n );
+        }
+
+        /**
+         * @brief Appends a token.
+         * @param kind the type of the token.
+         * @param value the value of an operand, or the symbol of any other token.
+         * @param col the column of the token in the expression.
+         */
+        void push( Token::token_t kind, value_type value, std::size_t col ) {
+            m_kind.push_back( static_cast< kind_type >( kind ) );
+            m_value.push_back( value );
+            m_col.push_back( static_cast< col_type >( col ) );
+        }
+
+        /// Appends the token at position `i` of another buffer.
+        void push( const TokenBuffer & other, std::size_t i ) {
+            m_kind.push_back( other.m_kind[i] );
+            m_value.push_back( other.m_value[i] );
+            m_col.push_back( other.m_col[i] );
+        }
+
+        /// Replaces the tokens by a copy of another buffer's, reusing the memory already there.
+        void assign( const TokenBuffer & other ) {
+            clear();
+            reserve( other.size() );
+            for ( std::size_t i {0}; i < other.size(); i++ ) push( other, i );
+        }
+
+        /// The type of the token at position `i`.
+        Token::token_t kind( std::size_t i ) const { return static_cast< Token::token_t >( m_kind[i] ); }
+        /// The value of the operand at position `i`, or the symbol of the token there.
+        value_type value( std::size_t i ) const { return m_value[i]; }
+        /// The symbol of the operator (or parenthesis) at position `i`.
+        char symbol( std::size_t i ) const { return static_cast< char >( m_value[i] ); }
+        /// The column of the token at position `i`.
+        std::size_t col( std::size_t i ) const { return m_col[i]; }
+
+        /// The token at position `i` as a Token, to print it.
+        Token token( std::size_t i ) const {
+            return Token{ kind( i ) == Token::token_t::OPERAND ? std::to_string( m_value[i] ) : std::string( 1, symbol( i ) ),
+                          kind( i ), col( i ) };
+        }
+
+        /// Exchanges the tokens of two buffers.
+        friend void swap( TokenBuffer & first_, TokenBuffer & second_ ) {
+            swap( first_.m_kind, second_.m_kind );
+            swap( first_.m_value, second_.m_value );
+            swap( first_.m_col, second_.m_col );
+        }
+
+    private:
+        sc::vector< kind_type > m_kind;   //!< The type of each token.
+        sc::vector< value_type > m_value; //!< The value of each operand, the symbol of each other token.
+        sc::vector< col_type > m_col;     //!< The column of each token.
+};
+
+#endif
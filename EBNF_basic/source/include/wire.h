@@ -0,0 +1,83 @@
+#ifndef _WIRE_H_
+#define _WIRE_H_
+
+#include <cstddef>     // std::size_t
+#include <cstdint>     // std::uint32_t, std::uint64_t
+#include <string>      // std::string
+#include <string_view> // std::string_view
+
+#include "parser.h"        // Parser::ResultType
+#include "bares_manager.h" // BaresManager::Result
+
+/// The protocol of EvalServer: frames that start with their length.
+/*!
+ * Every number is little-endian. A client sends requests, one after the other
+ * without waiting, and gets one response for each, in the order it sent them.
+ *
+ * A request:
+ * | size | field                                                       |
+ * |------|-------------------------------------------------------------|
+ * | 4    | N, the length of the expression (at most MAX_REQUEST)       |
+ * | N    | the expression, without a line break                        |
+ *
+ * A request with N = STATS has no expression: it asks for the latencies the
+ * server has measured so far.
+ *
+ * A response:
+ * | size | field                                                       |
+ * |------|-------------------------------------------------------------|
+ * | 4    | M, the length of the rest (RESULT_SIZE for a result)        |
+ * | 2    | int16, the value (0 if none)                                |
+ * | 1    | uint8, the Parser::ResultType::code_t                       |
+ * | 1    | 0                                                           |
+ * | 4    | uint32, the column (from 0) of a syntax error, 0 otherwise  |
+ *
+ * The response to STATS is M bytes of text instead, the line of
+ * LatencyHistogram::append_summary().
+ */
+namespace wire {
+    constexpr std::uint32_t STATS = 0xFFFFFFFF;    //!< The length of a request for the latencies.
+    constexpr std::uint32_t MAX_REQUEST = 1u << 26; //!< The longest expression a request may carry.
+    constexpr std::size_t LENGTH_SIZE = 4;          //!< Bytes of the length that starts a frame.
+    constexpr std::size_t RESULT_SIZE = 8;          //!< Bytes of a result, after its length.
+
+    /// Appends an unsigned integer of `Bytes` bytes, little-endian.
+    template < std::size_t Bytes >
+    inline void put( std::uint64_t value, std::string & out ) {
+        for ( std::size_t i {0}; i < Bytes; i++ )
+            out += static_cast< char >( value >> ( 8 * i ) & 0xFF );
+    }
+
+    /// Reads an unsigned integer of `Bytes` bytes, little-endian.
+    template < std::size_t Bytes >
+    inline std::uint64_t get( const char * p ) {
+        std::uint64_t value {0};
+        for ( std::size_t i {0}; i < Bytes; i++ )
+            value |= std::uint64_t{ static_cast< unsigned char >( p[i] ) } << ( 8 * i );
+        return value;
+    }
+
+    /// Appends the request of an expression.
+    inline void append_request( std::string_view expr, std::string & out ) {
+        put< 4 >( expr.size(), out );
+        out.append( expr.data(), expr.size() );
+    }
+
+    /// Appends the response of a result.
+    inline void append_result( const BaresManager::Result & res, std::string & out ) {
+        put< 4 >( RESULT_SIZE, out );
+        put< 2 >( static_cast< std::uint16_t >( res.value ), out );
+        put< 1 >( res.status.type, out );
+        put< 1 >( 0, out );
+        put< 4 >( BaresManager::has_column( res.status.type ) ? res.status.at_col : 0, out );
+    }
+
+    /// Reads a result, from the RESULT_SIZE bytes after its length.
+    inline BaresManager::Result read_result( const char * p ) {
+        const auto code = static_cast< Parser::ResultType::code_t >( get< 1 >( p + 2 ) );
+        return BaresManager::Result{ Parser::ResultType{ code, static_cast< Parser::ResultType::size_type >( get< 4 >( p + 4 ) ) },
+                                     static_cast< Parser::required_int_type >( get< 2 >( p ) ) };
+    }
+}
+
+#endif
@@ -0,0 +1,210 @@
+#ifndef _RING_QUEUE_H_
+#define _RING_QUEUE_H_
+
+#include <atomic>    // std::atomic
+#include <memory>    // std::unique_ptr
+#include <thread>    // std::this_thread::yield
+#include <cstddef>   // std::size_t
+#include <stdexcept> // std::invalid_argument
+
+/// Sequence container namespace.
+namespace sc {
+
+    /// A bounded lock-free queue for exactly one producer and one consumer thread.
+    /*!
+     * The producer only writes the tail and the consumer only writes the head,
+     * so a push or a pop is a couple of loads and one release store.
+     * Each side keeps a cached copy of the other index to avoid touching the
+     * other side's cache line on every operation.
+     *
+     * \tparam T The type of the elements, which must be default constructible.
+     */
+    template < typename T >
+    class spsc_ring
+    {
+        //=== Aliases
+        public:
+            using size_type = std::size_t; //!< The size type.
+            using value_type = T;          //!< The value type.
+
+        public:
+            /**
+             * @brief Constructs an empty queue.
+             * @param capacity the maximum number of elements, must be a power of two.
+             */
+            explicit spsc_ring( size_type capacity )
+                : m_mask {capacity - 1},
+                  m_storage {new T[capacity]} {
+                if ( capacity == 0 or ( capacity & m_mask ) != 0 )
+                    throw std::invalid_argument("spsc_ring(): capacity must be a power of two");
+            }
+
+            /// Turn off copy constructor.
+            spsc_ring( const spsc_ring & ) = delete;
+            /// Turn off assignment operator.
+            spsc_ring & operator=( const spsc_ring & ) = delete;
+
+            /**
+             * @brief Adds an element at the end of the queue, if there is room (producer side).
+             * @return true if the element was added; false if the queue is full.
+             */
+            bool try_push( T value ) {
+                const size_type tail = m_tail.load( std::memory_order_relaxed );
+                if ( tail - m_head_cache > m_mask ) {
+                    m_head_cache = m_head.load( std::memory_order_acquire );
+                    if ( tail - m_head_cache > m_mask ) return false;
+                }
+                m_storage[tail & m_mask] = std::move( value );
+                m_tail.store( tail + 1, std::memory_order_release );
+                return true;
+            }
+
+            /**
+             * @brief Removes the first element of the queue, if any (consumer side).
+             * @return true if an element was removed; false if the queue is empty.
+             */
+            bool try_pop( T & value ) {
+                const size_type head = m_head.load( std::memory_order_relaxed );
+                if ( head == m_tail_cache ) {
+                    m_tail_cache = m_tail.load( std::memory_order_acquire );
+                    if ( head == m_tail_cache ) return false;
+                }
+                value = std::move( m_storage[head & m_mask] );
+                m_head.store( head + 1, std::memory_order_release );
+                return true;
+            }
+
+            /// Adds an element, waiting while the queue is full (backpressure).
+            void push( T value ) {
+                while ( not try_push( value ) ) std::this_thread::yield();
+            }
+
+            /// Removes the first element, waiting while the queue is empty.
+            T pop( void ) {
+                T value;
+                while ( not try_pop( value ) ) std::this_thread::yield();
+                return value;
+            }
+
+        private:
+            size_type m_mask;                                   //!< Capacity minus one.
+            std::unique_ptr<T[]> m_storage;                     //!< The elements.
+            alignas(64) std::atomic< size_type > m_head {0};    //!< Next element to pop (written by the consumer).
+            size_type m_tail_cache {0};                         //!< Consumer's copy of the tail.
+            alignas(64) std::atomic< size_type > m_tail {0};    //!< Next free position (written by the producer).
+            size_type m_head_cache {0};                         //!< Producer's copy of the head.
+    };
+
+    /// A bounded lock-free queue for many producer and many consumer threads.
+    /*!
+     * This is Dmitry Vyukov's bounded MPMC queue: every cell has a sequence stamp,
+     * producers and consumers claim positions with a compare-and-swap on their own
+     * counter and then wait for nobody; a full or empty queue is reported at once.
+     *
+     * \tparam T The type of the elements, which must be default constructible.
+     */
+    template < typename T >
+    class mpmc_ring
+    {
+        //=== Aliases
+        public:
+            using size_type = std::size_t; //!< The size type.
+            using value_type = T;          //!< The value type.
+
+        public:
+            /**
+             * @brief Constructs an empty queue.
+             * @param capacity the maximum number of elements, must be a power of two.
+             */
+            explicit mpmc_ring( size_type capacity )
+                : m_mask {capacity - 1},
+                  m_cells {new cell[capacity]} {
+                if ( capacity == 0 or ( capacity & m_mask ) != 0 )
+                    throw std::invalid_argument("mpmc_ring(): capacity must be a power of two");
+                for ( size_type i {0}; i < capacity; i++ )
+                    m_cells[i].stamp.store( i, std::memory_order_relaxed );
+            }
+
+            /// Turn off copy constructor.
+            mpmc_ring( const mpmc_ring & ) = delete;
+            /// Turn off assignment operator.
+            mpmc_ring & operator=( const mpmc_ring & ) = delete;
+
+            /**
+             * @brief Adds an element at the end of the queue, if there is room.
+             * @return true if the element was added; false if the queue is full.
+             */
+            bool try_push( T value ) {
+                size_type pos = m_enqueue.load( std::memory_order_relaxed );
+                cell * c;
+                for ( ;; ) {
+                    c = &m_cells[pos & m_mask];
+                    size_type stamp = c->stamp.load( std::memory_order_acquire );
+                    auto dif = static_cast< std::ptrdiff_t >( stamp - pos );
+                    if ( dif == 0 ) {
+                        if ( m_enqueue.compare_exchange_weak( pos, pos + 1, std::memory_order_relaxed ) )
+                            break;
+                    }
+                    else if ( dif < 0 )
+                        return false; // Full.
+                    else
+                        pos = m_enqueue.load( std::memory_order_relaxed );
+                }
+                c->value = std::move( value );
+                c->stamp.store( pos + 1, std::memory_order_release );
+                return true;
+            }
+
+            /**
+             * @brief Removes the first element of the queue, if any.
+             * @return true if an element was removed; false if the queue is empty.
+             */
+            bool try_pop( T & value ) {
+                size_type pos = m_dequeue.load( std::memory_order_relaxed );
+                cell * c;
+                for ( ;; ) {
+                    c = &m_cells[pos & m_mask];
+                    size_type stamp = c->stamp.load( std::memory_order_acquire );
+                    auto dif = static_cast< std::ptrdiff_t >( stamp - ( pos + 1 ) );
+                    if ( dif == 0 ) {
+                        if ( m_dequeue.compare_exchange_weak( pos, pos + 1, std::memory_order_relaxed ) )
+                            break;
+                    }
+                    else if ( dif < 0 )
+                        return false; // Empty.
+                    else
+                        pos = m_dequeue.load( std::memory_order_relaxed );
+                }
+                value = std::move( c->value );
+                c->stamp.store( pos + m_mask + 1, std::memory_order_release );
+                return true;
+            }
+
+            /// Adds an element, waiting while the queue is full (backpressure).
+            void push( T value ) {
+                while ( not try_push( value ) ) std::this_thread::yield();
+            }
+
+            /// Removes the first element, waiting while the queue is empty.
+            T pop( void ) {
+                T value;
+                while ( not try_pop( value ) ) std::this_thread::yield();
+                return value;
+            }
+
+        private:
+            /// A cell of the queue.
+            struct cell {
+                std::atomic< size_type > stamp; //!< Tells whether the cell is free or holds a value, and for which lap.
+                T value;                        //!< The element.
+            };
+
+            size_type m_mask;                                   //!< Capacity minus one.
+            std::unique_ptr<cell[]> m_cells;                    //!< The cells.
+            alignas(64) std::atomic< size_type > m_enqueue {0}; //!< Next position to be claimed by a producer.
+            alignas(64) std::atomic< size_type > m_dequeue {0}; //!< Next position to be claimed by a consumer.
+    };
+
+} // namespace sc.
+
+#endif
@@ -0,0 +1,125 @@
+#ifndef _SEQUENCE_RING_H_
+#define _SEQUENCE_RING_H_
+
+#include <atomic>    // std::atomic
+#include <memory>    // std::unique_ptr
+#include <thread>    // std::this_thread::yield
+#include <cstddef>   // std::size_t
+#include <stdexcept> // std::invalid_argument
+
+/// Sequence container namespace.
+namespace sc {
+
+    /// A bounded ring buffer that hands values back in sequence order.
+    /*!
+     * Producers publish values tagged with a sequence number, in any order,
+     * and a single consumer takes them back strictly in order 0, 1, 2, ...
+     * Each slot carries a stamp that tells whose turn it is:
+     *
+     * - `stamp == seq`            the slot is free for the producer of `seq`;
+     * - `stamp == seq + 1`        the value of `seq` is ready to be consumed;
+     * - `stamp == seq + capacity` the slot was consumed and is free for the next lap.
+     *
+     * A producer whose sequence number is `capacity` or more ahead of the consumer
+     * waits for its slot, which gives natural backpressure.
+     *
+     * \tparam T The type of the values, which must be default constructible.
+     */
+    template < typename T >
+    class sequence_ring
+    {
+        //=== Aliases
+        public:
+            using size_type = std::size_t; //!< The size type.
+            using value_type = T;          //!< The value type.
+
+        public:
+            /**
+             * @brief Constructs a ring with room for `capacity` values in flight.
+             * @param capacity the number of slots, must be a power of two.
+             */
+            explicit sequence_ring( size_type capacity )
+                : m_capacity {capacity},
+                  m_mask {capacity - 1},
+                  m_slots {new slot[capacity]} {
+                if ( capacity == 0 or ( capacity & m_mask ) != 0 )
+                    throw std::invalid_argument("sequence_ring(): capacity must be a power of two");
+                for ( size_type i {0}; i < capacity; i++ )
+                    m_slots[i].stamp.store( i, std::memory_order_relaxed );
+            }
+
+            /// Turn off copy constructor.
+            sequence_ring( const sequence_ring & ) = delete;
+            /// Turn off assignment operator.
+            sequence_ring & operator=( const sequence_ring & ) = delete;
+
+            /**
+             * @brief Stores the value of a sequence number, waiting while its slot is still in use.
+             * @param seq the sequence number of the value.
+             * @param value the value to publish.
+             */
+            void publish( size_type seq, T value ) {
+                slot & s = m_slots[seq & m_mask];
+                while ( s.stamp.load( std::memory_order_acquire ) != seq )
+                    std::this_thread::yield();
+                s.value = std::move( value );
+                s.stamp.store( seq + 1, std::memory_order_release );
+            }
+
+            /**
+             * @brief Tells whether the value of a sequence number was already published.
+             * @param seq the sequence number, which must be the next one to consume.
+             */
+            bool ready( size_type seq ) const {
+                return m_slots[seq & m_mask].stamp.load( std::memory_order_acquire ) == seq + 1;
+            }
+
+            /**
+             * @brief Takes the value of a sequence number if it is ready.
+             * @param seq the sequence number, which must be the next one to consume.
+             * @param value receives the value.
+             * @return true if the value was ready and was taken; false otherwise.
+             */
+            bool try_consume( size_type seq, T & value ) {
+                slot & s = m_slots[seq & m_mask];
+                if ( s.stamp.load( std::memory_order_acquire ) != seq + 1 )
+                    return false;
+                value = std::move( s.value );
+                s.stamp.store( seq + m_capacity, std::memory_order_release );
+                return true;
+            }
+
+            /**
+             * @brief Takes the value of a sequence number, waiting until it is published.
+             * @param seq the sequence number, which must be the next one to consume.
+             * @return T the value published for `seq`.
+             */
+            T consume( size_type seq ) {
+                T value;
+                while ( not try_consume( seq, value ) )
+                    std::this_thread::yield();
+                return value;
+            }
+
+            /**
+             * @return the number of slots of the ring.
+             */
+            size_type capacity( void ) const {
+                return m_capacity;
+            }
+
+        private:
+            /// A slot of the ring, kept in its own cache line to avoid false sharing.
+            struct alignas(64) slot {
+                std::atomic< size_type > stamp; //!< Whose turn it is, see the class description.
+                T value;                        //!< The value stored in the slot.
+            };
+
+            size_type m_capacity;            //!< The number of slots.
+            size_type m_mask;                //!< Mask used to map a sequence number to its slot.
+            std::unique_ptr<slot[]> m_slots; //!< The slots.
+    };
+
+} // namespace sc.
+
+#endif
@@ -4,78 +4,17 @@
 #include <string>   // std::string
 #include <iostream> // std::ostream
 #include <memory>   // std::unique_ptr
-#include <iterator> // std::advance, std::begin(), std::end(), std::ostream_iterator
+#include <utility>  // std::move, std::forward
+#include <algorithm> // std::move (range)
+#include <stdexcept> // std::runtime_error
+
+#include "vector.h" // sc::ContiguousIterator
 
 /// Sequence stack container namespace.
 namespace sta {
 
-   /// Implements tha infrastrcture to support a bidirectional iterator.
-   template < class T >
-    class MyForwardIterator : public std::iterator<std::bidirectional_iterator_tag, T>
-    {
-        public:
-            typedef MyForwardIterator self_type;   //!< Alias to iterator.
-            // Below we have the iterator_traits common interface
-            typedef std::ptrdiff_t difference_type; //!< Difference type used to calculated distance between iterators.
-            typedef T value_type;           //!< Value type the iterator points to.
-            typedef T* pointer;             //!< Pointer to the value type.
-            typedef T& reference;           //!< Reference to the value type.
-            typedef const T& const_reference;           //!< Reference to the value type.
-            typedef std::bidirectional_iterator_tag iterator_category; //!< Iterator category.
-
-            MyForwardIterator( pointer ptr = nullptr ) : m_ptr{ptr}  {};
-            self_type& operator=( const self_type& other ) {
-                m_ptr = other.m_ptr;
-                return *this;
-            }
-            MyForwardIterator( const self_type& other ) : m_ptr{ other.m_ptr } {}
-            reference operator*( ) const {
-                return *m_ptr;
-            }
-            self_type& operator++( ) {
-                m_ptr++;
-                return *this;
-            }; // ++it;
-            self_type operator++( int ) {
-                auto old {*this};
-                m_ptr++;
-                return old;
-            }; // it++;
-
-            self_type& operator--( ) {
-                --m_ptr;
-                return *this;
-            }
-            self_type operator--( int ) {
-                auto old {*this};
-                m_ptr--;
-                return old;
-            }
-            
-            friend self_type operator+( difference_type difference, self_type it) {
-                return self_type{difference + it.m_ptr};
-            };
-            friend self_type operator+( self_type it, difference_type difference ) {
-                return self_type{it.m_ptr + difference };
-            };
-            friend self_type operator-( self_type it, difference_type difference ) {
-                return self_type{it.m_ptr - difference};
-            }
-            difference_type operator-( self_type it ) {
-                return m_ptr - it.m_ptr;
-            }
-            bool operator==( const self_type& other) const {
-                return other.m_ptr == m_ptr;
-            };
-            bool operator!=( const self_type& other) const {
-                return other.m_ptr != m_ptr;
-            };
-
-        private:
-            pointer m_ptr; //!< The raw pointer.
-    };
-
-
+    template < class T >
+    using ContiguousIterator = sc::ContiguousIterator< T >; //!< The iterator of sc::vector, which also fits the stack.
 
     /// Represents a stack.
     /**
@@ -95,12 +34,14 @@ namespace sta {
         public:
             using size_type = unsigned long; //!< The size type.
             using value_type = T;            //!< The value type.
+            using difference_type = std::ptrdiff_t; //!< The distance between two positions.
             using pointer = value_type*;     //!< Pointer to a value stored in the container.
+            using const_pointer = const value_type*; //!< Pointer to a value that cannot be changed through it.
             using reference = value_type&;   //!< Reference to a value stored in the container.
             using const_reference = const value_type&; //!< Const reference to a value stored in the container.
 
-            using iterator = MyForwardIterator< value_type >; //!< The iterator, instantiated from a template class.
-            using const_iterator = MyForwardIterator< const value_type >; //!< The const_iterator, instantiated from a template class.
+            using iterator = ContiguousIterator< value_type >; //!< The iterator, from the bottom to the top.
+            using const_iterator = ContiguousIterator< const value_type >; //!< The const_iterator, from the bottom to the top.
 
         public:
             stack(void) // constructor.
@@ -109,31 +50,66 @@ namespace sta {
                 m_storage {new T[0]} {
             };
 
+            /**
+             * @brief Makes room for a number of elements, so that pushing up to that
+             * many does not allocate. It never shrinks the storage.
+             * @param n the number of elements the stack must be able to hold.
+             */
+            void reserve(size_type n)
+            {
+                if (n > m_capacity) reallocate(n);
+            };
+
             /**
              * @brief Adds an item in the stack. If the stack is full, then it is said 
              * to be an Overflow condition.
              * @param element the element that will be add on the stack.
              * @return true if pushed successfully.
              */
-            bool push(T element)
+            bool push(const T & element)
             {
                 // Check if there is space for new element.
-                if (m_end >= m_capacity) {
-                    if (m_capacity == 0) m_capacity++;
-                    else m_capacity *= 2;
-                    // Allocates a new space
-                    std::unique_ptr<T[]> new_storage {new T[m_capacity]};
-                    // Copies values of the stack to the new storage
-                    std::copy(begin(), end(), new_storage.get());
-
-                    m_storage = std::move(new_storage);
-                }
+                if (m_end >= m_capacity) grow();
                 // Insert the element.
-                m_storage[m_end] = element;
-                m_end++;
+                m_storage[m_end++] = element;
                 return true;
             };
-            
+
+            /**
+             * @brief Adds an item in the stack, moving it in.
+             * @param element the element that will be moved on the stack.
+             * @return true if pushed successfully.
+             */
+            bool push(T && element)
+            {
+                if (m_end >= m_capacity) grow();
+                m_storage[m_end++] = std::move(element);
+                return true;
+            };
+
+            /**
+             * @brief Builds an item on the top of the stack from the arguments of a constructor of T.
+             * @param args the arguments.
+             * @return reference the new top.
+             */
+            template <typename... Args>
+            reference emplace(Args &&... args)
+            {
+                if (m_end >= m_capacity) grow();
+                m_storage[m_end] = T(std::forward<Args>(args)...);
+                return m_storage[m_end++];
+            };
+
+            /**
+             * @brief Adds an item without checking the capacity: the caller must have
+             * reserve()d enough room.
+             * @param element the element that will be moved on the stack.
+             */
+            void push_unchecked(T element)
+            {
+                m_storage[m_end++] = std::move(element);
+            };
+
             /**
              * @brief Removes an item from the stack. The items are popped in the
              * reversed order in which they are pushed. If the stack is empty,
@@ -145,16 +121,24 @@ namespace sta {
                 if (m_end == 0) {
                     throw std::runtime_error("pop(): cannot use this method on an empty stack");
                 }
-                T temporary = m_storage[m_end - 1];
-                m_end--;
-                return temporary;
+                return std::move(m_storage[--m_end]);
+            };
+
+            /**
+             * @brief Removes an item without checking whether there is one: the caller
+             * must know the stack is not empty.
+             * @return T the element that was removed from the stack.
+             */
+            T pop_unchecked(void)
+            {
+                return std::move(m_storage[--m_end]);
             };
 
             /**
              * @brief Get the top element of the stack.
              * @return T Returns top element of stack.
              */
-            T top(void)
+            reference top(void)
             {
                 if (m_end == 0) {
                     throw std::runtime_error("top(): cannot use this method on an empty stack");
@@ -182,23 +166,71 @@ namespace sta {
                 return m_end;
             }
 
-        private:
-            size_type m_end;                //!< The list's current size (or index past-last valid element).
-            size_type m_capacity;           //!< The list's storage capacity.
-            std::unique_ptr<T[]> m_storage; //!< The list's data storage area.
-            
+            /**
+             * @brief Removes all the elements, keeping the storage for reuse.
+             */
+            void clear( void ) {
+                m_end = 0;
+            }
+
             //=== [II] ITERATORS
             /**
-            * @return an iterator to the begin of the stack
+            * @return an iterator to the bottom of the stack
             */
             iterator begin( void ) {
                 return iterator{m_storage.get()};
-            };
+            }
             /**
-            * @return an iterator to the position after the end of the stack
+            * @return an iterator to the position after the top of the stack
             */
             iterator end( void ) {
                 return iterator{m_storage.get() + m_end};
+            }
+            /**
+            * @return a const iterator to the bottom of the stack
+            */
+            const_iterator begin( void ) const {
+                return const_iterator{m_storage.get()};
+            }
+            /**
+            * @return a const iterator to the position after the top of the stack
+            */
+            const_iterator end( void ) const {
+                return const_iterator{m_storage.get() + m_end};
+            }
+            /**
+            * @return a pointer to the bottom of the stack, the elements being stored one after the other
+            */
+            pointer data( void ) {
+                return m_storage.get();
+            }
+            /**
+            * @return a pointer to the bottom of the stack, the elements being stored one after the other
+            */
+            const_pointer data( void ) const {
+                return m_storage.get();
+            }
+
+        private:
+            size_type m_end;                //!< The list's current size (or index past-last valid element).
+            size_type m_capacity;           //!< The list's storage capacity.
+            std::unique_ptr<T[]> m_storage; //!< The list's data storage area.
+            
+            /// Doubles the capacity (or makes it 1).
+            void grow(void)
+            {
+                reallocate(m_capacity == 0 ? 1 : m_capacity * 2);
+            };
+
+            /// Moves the elements to a new storage area of the given capacity.
+            void reallocate(size_type capacity)
+            {
+                // Allocates a new space
+                std::unique_ptr<T[]> new_storage {new T[capacity]};
+                // Moves values of the stack to the new storage
+                std::move(m_storage.get(), m_storage.get() + m_end, new_storage.get());
+                m_storage = std::move(new_storage);
+                m_capacity = capacity;
             };
     };
 }
@@ -4,81 +4,104 @@
 #include <exception>    // std::out_of_range
 #include <iostream>     // std::cout, std::endl
 #include <memory>       // std::unique_ptr
-#include <iterator>     // std::advance, std::begin(), std::end(), std::ostream_iterator
+#include <iterator>     // std::contiguous_iterator_tag, std::advance, std::begin(), std::end()
 #include <algorithm>    // std::copy, std::equal, std::fill
 #include <initializer_list> // std::initializer_list
 #include <cassert>      // assert()
 #include <limits>       // std::numeric_limits<T>
-#include <cstddef>      // std::size_t
+#include <cstddef>      // std::size_t, std::ptrdiff_t
+#include <compare>      // operator<=>
+#include <type_traits>  // std::remove_cv_t, std::enable_if_t, std::is_same_v
 
 /// Sequence container namespace.
 namespace sc {
-    /// Implements tha infrastrcture to support a bidirectional iterator.
+    /// A random access iterator over elements stored one after the other.
+    /*!
+     * It wraps a pointer and models std::contiguous_iterator, so the standard
+     * algorithms (and std::to_address()) see through it: copies of trivial
+     * types become memmove, and the parallel and vectorized execution policies
+     * get random access. An iterator converts to the iterator of const elements.
+     *
+     * \tparam T The type of the elements, const for a const_iterator.
+     */
     template < class T >
-    class MyForwardIterator : public std::iterator<std::bidirectional_iterator_tag, T>
+    class ContiguousIterator
     {
         public:
-            typedef MyForwardIterator self_type;   //!< Alias to iterator.
+            typedef ContiguousIterator self_type;   //!< Alias to iterator.
             // Below we have the iterator_traits common interface
             typedef std::ptrdiff_t difference_type; //!< Difference type used to calculated distance between iterators.
-            typedef T value_type;           //!< Value type the iterator points to.
+            typedef std::remove_cv_t< T > value_type; //!< Value type the iterator points to.
             typedef T* pointer;             //!< Pointer to the value type.
             typedef T& reference;           //!< Reference to the value type.
-            typedef const T& const_reference;           //!< Reference to the value type.
-            typedef std::bidirectional_iterator_tag iterator_category; //!< Iterator category.
+            typedef std::random_access_iterator_tag iterator_category; //!< Iterator category.
+            typedef std::contiguous_iterator_tag iterator_concept;     //!< The strongest concept it models (C++20).
 
-            MyForwardIterator( pointer ptr = nullptr ) : m_ptr{ptr}  {};
-            self_type& operator=( const self_type& other ) {
-                m_ptr = other.m_ptr;
-                return *this;
-            }
-            MyForwardIterator( const self_type& other ) : m_ptr{ other.m_ptr } {}
-            reference operator*( ) const {
+            constexpr ContiguousIterator( pointer ptr = nullptr ) noexcept : m_ptr{ptr} {}
+            /// The iterator of const elements from the iterator of the same elements.
+            template < class U, class = std::enable_if_t< std::is_same_v< const U, T > and not std::is_same_v< U, T > > >
+            constexpr ContiguousIterator( const ContiguousIterator< U > & other ) noexcept : m_ptr{ other.operator->() } {}
+
+            constexpr reference operator*( ) const noexcept {
                 return *m_ptr;
             }
-            self_type& operator++( ) {
+            constexpr pointer operator->( ) const noexcept {
+                return m_ptr;
+            }
+            constexpr reference operator[]( difference_type n ) const noexcept {
+                return m_ptr[n];
+            }
+
+            constexpr self_type& operator++( ) noexcept {
                 m_ptr++;
                 return *this;
-            }; // ++it;
-            self_type operator++( int ) {
+            } // ++it;
+            constexpr self_type operator++( int ) noexcept {
                 auto old {*this};
                 m_ptr++;
                 return old;
-            }; // it++;
-
-            self_type& operator--( ) {
+            } // it++;
+            constexpr self_type& operator--( ) noexcept {
                 --m_ptr;
                 return *this;
             }
-            self_type operator--( int ) {
+            constexpr self_type operator--( int ) noexcept {
                 auto old {*this};
                 m_ptr--;
                 return old;
             }
-            
-            friend self_type operator+( difference_type difference, self_type it) {
+            constexpr self_type& operator+=( difference_type difference ) noexcept {
+                m_ptr += difference;
+                return *this;
+            }
+            constexpr self_type& operator-=( difference_type difference ) noexcept {
+                m_ptr -= difference;
+                return *this;
+            }
+
+            friend constexpr self_type operator+( difference_type difference, self_type it ) noexcept {
                 return self_type{difference + it.m_ptr};
-            };
-            friend self_type operator+( self_type it, difference_type difference ) {
-                return self_type{it.m_ptr + difference };
-            };
-            friend self_type operator-( self_type it, difference_type difference ) {
+            }
+            friend constexpr self_type operator+( self_type it, difference_type difference ) noexcept {
+                return self_type{it.m_ptr + difference};
+            }
+            friend constexpr self_type operator-( self_type it, difference_type difference ) noexcept {
                 return self_type{it.m_ptr - difference};
             }
-            difference_type operator-( self_type it ) {
+            constexpr difference_type operator-( const self_type & it ) const noexcept {
                 return m_ptr - it.m_ptr;
             }
-            bool operator==( const self_type& other) const {
-                return other.m_ptr == m_ptr;
-            };
-            bool operator!=( const self_type& other) const {
-                return other.m_ptr != m_ptr;
-            };
+            constexpr bool operator==( const self_type & other ) const noexcept = default;
+            constexpr auto operator<=>( const self_type & other ) const noexcept = default;
 
         private:
             pointer m_ptr; //!< The raw pointer.
     };
 
+    static_assert( std::contiguous_iterator< ContiguousIterator< int > > and
+                   std::contiguous_iterator< ContiguousIterator< const int > >,
+                   "ContiguousIterator must model std::contiguous_iterator" );
+
     /// This class implements the ADT list with dynamic array.
     /*!
      * sc::vector is a sequence container that encapsulates dynamic size arrays.
@@ -98,12 +121,14 @@ namespace sc {
         public:
             using size_type = unsigned long; //!< The size type.
             using value_type = T;            //!< The value type.
+            using difference_type = std::ptrdiff_t; //!< The distance between two positions.
             using pointer = value_type*;     //!< Pointer to a value stored in the container.
+            using const_pointer = const value_type*; //!< Pointer to a value that cannot be changed through it.
             using reference = value_type&;   //!< Reference to a value stored in the container.
             using const_reference = const value_type&; //!< Const reference to a value stored in the container.
 
-            using iterator = MyForwardIterator< value_type >; //!< The iterator, instantiated from a template class.
-            using const_iterator = MyForwardIterator< const value_type >; //!< The const_iterator, instantiated from a template class.
+            using iterator = ContiguousIterator< value_type >; //!< The iterator, instantiated from a template class.
+            using const_iterator = ContiguousIterator< const value_type >; //!< The const_iterator, instantiated from a template class.
 
         public:
             //=== [I] SPECIAL MEMBERS (6 OF THEM)
@@ -125,8 +150,8 @@ namespace sc {
             vector( const vector & vec) 
                 : m_end {vec.m_end},
                   m_capacity {vec.m_capacity},
-                  m_storage {new T[m_end]} {
-                std::copy(vec.cbegin(), vec.cend(), m_storage.get());
+                  m_storage {new T[m_capacity]} {
+                std::copy(vec.data(), vec.data() + vec.m_end, m_storage.get());
             };
             /**
              * @brief Contructs a vector with the values of a initializer list
@@ -173,7 +198,7 @@ namespace sc {
                         m_storage.reset();
                         m_storage = std::unique_ptr<T[]>( new T[vec.m_capacity] );
                     }
-                    std::copy(vec.cbegin(), vec.cend(), m_storage.get());
+                    std::copy(vec.data(), vec.data() + vec.m_end, m_storage.get());
 
                     m_end = vec.m_end;
                     m_capacity = vec.m_capacity;
@@ -213,6 +238,18 @@ namespace sc {
             iterator end( void ) {
                 return iterator{m_storage.get() + m_end};
             };
+            /**
+             * @return a const iterator to the begin of the vector
+             */
+            const_iterator begin( void ) const {
+                return cbegin();
+            }
+            /**
+             * @return a const iterator to the position after the end of the vector
+             */
+            const_iterator end( void ) const {
+                return cend();
+            }
             /**
              * @return a const iterator to the begin of the vector
              */
@@ -264,7 +301,7 @@ namespace sc {
                     else m_capacity *= 2;
                     std::unique_ptr<T[]> new_storage {new T[m_capacity]};
                     // Copies values of the vector to the begining of the new storage
-                    std::copy(begin(), end(), new_storage.get() + 1);
+                    std::copy(data(), data() + m_end, new_storage.get() + 1);
 
                     m_storage = std::move(new_storage);
                 } else {
@@ -285,7 +322,7 @@ namespace sc {
                     else m_capacity *= 2;
                     std::unique_ptr<T[]> new_storage {new T[m_capacity]};
                     // Copies values of the vector to the new storage
-                    std::copy(begin(), end(), new_storage.get());
+                    std::copy(data(), data() + m_end, new_storage.get());
 
                     m_storage = std::move(new_storage);
                 }
@@ -304,7 +341,7 @@ namespace sc {
                     else m_capacity *= 2;
                     std::unique_ptr<T[]> new_storage {new T[m_capacity]};
                     // Copies values of the vector to the new storage
-                    std::copy(begin(), end(), new_storage.get());
+                    std::copy(data(), data() + m_end, new_storage.get());
 
                     m_storage = std::move(new_storage);
                 }
@@ -443,7 +480,7 @@ namespace sc {
                     m_capacity = new_capacity;
                     std::unique_ptr<T[]> new_storage {new T[m_capacity]};
                     // Copies new_capacitys of the vector to the begining of the new storage
-                    std::copy(begin(), end(), new_storage.get());
+                    std::copy(data(), data() + m_end, new_storage.get());
                     m_storage = std::move(new_storage);
                 }
             };
@@ -453,7 +490,7 @@ namespace sc {
             void shrink_to_fit( void ) {
                 if (m_end != m_capacity) {
                     std::unique_ptr<T[]> new_storage {new T[m_end]};
-                    std::copy(begin(), end(), new_storage.get());
+                    std::copy(data(), data() + m_end, new_storage.get());
                     m_storage = std::move(new_storage);
                     m_capacity = m_end;
                 }
@@ -653,7 +690,7 @@ namespace sc {
             /**
              * @return Returns a direct const pointer to the memory array used internally by the vector to store its owned elements.
              */
-            const_reference data( void ) const {
+            const_pointer data( void ) const {
                 return m_storage.get();
             };
 
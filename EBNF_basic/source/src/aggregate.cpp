@@ -0,0 +1,181 @@
+#include <algorithm> // std::copy_n, std::min, std::max
+#include <limits>    // std::numeric_limits
+
+#include "../include/aggregate.h"
+
+namespace {
+    /// Appends an integer of up to 128 bits.
+    void append_number( Aggregate::sum_type value, std::string & out ) {
+        char digits[48];
+        char * p = digits + sizeof( digits );
+        const bool negative { value < 0 };
+        // Digits are taken from the negative value, which also holds the smallest one.
+        if ( not negative ) value = -value;
+        do {
+            *--p = static_cast< char >( '0' - static_cast< int >( value % 10 ) );
+            value /= 10;
+        } while ( value != 0 );
+        if ( negative ) *--p = '-';
+        out.append( p, digits + sizeof( digits ) );
+    }
+
+    /// Appends the mean of the values with two decimals, rounded half away from zero.
+    void append_mean( Aggregate::sum_type sum, std::uint64_t count, std::string & out ) {
+        const bool negative { sum < 0 };
+        const Aggregate::sum_type hundredths { ( ( negative ? -sum : sum ) * 200 / count + 1 ) / 2 };
+        if ( negative and hundredths != 0 ) out += '-';
+        append_number( hundredths / 100, out );
+        out += '.';
+        out += static_cast< char >( '0' + hundredths % 100 / 10 );
+        out += static_cast< char >( '0' + hundredths % 10 );
+    }
+}
+
+/// Creates an empty accumulator.
+Aggregate::Aggregate( unsigned parts )
+    : m_parts { parts },
+      m_min { std::numeric_limits< value_type >::max() },
+      m_max { std::numeric_limits< value_type >::min() },
+      m_histogram { parts & HISTOGRAM ? new std::uint64_t[N_BINS]{} : nullptr } { /* empty */ }
+
+/// Copy constructor, which copies the histogram too.
+Aggregate::Aggregate( const Aggregate & other )
+    : m_parts { other.m_parts },
+      m_lines { other.m_lines },
+      m_sum { other.m_sum },
+      m_min { other.m_min },
+      m_max { other.m_max },
+      m_histogram { other.m_histogram ? new std::uint64_t[N_BINS] : nullptr } {
+    std::copy_n( other.m_codes, N_CODES, m_codes );
+    if ( m_histogram ) std::copy_n( other.m_histogram.get(), N_BINS, m_histogram.get() );
+}
+
+/// Assignment operator.
+Aggregate & Aggregate::operator=( const Aggregate & other ) {
+    if ( this != &other ) {
+        Aggregate copy { other };
+        m_parts = copy.m_parts;
+        m_lines = copy.m_lines;
+        std::copy_n( copy.m_codes, N_CODES, m_codes );
+        m_sum = copy.m_sum;
+        m_min = copy.m_min;
+        m_max = copy.m_max;
+        m_histogram.swap( copy.m_histogram );
+    }
+    return *this;
+}
+
+/// Adds what another accumulator has seen.
+void Aggregate::merge( const Aggregate & other ) {
+    m_lines += other.m_lines;
+    for ( std::size_t c {0}; c < N_CODES; c++ ) m_codes[c] += other.m_codes[c];
+    m_sum += other.m_sum;
+    m_min = std::min( m_min, other.m_min );
+    m_max = std::max( m_max, other.m_max );
+    if ( m_histogram and other.m_histogram )
+        for ( std::size_t b {0}; b < N_BINS; b++ ) m_histogram[b] += other.m_histogram[b];
+}
+
+/// Reads a comma separated list of parts.
+bool Aggregate::parse_parts( std::string_view list, unsigned & parts ) {
+    parts = 0;
+    while ( true ) {
+        auto comma = list.find( ',' );
+        std::string_view name = list.substr( 0, comma );
+        if ( name == "sum" ) parts |= SUM;
+        else if ( name == "minmax" ) parts |= MINMAX;
+        else if ( name == "errors" ) parts |= ERRORS;
+        else if ( name == "histogram" ) parts |= HISTOGRAM;
+        else if ( name == "all" ) parts |= ALL;
+        else return false;
+        if ( comma == std::string_view::npos ) return true;
+        list.remove_prefix( comma + 1 );
+    }
+}
+
+/// Appends the summary.
+void Aggregate::append_summary( std::string & out, BaresManager::Format format ) const {
+    const bool json { format == BaresManager::Format::JSON };
+    const std::uint64_t values { m_codes[Parser::ResultType::OK] };
+    bool first { true };
+    // Starts a member: "name: " in text (or "name:" and a line break before a list), "name": in JSON.
+    auto field = [&]( const char * name, bool list = false ) {
+        if ( json ) {
+            out += first ? "{\"" : ",\"";
+            out += name;
+            out += "\":";
+        }
+        else {
+            out += name;
+            out += list ? ":\n" : ": ";
+        }
+        first = false;
+    };
+    auto end_field = [&]() { if ( not json ) out += '\n'; };
+
+    field( "lines" );
+    append_number( m_lines, out );
+    end_field();
+    if ( m_parts & SUM ) {
+        field( "values" );
+        append_number( values, out );
+        end_field();
+        field( "sum" );
+        append_number( m_sum, out );
+        end_field();
+        field( "mean" );
+        if ( values > 0 ) append_mean( m_sum, values, out );
+        else out += json ? "null" : "-";
+        end_field();
+    }
+    if ( m_parts & MINMAX ) {
+        for ( const char * name : { "min", "max" } ) {
+            field( name );
+            if ( values > 0 ) append_number( name[1] == 'i' ? m_min : m_max, out );
+            else out += json ? "null" : "-";
+            end_field();
+        }
+    }
+    if ( m_parts & ERRORS ) {
+        field( "codes", true );
+        if ( json ) out += '{';
+        bool first_code { true };
+        for ( std::size_t c {0}; c < N_CODES; c++ ) {
+            if ( m_codes[c] == 0 ) continue;
+            const char * name = BaresManager::code_name( static_cast< Parser::ResultType::code_t >( c ) );
+            if ( json ) {
+                out += first_code ? "\"" : ",\"";
+                out += name;
+                out += "\":";
+            }
+            else {
+                out += "  ";
+                out += name;
+                out += ": ";
+            }
+            append_number( m_codes[c], out );
+            if ( not json ) out += '\n';
+            first_code = false;
+        }
+        if ( json ) out += '}';
+    }
+    if ( m_histogram ) {
+        field( "histogram", true );
+        if ( json ) out += '[';
+        bool first_bin { true };
+        // In the order of the values, from the smallest.
+        for ( long v { std::numeric_limits< value_type >::min() }; v <= std::numeric_limits< value_type >::max(); v++ ) {
+            const std::uint64_t n { m_histogram[bin( static_cast< value_type >( v ) )] };
+            if ( n == 0 ) continue;
+            if ( json ) out += first_bin ? "[" : ",[";
+            else out += "  ";
+            append_number( v, out );
+            out += json ? "," : ": ";
+            append_number( n, out );
+            out += json ? "]" : "\n";
+            first_bin = false;
+        }
+        if ( json ) out += ']';
+    }
+    if ( json ) out += "}\n";
+}
@@ -0,0 +1,227 @@
+#include <algorithm> // std::sort, std::max_element
+#include <limits>    // std::numeric_limits
+#include <thread>    // std::thread
+
+#include "../include/ast.h"
+#include "../include/arithmetic.h"
+
+namespace {
+    /// Mixes the fields that tell two nodes apart.
+    inline std::uint64_t hash_node( const Ast::Node & n ) {
+        std::uint64_t h = n.op == 0 ? static_cast< std::uint64_t >( n.value )
+                                    : ( std::uint64_t{ n.lhs } << 32 | n.rhs ) ^ ( std::uint64_t( n.op ) << 56 );
+        h *= 0x9E3779B97F4A7C15ull;
+        return h ^ ( h >> 29 );
+    }
+
+    /// Whether two nodes compute the same thing.
+    inline bool same_node( const Ast::Node & a, const Ast::Node & b ) {
+        return a.op == b.op and ( a.op == 0 ? a.value == b.value : a.lhs == b.lhs and a.rhs == b.rhs );
+    }
+}
+
+/// Appends a node to the arena, unless an equal one is already there.
+Ast::index_type Ast::add( const Node & node ) {
+    m_terms++;
+    if ( not m_table.empty() ) {
+        // The table has twice as many slots as the expression has tokens: it never fills up.
+        const std::size_t mask { m_table.size() - 1 };
+        for ( std::size_t slot = hash_node( node ) & mask; ; slot = ( slot + 1 ) & mask ) {
+            if ( m_table[slot] == NONE ) {
+                m_table[slot] = static_cast< index_type >( m_nodes.size() );
+                break;
+            }
+            if ( same_node( m_nodes[m_table[slot]], node ) ) {
+                if ( node.op != 0 ) hoist( m_table[slot] );
+                return m_table[slot];
+            }
+        }
+    }
+    m_nodes.push_back( node );
+    return static_cast< index_type >( m_nodes.size() - 1 );
+}
+
+/// Marks a node read from outside its subtree, and what it reads, to be computed before the threads start.
+void Ast::hoist( index_type i ) {
+    if ( m_nodes[i].hoisted ) return;
+    m_work.clear();
+    m_work.push( i );
+    while ( not m_work.empty() ) {
+        Node & n = m_nodes[m_work.pop()];
+        if ( n.op == 0 or n.hoisted ) continue;
+        n.hoisted = true;
+        m_hoisted.push_back( static_cast< index_type >( &n - &m_nodes[0] ) );
+        m_work.push( n.lhs );
+        m_work.push( n.rhs );
+    }
+}
+
+/// Pops the operator on top and its two operands, and pushes the node that applies it.
+void Ast::reduce( void ) {
+    const char op { m_operators.pop() };
+    const Operand rhs { m_operands.pop() };
+    const Operand lhs { m_operands.pop() };
+    // An operand read from outside the range of this subtree must be a literal or hoisted.
+    auto inside = [&]( index_type i ) {
+        return m_nodes[i].op == 0 or m_nodes[i].hoisted or ( i >= lhs.first and m_nodes[i].independent );
+    };
+    const Node node { 0, lhs.node, rhs.node, lhs.first, op, inside( lhs.node ) and inside( rhs.node ), false };
+    m_operands.push( Operand{ add( node ), lhs.first } );
+}
+
+/// Builds the tree of an expression with the same conversion as BaresManager::infix_to_postfix().
+void Ast::build( const TokenBuffer & infix, bool share ) {
+    m_nodes.clear();
+    m_nodes.reserve( infix.size() );
+    m_table.clear();
+    if ( share ) {
+        std::size_t slots {16};
+        while ( slots < 2 * infix.size() ) slots <<= 1;
+        m_table.assign( slots, NONE );
+    }
+    m_hoisted.clear();
+    m_operators.clear();
+    m_operands.clear();
+    m_root = NONE;
+    m_terms = 0;
+
+    for ( std::size_t i {0}; i < infix.size(); i++ ) {
+        const Token::token_t type = infix.kind( i );
+        if ( type == Token::token_t::OPERAND ) {
+            const auto first = static_cast< index_type >( m_nodes.size() );
+            const Node leaf { infix.value( i ), NONE, NONE, first, 0, true, false };
+            m_operands.push( Operand{ add( leaf ), first } );
+        }
+        else if ( type == Token::token_t::OPEN_PARENTHESES )
+            m_operators.push( '(' );
+        else if ( type == Token::token_t::CLOSE_PARENTHESES ) {
+            while ( m_operators.top() != '(' ) reduce();
+            m_operators.pop();
+        }
+        else {
+            while ( not m_operators.empty() and bares::precedence( infix.symbol( i ) ) <= bares::precedence( m_operators.top() ) )
+                reduce();
+            m_operators.push( infix.symbol( i ) );
+        }
+    }
+    while ( not m_operators.empty() ) reduce();
+    if ( not m_operands.empty() ) m_root = m_operands.top().node;
+    std::sort( m_hoisted.begin(), m_hoisted.end() );
+}
+
+/// Evaluates the operations in [lo, hi) of the arena, in order; false if one divided by zero.
+bool Ast::run( std::size_t lo, std::size_t hi, value_type & last, bool skip_hoisted ) {
+    bool ok { true };
+    for ( std::size_t i { lo }; i < hi; i++ ) {
+        Node & n = m_nodes[i];
+        if ( n.op == 0 or ( skip_hoisted and n.hoisted ) ) continue;
+        // On a division by zero `last` keeps the previous result, which stands in for the quotient.
+        if ( not bares::apply_operator( n.op, m_nodes[n.lhs].value, m_nodes[n.rhs].value, last ) ) ok = false;
+        n.value = last;
+    }
+    return ok;
+}
+
+/// Evaluates the tree in the order of the postfix list, visiting shared nodes every time.
+Ast::value_type Ast::run_postfix( bool & division_by_zero ) {
+    m_work.clear();
+    m_values.clear();
+    value_type result {0};
+    division_by_zero = false;
+    m_work.push( std::uint64_t{ m_root } << 1 );
+    while ( not m_work.empty() ) {
+        const std::uint64_t item { m_work.pop() };
+        const Node & n = m_nodes[item >> 1];
+        if ( n.op == 0 )
+            m_values.push( n.value );
+        else if ( ( item & 1 ) == 0 ) {
+            m_work.push( item | 1 );
+            m_work.push( std::uint64_t{ n.rhs } << 1 );
+            m_work.push( std::uint64_t{ n.lhs } << 1 );
+        }
+        else {
+            const value_type rhs { m_values.pop() };
+            const value_type lhs { m_values.pop() };
+            if ( not bares::apply_operator( n.op, lhs, rhs, result ) ) division_by_zero = true;
+            m_values.push( result );
+        }
+    }
+    return m_values.pop();
+}
+
+/// Splits the heaviest subtrees until there is one independent subtree per thread.
+void Ast::pick_tasks( std::size_t threads, std::size_t min_task ) {
+    m_tasks.clear();
+    if ( threads < 2 or m_root == NONE or m_nodes[m_root].op == 0 ) return;
+    auto lighter = [&]( index_type a, index_type b ) { return weight( a ) < weight( b ); };
+    if ( weight( m_root ) < min_task ) return;
+    m_tasks.push_back( m_root );
+    for ( ;; ) {
+        auto heaviest = std::max_element( m_tasks.begin(), m_tasks.end(), lighter );
+        const index_type h { *heaviest };
+        if ( m_nodes[h].independent and m_tasks.size() >= threads ) break;
+        // Its operands take its place, if they were created for it and are heavy enough for a thread
+        // (the others are left for the end, like the node itself, which keeps the list short).
+        const Node & n = m_nodes[h];
+        const bool lhs { n.lhs >= n.first and m_nodes[n.lhs].op != 0 and weight( n.lhs ) >= min_task };
+        const bool rhs { n.rhs > n.lhs and n.rhs >= n.first and m_nodes[n.rhs].op != 0 and weight( n.rhs ) >= min_task };
+        if ( m_nodes[h].independent and not lhs and not rhs ) break;
+        *heaviest = m_tasks.back();
+        m_tasks.pop_back();
+        if ( lhs ) m_tasks.push_back( n.lhs );
+        if ( rhs ) m_tasks.push_back( n.rhs );
+        if ( m_tasks.empty() ) break;
+    }
+    // Keep the heaviest independent subtrees, in the order of the arena.
+    m_tasks.erase( std::remove_if( m_tasks.begin(), m_tasks.end(), [&]( index_type i ) {
+        return not m_nodes[i].independent;
+    } ), m_tasks.end() );
+    if ( m_tasks.size() > threads ) {
+        std::sort( m_tasks.begin(), m_tasks.end(), [&]( index_type a, index_type b ) { return lighter( b, a ); } );
+        m_tasks.resize( threads );
+    }
+    std::sort( m_tasks.begin(), m_tasks.end() );
+}
+
+/// Computes the expression.
+BaresManager::Result Ast::evaluate( std::size_t threads, std::size_t min_task ) {
+    if ( m_root == NONE ) return BaresManager::Result{ Parser::ResultType{}, 0 };
+    value_type last {0};
+    bool ok { true };
+    pick_tasks( threads, min_task );
+    if ( m_tasks.empty() )
+        ok = run( 0, m_nodes.size(), last, false );
+    else {
+        // First the nodes read across subtrees, which are few, then each thread computes the
+        // range of its subtree, then the rest is done in arena order.
+        for ( index_type i : m_hoisted ) ok = run( i, i + std::size_t{1}, last, false ) and ok;
+        std::vector< char > task_ok( m_tasks.size(), 1 );
+        auto compute = [&]( std::size_t t ) {
+            value_type task_last {0};
+            task_ok[t] = run( m_nodes[m_tasks[t]].first, m_tasks[t] + std::size_t{1}, task_last, true );
+        };
+        std::vector< std::thread > workers;
+        for ( std::size_t t {1}; t < m_tasks.size(); t++ ) workers.emplace_back( compute, t );
+        compute( 0 );
+        for ( auto & w : workers ) w.join();
+        std::size_t next {0};
+        for ( std::size_t t {0}; t < m_tasks.size(); t++ ) {
+            ok = run( next, m_nodes[m_tasks[t]].first, last, true ) and ok and task_ok[t];
+            next = m_tasks[t] + std::size_t{1};
+        }
+        ok = run( next, m_nodes.size(), last, true ) and ok;
+    }
+
+    value_type result { m_nodes[m_root].value };
+    bool division_by_zero { not ok };
+    // The previous node is the previous operation only on one thread without sharing.
+    if ( division_by_zero and ( m_terms != m_nodes.size() or not m_tasks.empty() ) )
+        result = run_postfix( division_by_zero );
+
+    if ( result < std::numeric_limits< Parser::required_int_type >::min() or
+         result > std::numeric_limits< Parser::required_int_type >::max() )
+        return BaresManager::Result{ Parser::ResultType{ Parser::ResultType::OVERFLOW_ERROR }, 0 };
+    return BaresManager::Result{ Parser::ResultType{ division_by_zero ? Parser::ResultType::DIVISION_BY_ZERO
+                                                                      : Parser::ResultType::OK },
+                                 static_cast< Parser::required_int_type >( result ) };
+}
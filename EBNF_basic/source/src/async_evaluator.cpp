@@ -0,0 +1,56 @@
+#include <algorithm> // std::max
+
+#include "../include/async_evaluator.h"
+
+/// Creates an evaluator.
+BatchEvaluator::BatchEvaluator( std::size_t batch_size, std::size_t max_depth )
+    : m_batch_size { std::max< std::size_t >( batch_size, 1 ) },
+      m_bm { max_depth } {
+    m_pending.reserve( m_batch_size );
+    m_batch.reserve( m_batch_size );
+}
+
+/// The evaluator of the calling thread.
+BatchEvaluator & BatchEvaluator::local( void ) {
+    static thread_local BatchEvaluator evaluator;
+    return evaluator;
+}
+
+/// Adds an expression to the batch, and evaluates the batch if it is full.
+bool BatchEvaluator::enqueue( Awaiter * awaiter, std::coroutine_handle<> waiting ) {
+    awaiter->m_waiting = waiting;
+    m_pending.push_back( awaiter );
+    if ( m_running or m_pending.size() < m_batch_size ) return true;
+    // The coroutine that fills the batch is not suspended: it goes on once the others had their turn.
+    run_batch( awaiter );
+    return false;
+}
+
+/// Evaluates the expressions waiting, and those the resumed coroutines add, until there are none.
+std::size_t BatchEvaluator::flush( void ) {
+    // A coroutine of a batch that flushes leaves the next batch to whoever runs this one.
+    if ( m_running ) return 0;
+    std::size_t resumed {0};
+    while ( not m_pending.empty() )
+        resumed += run_batch( nullptr );
+    return resumed;
+}
+
+/// Evaluates the batch and resumes its coroutines, all but `current`.
+std::size_t BatchEvaluator::run_batch( const Awaiter * current ) {
+    m_running = true;
+    m_batch.swap( m_pending );
+    for ( Awaiter * a : m_batch )
+        a->m_result = m_bm.evaluate( a->m_expr );
+    m_batches++;
+    // The resumed coroutines may await again: they go to m_pending, for the next batch.
+    std::size_t resumed {0};
+    for ( Awaiter * a : m_batch ) {
+        if ( a == current ) continue;
+        a->m_waiting.resume();
+        resumed++;
+    }
+    m_batch.clear();
+    m_running = false;
+    return resumed;
+}
@@ -0,0 +1,421 @@
+#include <cerrno>    // errno
+#include <climits>   // INT_MIN
+#include <cstdlib>   // std::aligned_alloc, std::free
+#include <cstring>   // std::memcpy, std::strerror
+#include <iostream>  // std::cerr
+#include <stdexcept> // std::runtime_error
+#include <string>    // std::string
+
+#include <fcntl.h>     // fcntl()
+#include <sys/stat.h>  // fstat()
+#include <unistd.h>    // read(), write(), pread(), pwrite(), lseek()
+
+#if defined(BARES_IO_URING) && defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define BARES_HAVE_URING 1
+#include <linux/io_uring.h> // struct io_uring_params, struct io_uring_sqe, ...
+#include <sys/mman.h>       // mmap()
+#include <sys/syscall.h>    // __NR_io_uring_setup, ...
+#include <sys/uio.h>        // struct iovec
+#endif
+
+#include "../include/async_io.h"
+
+namespace {
+    constexpr int IN_FLIGHT = INT_MIN;     //!< Marks a buffer whose operation has not completed yet.
+    constexpr std::size_t PAGE = 4096;     //!< Buffers are page aligned, as O_DIRECT and the kernel like them.
+
+    /// Reports a failed system call.
+    [[noreturn]] void fail( const char * what, int err ) {
+        throw std::runtime_error( std::string{ what } + ": " + std::strerror( err ) );
+    }
+
+    /// Tells whether the descriptor is a regular file we can address by offset.
+    bool seekable_fd( int fd ) {
+        struct stat st;
+        if ( fstat( fd, &st ) != 0 or not S_ISREG( st.st_mode ) ) return false;
+        int flags = fcntl( fd, F_GETFL );
+        return flags != -1 and ( flags & O_APPEND ) == 0;
+    }
+
+    /// Allocates the page aligned memory for all the buffers.
+    char * alloc_buffers( std::size_t & buffer_size, std::size_t n_buffers ) {
+        buffer_size = ( buffer_size + PAGE - 1 ) / PAGE * PAGE;
+        auto * memory = static_cast< char * >( std::aligned_alloc( PAGE, buffer_size * n_buffers ) );
+        if ( memory == nullptr ) throw std::bad_alloc();
+        return memory;
+    }
+}
+
+#ifdef BARES_HAVE_URING
+/// A minimal io_uring instance, driven by the raw system calls.
+class Uring {
+    public:
+        /// Creates an instance, or returns null if the kernel does not allow it.
+        static std::unique_ptr< Uring > create( unsigned entries ) {
+            std::unique_ptr< Uring > ring { new Uring };
+            if ( not ring->setup( entries ) ) return nullptr;
+            return ring;
+        }
+
+        ~Uring() {
+            if ( m_sqes != nullptr ) munmap( m_sqes, m_sqes_size );
+            if ( m_cq_ptr != nullptr and m_cq_ptr != m_sq_ptr ) munmap( m_cq_ptr, m_cq_size );
+            if ( m_sq_ptr != nullptr ) munmap( m_sq_ptr, m_sq_size );
+            if ( m_fd >= 0 ) close( m_fd );
+        }
+
+        /// Registers the buffers, so the kernel does not have to map them on every operation.
+        bool register_buffers( char * memory, std::size_t buffer_size, std::size_t n_buffers ) {
+            sc::vector< struct iovec > iov( n_buffers );
+            for ( std::size_t i {0}; i < n_buffers; i++ ) {
+                iov[i].iov_base = memory + i * buffer_size;
+                iov[i].iov_len = buffer_size;
+            }
+            m_fixed = syscall( __NR_io_uring_register, m_fd, IORING_REGISTER_BUFFERS,
+                               iov.data(), static_cast< unsigned >( n_buffers ) ) == 0;
+            return m_fixed;
+        }
+
+        /// Queues a read (`write` false) or a write of a buffer; it starts on the next enter().
+        void prepare( bool write, int fd, char * addr, unsigned len, std::uint64_t offset,
+                      unsigned buffer, std::uint64_t user_data ) {
+            unsigned tail = *m_sq_tail;
+            unsigned index = tail & *m_sq_mask;
+            struct io_uring_sqe * sqe = &m_sqes[index];
+            std::memset( sqe, 0, sizeof( *sqe ) );
+            if ( m_fixed ) {
+                sqe->opcode = write ? IORING_OP_WRITE_FIXED : IORING_OP_READ_FIXED;
+                sqe->buf_index = static_cast< __u16 >( buffer );
+            }
+            else
+                sqe->opcode = write ? IORING_OP_WRITE : IORING_OP_READ;
+            sqe->fd = fd;
+            sqe->addr = reinterpret_cast< std::uint64_t >( addr );
+            sqe->len = len;
+            sqe->off = offset;
+            sqe->user_data = user_data;
+            m_sq_array[index] = index;
+            __atomic_store_n( m_sq_tail, tail + 1, __ATOMIC_RELEASE );
+            m_to_submit++;
+        }
+
+        /// Submits the queued operations and, if asked, waits for at least one completion.
+        void enter( unsigned min_complete ) {
+            for ( ;; ) {
+                long r = syscall( __NR_io_uring_enter, m_fd, m_to_submit, min_complete,
+                                  min_complete > 0 ? IORING_ENTER_GETEVENTS : 0, nullptr, 0 );
+                if ( r >= 0 ) {
+                    m_to_submit -= static_cast< unsigned >( r );
+                    return;
+                }
+                if ( errno != EINTR and errno != EAGAIN ) fail( "io_uring_enter", errno );
+            }
+        }
+
+        /// Takes a completion, if there is one.
+        bool reap( std::uint64_t & user_data, int & res ) {
+            unsigned head = *m_cq_head;
+            if ( head == __atomic_load_n( m_cq_tail, __ATOMIC_ACQUIRE ) ) return false;
+            const struct io_uring_cqe & cqe = m_cqes[head & *m_cq_mask];
+            user_data = cqe.user_data;
+            res = cqe.res;
+            __atomic_store_n( m_cq_head, head + 1, __ATOMIC_RELEASE );
+            return true;
+        }
+
+    private:
+        int m_fd {-1};
+        bool m_fixed {false};
+        unsigned m_to_submit {0};
+        void * m_sq_ptr {nullptr};
+        void * m_cq_ptr {nullptr};
+        std::size_t m_sq_size {0}, m_cq_size {0}, m_sqes_size {0};
+        struct io_uring_sqe * m_sqes {nullptr};
+        unsigned * m_sq_head {nullptr}, * m_sq_tail {nullptr}, * m_sq_mask {nullptr}, * m_sq_array {nullptr};
+        unsigned * m_cq_head {nullptr}, * m_cq_tail {nullptr}, * m_cq_mask {nullptr};
+        struct io_uring_cqe * m_cqes {nullptr};
+
+        Uring() = default;
+
+        /// Creates the instance and maps its rings, as described in io_uring_setup(2).
+        bool setup( unsigned entries ) {
+            struct io_uring_params p;
+            std::memset( &p, 0, sizeof( p ) );
+            m_fd = static_cast< int >( syscall( __NR_io_uring_setup, entries, &p ) );
+            if ( m_fd < 0 ) return false;
+
+            m_sq_size = p.sq_off.array + p.sq_entries * sizeof( unsigned );
+            m_cq_size = p.cq_off.cqes + p.cq_entries * sizeof( struct io_uring_cqe );
+            bool single = ( p.features & IORING_FEAT_SINGLE_MMAP ) != 0;
+            if ( single ) m_sq_size = m_cq_size = std::max( m_sq_size, m_cq_size );
+
+            m_sq_ptr = mmap( nullptr, m_sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                             m_fd, IORING_OFF_SQ_RING );
+            if ( m_sq_ptr == MAP_FAILED ) { m_sq_ptr = nullptr; return false; }
+            if ( single )
+                m_cq_ptr = m_sq_ptr;
+            else {
+                m_cq_ptr = mmap( nullptr, m_cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                 m_fd, IORING_OFF_CQ_RING );
+                if ( m_cq_ptr == MAP_FAILED ) { m_cq_ptr = nullptr; return false; }
+            }
+            m_sqes_size = p.sq_entries * sizeof( struct io_uring_sqe );
+            void * sqes = mmap( nullptr, m_sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                m_fd, IORING_OFF_SQES );
+            if ( sqes == MAP_FAILED ) return false;
+            m_sqes = static_cast< struct io_uring_sqe * >( sqes );
+
+            char * sq = static_cast< char * >( m_sq_ptr );
+            m_sq_head = reinterpret_cast< unsigned * >( sq + p.sq_off.head );
+            m_sq_tail = reinterpret_cast< unsigned * >( sq + p.sq_off.tail );
+            m_sq_mask = reinterpret_cast< unsigned * >( sq + p.sq_off.ring_mask );
+            m_sq_array = reinterpret_cast< unsigned * >( sq + p.sq_off.array );
+            char * cq = static_cast< char * >( m_cq_ptr );
+            m_cq_head = reinterpret_cast< unsigned * >( cq + p.cq_off.head );
+            m_cq_tail = reinterpret_cast< unsigned * >( cq + p.cq_off.tail );
+            m_cq_mask = reinterpret_cast< unsigned * >( cq + p.cq_off.ring_mask );
+            m_cqes = reinterpret_cast< struct io_uring_cqe * >( cq + p.cq_off.cqes );
+            return true;
+        }
+};
+#else
+/// Stand-in used when the io_uring backend is not built: it is never available.
+class Uring {
+    public:
+        static std::unique_ptr< Uring > create( unsigned ) { return nullptr; }
+        bool register_buffers( char *, std::size_t, std::size_t ) { return false; }
+        void prepare( bool, int, char *, unsigned, std::uint64_t, unsigned, std::uint64_t ) {}
+        void enter( unsigned ) {}
+        bool reap( std::uint64_t &, int & ) { return false; }
+};
+#endif
+
+namespace {
+    /// Creates the io_uring instance for a backend choice, or returns null to use read()/write().
+    std::unique_ptr< Uring > open_ring( IoBackend backend, char * memory, std::size_t buffer_size,
+                                        std::size_t n_buffers ) {
+        if ( backend == IoBackend::SYNC ) return nullptr;
+        auto ring = Uring::create( static_cast< unsigned >( 2 * n_buffers ) );
+        if ( ring == nullptr ) {
+            if ( backend == IoBackend::URING )
+                std::cerr << "io_uring is not available, using read()/write() instead.\n";
+            return nullptr;
+        }
+        // Without registered buffers (e.g. a low RLIMIT_MEMLOCK) the plain read/write opcodes still work.
+        ring->register_buffers( memory, buffer_size, n_buffers );
+        return ring;
+    }
+}
+
+//=== AsyncInput
+
+/// Prepares to read a file descriptor.
+AsyncInput::AsyncInput( int fd, IoBackend backend, std::size_t buffer_size, std::size_t n_buffers )
+    : m_fd { fd },
+      m_buffer_size { buffer_size },
+      m_n_buffers { std::max< std::size_t >( n_buffers, 2 ) },
+      m_memory { alloc_buffers( m_buffer_size, m_n_buffers ) },
+      m_ring { open_ring( backend, m_memory, m_buffer_size, m_n_buffers ) },
+      m_seekable { seekable_fd( fd ) },
+      m_offset { 0 },
+      m_result( m_n_buffers ),
+      m_pos( m_n_buffers ),
+      m_next { 0 },
+      m_issued { 0 },
+      m_held { false },
+      m_eof { false } {
+    if ( m_seekable ) {
+        off_t pos = lseek( fd, 0, SEEK_CUR );
+        m_offset = pos > 0 ? static_cast< std::uint64_t >( pos ) : 0;
+    }
+}
+
+/// Waits for the reads still in flight, since the kernel may still write to the buffers.
+AsyncInput::~AsyncInput() {
+    try { drain(); } catch ( const std::exception & ) { /* nothing else to do */ }
+    m_ring.reset();
+    std::free( m_memory );
+}
+
+/// Issues reads into the free buffers, in order.
+void AsyncInput::issue( void ) {
+    bool issued_any { false };
+    while ( m_issued + ( m_held ? 1 : 0 ) < m_n_buffers ) {
+        // Reads from pipes and terminals go one at a time, or they could complete out of order.
+        if ( not m_seekable and m_issued > 0 ) break;
+        std::size_t b = ( m_next + m_issued ) % m_n_buffers;
+        m_result[b] = IN_FLIGHT;
+        m_pos[b] = m_offset;
+        m_ring->prepare( false, m_fd, m_memory + b * m_buffer_size, static_cast< unsigned >( m_buffer_size ),
+                         m_seekable ? m_offset : static_cast< std::uint64_t >( -1 ), static_cast< unsigned >( b ), b );
+        m_offset += m_buffer_size;
+        m_issued++;
+        issued_any = true;
+    }
+    if ( issued_any ) m_ring->enter( 0 );
+}
+
+/// Waits until the read of a buffer completes.
+void AsyncInput::wait( std::size_t buffer ) {
+    std::uint64_t user_data;
+    int res;
+    while ( m_result[buffer] == IN_FLIGHT ) {
+        if ( m_ring->reap( user_data, res ) )
+            m_result[user_data] = res;
+        else
+            m_ring->enter( 1 );
+    }
+}
+
+/// Waits for all reads in flight; their data is dropped.
+void AsyncInput::drain( void ) {
+    if ( m_ring == nullptr ) return;
+    for ( std::size_t k {0}; k < m_issued; k++ )
+        wait( ( m_next + k ) % m_n_buffers );
+    m_issued = 0;
+}
+
+/// Gets the next piece of the input.
+std::string_view AsyncInput::next_chunk( void ) {
+    if ( m_eof ) return {};
+    m_held = false; // The caller is done with the previous chunk.
+    char * buffer = m_memory + m_next * m_buffer_size;
+
+    if ( m_ring == nullptr ) {
+        ssize_t r;
+        do r = ::read( m_fd, buffer, m_buffer_size ); while ( r < 0 and errno == EINTR );
+        if ( r < 0 ) fail( "read", errno );
+        if ( r == 0 ) { m_eof = true; return {}; }
+        m_next = ( m_next + 1 ) % m_n_buffers;
+        return std::string_view{ buffer, static_cast< std::size_t >( r ) };
+    }
+
+    issue();
+    std::size_t b = m_next;
+    wait( b );
+    int res = m_result[b];
+    m_next = ( b + 1 ) % m_n_buffers;
+    m_issued--;
+    if ( res < 0 ) fail( "io_uring read", -res );
+    if ( res == 0 ) {
+        m_eof = true;
+        drain();
+        return {};
+    }
+    if ( m_seekable and static_cast< std::size_t >( res ) < m_buffer_size ) {
+        // A short read: the reads issued after it start at the wrong offset, read them again.
+        drain();
+        m_offset = m_pos[b] + static_cast< std::uint64_t >( res );
+    }
+    m_held = true;
+    issue(); // Keep reading ahead while the caller works on this chunk.
+    return std::string_view{ buffer, static_cast< std::size_t >( res ) };
+}
+
+//=== AsyncOutput
+
+/// Prepares to write to a file descriptor.
+AsyncOutput::AsyncOutput( int fd, IoBackend backend, std::size_t buffer_size, std::size_t n_buffers )
+    : m_fd { fd },
+      m_buffer_size { buffer_size },
+      m_n_buffers { std::max< std::size_t >( n_buffers, 2 ) },
+      m_memory { alloc_buffers( m_buffer_size, m_n_buffers ) },
+      m_ring { open_ring( backend, m_memory, m_buffer_size, m_n_buffers ) },
+      m_seekable { seekable_fd( fd ) },
+      m_offset { 0 },
+      m_pending( m_n_buffers ),
+      m_pos( m_n_buffers ),
+      m_current { 0 },
+      m_used { 0 } {
+    if ( m_seekable ) {
+        off_t pos = lseek( fd, 0, SEEK_CUR );
+        m_offset = pos > 0 ? static_cast< std::uint64_t >( pos ) : 0;
+    }
+    for ( std::size_t b {0}; b < m_n_buffers; b++ ) m_pending[b] = 0;
+}
+
+/// Writes what is left and waits for all writes.
+AsyncOutput::~AsyncOutput() {
+    try { flush(); } catch ( const std::exception & e ) { std::cerr << e.what() << '\n'; }
+    m_ring.reset();
+    std::free( m_memory );
+}
+
+/// Blocking write of a whole range, used by the read()/write() backend and after short writes.
+void AsyncOutput::write_all( const char * data, std::size_t size, std::uint64_t offset ) {
+    while ( size > 0 ) {
+        ssize_t w = m_seekable ? ::pwrite( m_fd, data, size, static_cast< off_t >( offset ) )
+                               : ::write( m_fd, data, size );
+        if ( w < 0 ) {
+            if ( errno == EINTR ) continue;
+            fail( "write", errno );
+        }
+        data += w;
+        size -= static_cast< std::size_t >( w );
+        offset += static_cast< std::uint64_t >( w );
+    }
+}
+
+/// Waits until the write of a buffer completes, finishing it by hand if it was short.
+void AsyncOutput::wait( std::size_t buffer ) {
+    std::uint64_t user_data;
+    int res;
+    while ( m_pending[buffer] > 0 ) {
+        if ( not m_ring->reap( user_data, res ) ) {
+            m_ring->enter( 1 );
+            continue;
+        }
+        int expected = m_pending[user_data];
+        m_pending[user_data] = 0;
+        if ( res < 0 ) fail( "io_uring write", -res );
+        if ( res < expected )
+            write_all( m_memory + user_data * m_buffer_size + res, static_cast< std::size_t >( expected - res ),
+                       m_pos[user_data] + static_cast< std::uint64_t >( res ) );
+    }
+}
+
+/// Sends the current buffer and moves on to the next one.
+void AsyncOutput::submit( void ) {
+    if ( m_used == 0 ) return;
+    char * buffer = m_memory + m_current * m_buffer_size;
+    if ( m_ring == nullptr ) {
+        write_all( buffer, m_used, m_offset );
+        m_offset += m_used;
+        m_used = 0;
+        return;
+    }
+    // Writes to pipes and terminals go one at a time, or they could land out of order.
+    if ( not m_seekable )
+        for ( std::size_t b {0}; b < m_n_buffers; b++ ) wait( b );
+    m_pending[m_current] = static_cast< int >( m_used );
+    m_pos[m_current] = m_offset;
+    m_ring->prepare( true, m_fd, buffer, static_cast< unsigned >( m_used ),
+                     m_seekable ? m_offset : static_cast< std::uint64_t >( -1 ),
+                     static_cast< unsigned >( m_current ), m_current );
+    m_ring->enter( 0 );
+    m_offset += m_used;
+    m_current = ( m_current + 1 ) % m_n_buffers;
+    m_used = 0;
+    wait( m_current ); // Only waits if the device is a whole ring of buffers behind.
+}
+
+/// Appends bytes to the output.
+void AsyncOutput::write( const char * data, std::size_t size ) {
+    while ( size > 0 ) {
+        if ( m_used == m_buffer_size ) submit();
+        std::size_t n = std::min( size, m_buffer_size - m_used );
+        std::memcpy( m_memory + m_current * m_buffer_size + m_used, data, n );
+        m_used += n;
+        data += n;
+        size -= n;
+    }
+}
+
+/// Sends everything written so far and waits until the device got it.
+void AsyncOutput::flush( void ) {
+    submit();
+    if ( m_ring != nullptr )
+        for ( std::size_t b {0}; b < m_n_buffers; b++ ) wait( b );
+    // Writes at explicit offsets do not move the file position; leave it after our data.
+    if ( m_seekable ) lseek( m_fd, static_cast< off_t >( m_offset ), SEEK_SET );
+}
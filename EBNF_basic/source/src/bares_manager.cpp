@@ -1,8 +1,13 @@
+#include <algorithm> // std::min
+#include <charconv>  // std::to_chars
 #include <iostream>
 #include <iomanip>
 
 #include "../lib/vector.h"
 #include "../include/bares_manager.h"
+#include "../include/arithmetic.h"
+#include "../include/program.h"
+#include "../include/ast.h"
 
 /// List of expressions to evaluate and tokenize.
 sc::vector<std::string> expressions = {
@@ -26,175 +31,211 @@ sc::vector<std::string> expressions = {
 };
 
 /// Send to the standard output the proper error messages.
-void BaresManager::print_error_msg( const Parser::ResultType & result, const std::string &str ) {
-    std::string error_indicator( str.size()+1, ' ');
+void BaresManager::print_error_msg( const Parser::ResultType & result, const std::string &str, Format format ) {
+    // Only the message of this line is made, in the format asked for.
+    std::string msg;
+    append_result( Result{ result, 0 }, msg, format, str );
+    std::cout << msg;
+}
+
+namespace {
+    /// Appends an integer without going through a temporary string.
+    void append_number( long long value, std::string & out ) {
+        char digits[24];
+        auto end = std::to_chars( digits, digits + sizeof( digits ), value ).ptr;
+        out.append( digits, end );
+    }
+
+    /// Appends a message that ends with the column of the error, counted from 1.
+    void append_at_col( const char * msg, const Parser::ResultType & status, std::string & out ) {
+        out += msg;
+        out += " at column (";
+        append_number( status.at_col + 1, out );
+        out += ")!";
+    }
+}
+
+/// The name of a result code.
+const char * BaresManager::code_name( Parser::ResultType::code_t code ) {
+    switch ( code ) {
+        case Parser::ResultType::OK:                           return "OK";
+        case Parser::ResultType::UNEXPECTED_END_OF_EXPRESSION: return "UNEXPECTED_END_OF_EXPRESSION";
+        case Parser::ResultType::ILL_FORMED_INTEGER:           return "ILL_FORMED_INTEGER";
+        case Parser::ResultType::MISSING_TERM:                 return "MISSING_TERM";
+        case Parser::ResultType::EXTRANEOUS_SYMBOL:            return "EXTRANEOUS_SYMBOL";
+        case Parser::ResultType::INTEGER_OUT_OF_RANGE:         return "INTEGER_OUT_OF_RANGE";
+        case Parser::ResultType::MISSING_CLOSING:              return "MISSING_CLOSING";
+        case Parser::ResultType::DIVISION_BY_ZERO:             return "DIVISION_BY_ZERO";
+        case Parser::ResultType::OVERFLOW_ERROR:               return "OVERFLOW_ERROR";
+        case Parser::ResultType::NESTING_TOO_DEEP:             return "NESTING_TOO_DEEP";
+    }
+    return "UNKNOWN";
+}
 
-    // Have we got a parsing error?
-    error_indicator[result.at_col] = '^';
-    switch ( result.type ) {
+/// Append to a string the line the program prints for a result.
+void BaresManager::append_result( const Result & res, std::string & out ) {
+    switch ( res.status.type ) {
+        case Parser::ResultType::OK:
+            append_number( res.value, out );
+            break;
         case Parser::ResultType::UNEXPECTED_END_OF_EXPRESSION:
-            std::cout << "Unexpected end of input at column (" << result.at_col+1 << ")!\n";
+            append_at_col( "Unexpected end of input", res.status, out );
             break;
         case Parser::ResultType::ILL_FORMED_INTEGER:
-            std::cout << "Ill formed integer at column (" << result.at_col+1 << ")!\n";
+            append_at_col( "Ill formed integer", res.status, out );
             break;
         case Parser::ResultType::MISSING_TERM:
-            std::cout << "Missing <term> at column (" << result.at_col+1 << ")!\n";
+            append_at_col( "Missing <term>", res.status, out );
             break;
         case Parser::ResultType::EXTRANEOUS_SYMBOL:
-            std::cout << "Extraneous symbol after valid expression found at column (" << result.at_col+1 << ")!\n";
+            append_at_col( "Extraneous symbol after valid expression found", res.status, out );
             break;
         case Parser::ResultType::INTEGER_OUT_OF_RANGE:
-            std::cout << "Integer constant out of range beginning at column (" << result.at_col+1 << ")!\n";
+            append_at_col( "Integer constant out of range beginning", res.status, out );
             break;
         case Parser::ResultType::MISSING_CLOSING:
-            std::cout << "Missing closing \")\" at column (" << result.at_col+1 << ")!\n";
+            append_at_col( "Missing closing \")\"", res.status, out );
             break;
         case Parser::ResultType::DIVISION_BY_ZERO:
-            std::cout << "Division by zero!\n";
+            out += "Division by zero!";
             break;
         case Parser::ResultType::OVERFLOW_ERROR:
-            std::cout << "Numeric overflow error!\n";
+            out += "Numeric overflow error!";
+            break;
+        case Parser::ResultType::NESTING_TOO_DEEP:
+            append_at_col( "Too many nested parentheses", res.status, out );
             break;
         default:
-            std::cout << "Unhandled error found!\n";
+            out += "Unhandled error found!";
             break;
     }
-    //? Indicate the column of error.
-    // std::cout << "\"" << str << "\"\n";
-    // std::cout << " " << error_indicator << std::endl;
+    out += '\n';
+}
+
+/// Append to a string the text of a result in a given format.
+void BaresManager::append_result( const Result & res, std::string & out, Format format, std::string_view expr ) {
+    if ( format == Format::JSON ) {
+        out += "{\"status\":\"";
+        out += code_name( res.status.type );
+        if ( res.status.type == Parser::ResultType::OK ) {
+            out += "\",\"value\":";
+            append_number( res.value, out );
+        }
+        else if ( has_column( res.status.type ) ) {
+            out += "\",\"column\":";
+            append_number( res.status.at_col + 1, out );
+        }
+        else
+            out += '"';
+        out += "}\n";
+        return;
+    }
+    append_result( res, out );
+    if ( format == Format::CARET and has_column( res.status.type ) ) {
+        // The expression, then a "^" under the column (tabs kept, so it lines up).
+        out.append( expr );
+        out += '\n';
+        const auto col = std::min( static_cast< std::size_t >( res.status.at_col ), expr.size() );
+        for ( std::size_t i {0}; i < col; i++ )
+            out += expr[i] == '\t' ? '\t' : ' ';
+        out += "^\n";
+    }
 }
 
 /// Function to return precedence of operators
 int BaresManager::prec(std::string c) {
-    if (c == "^")
-        return 3;
-    else if (c == "/" || c == "*" || c == "%")
-        return 2;
-    else if (c == "+" || c == "-")
-        return 1;
-    else
-        return -1;
+    return c.size() == 1 ? bares::precedence(c[0]) : -1;
 }
 
 /// The main function to convert infix expression
 /// to postfix expression
 void BaresManager::infix_to_postfix(void) {
-    sta::stack<Token> st; // For stack operations
-    sc::vector<Token> pf_tk_list;
+    // The parser told how deep the stack gets: no allocation and no checks in the loop.
+    operators.clear();
+    operators.reserve(operator_depth);
+    postfix.clear();
+    postfix.reserve(tokens.size());
 
     for (size_t i{0}; i < tokens.size(); i++) {
-        Token c = tokens[i];
+        const Token::token_t type = tokens.kind(i);
 
         // If the scanned character is
         // an operand, add it to output string.
-        if (c.type == Token::token_t::OPERAND)
-            pf_tk_list.push_back(c);
+        if (type == Token::token_t::OPERAND)
+            postfix.push(tokens, i);
 
         // If the scanned character is an
         // ‘(‘, push it to the stack.
-        else if (c.type == Token::token_t::OPEN_PARENTHESES)
-            st.push(c);
+        else if (type == Token::token_t::OPEN_PARENTHESES)
+            operators.push_unchecked(i);
 
         // If the scanned character is an ‘)’,
         // pop and to output string from the stack
         // until an ‘(‘ is encountered.
-        else if (c.type == Token::token_t::CLOSE_PARENTHESES) {
-            while (st.top().type != Token::token_t::OPEN_PARENTHESES)
-            {
-                pf_tk_list.push_back(st.top());
-                st.pop();
-            }
-            st.pop();
+        else if (type == Token::token_t::CLOSE_PARENTHESES) {
+            while (tokens.kind(operators.top()) != Token::token_t::OPEN_PARENTHESES)
+                postfix.push(tokens, operators.pop_unchecked());
+            operators.pop_unchecked();
         }
 
         //If an operator is scanned
         else {
-            while (not st.empty() and prec(tokens[i].value) <= prec(st.top().value)) {
-                pf_tk_list.push_back(st.top());
-                st.pop();
-            }
-            st.push(c);
+            while (not operators.empty() and bares::precedence(tokens.symbol(i)) <= bares::precedence(tokens.symbol(operators.top())))
+                postfix.push(tokens, operators.pop_unchecked());
+            operators.push_unchecked(i);
         }
     }
 
     // Pop all the remaining elements from the stack
-    while (not st.empty()) {
-        pf_tk_list.push_back(st.top());
-        st.pop();
-    }
+    while (not operators.empty())
+        postfix.push(tokens, operators.pop_unchecked());
 
-    tokens = pf_tk_list;
+    swap(tokens, postfix);
 }
 
-/// Function that calculates the postfix expression
-void BaresManager::calculate(void) {
-    sta::stack<Parser::input_int_type> st; // The stack to store the operands.
+/// Computes the postfix list, leaving the final value unchecked.
+Parser::input_int_type BaresManager::run_postfix(bool & borrowed) {
+    // The parser told how many operands pile up: no allocation and no checks in the loop.
+    operands.clear();
+    operands.reserve(operand_depth);
     Parser::input_int_type result{0}; // The result of expression;
+    char last_op{0}; // The operator that computed `result`.
+    borrowed = false;
 
     // Travels the tokens to calculate the expression.
     for (size_t i{0}; i < tokens.size(); i++) {
-        Token c = tokens[i];
-        // transform std::string to char[]
-        // to use atoll and switch
-        size_t sz = c.value.length();
-        // declaring character array
-        char c_value[sz + 1];
-        // copying the contents of the
-        // string to char array
-        std::strcpy(c_value, c.value.c_str());
-
-        // If it is an operand, transform in int and push on the stack.
-        if (c.type == Token::token_t::OPERAND) {
-            // transform in int and push on the stack.
-            Parser::input_int_type value = std::atoll(c_value);
-            st.push(value);
+        // If it is an operand, push its value on the stack.
+        if (tokens.kind(i) == Token::token_t::OPERAND) {
+            operands.push_unchecked(tokens.value(i));
         }
         // If it is an operator, pop twice on stack and calculate the expression.
         else {
             // Take from stack the two values that will be calculated.
-            Parser::input_int_type second_operand = st.top();
-            st.pop();
-            Parser::input_int_type first_operand = st.top();
-            st.pop();
+            Parser::input_int_type second_operand = operands.pop_unchecked();
+            Parser::input_int_type first_operand = operands.pop_unchecked();
             // To avoid special cases of operations with 0.
-            if ( second_operand == 0 and (c_value[0] == '/' or c_value[0] == '%') ) {
+            if ( not bares::apply_operator( tokens.symbol(i), first_operand, second_operand, result ) ) {
                 status = Parser::ResultType{ Parser::ResultType::DIVISION_BY_ZERO };
+                // The previous result stands in for the quotient: note when it is not of this term.
+                if ( last_op == 0 or last_op == '+' or last_op == '-' ) borrowed = true;
             }
-            else {
-                // Decide the operation that will be made.
-                switch (c_value[0]) {
-                    case '+':  result = first_operand + second_operand; break;
-                    case '-':  result = first_operand - second_operand; break;
-                    case '*':  result = first_operand * second_operand; break;
-                    case '/':  result = first_operand / second_operand; break;
-                    case '%':  result = first_operand % second_operand; break;
-                    case '^':
-                        // Calculate the exception of x^0 = 1
-                        if (second_operand == 0)
-                            result = 1;
-                        else if (second_operand < 0)
-                            result = 0;
-                        else {
-                            Parser::input_int_type expo = first_operand;
-                            while (second_operand != 1) {
-                                expo *= first_operand;
-                                second_operand--;
-                            }
-                            result = expo;
-                        }
-                }
-            }
+            last_op = tokens.symbol(i);
             // Insert the result on the top of stack.
-            st.push(result);
+            operands.push_unchecked(result);
         }
     }
     // Case of one operand is passed.
-    if (st.size() == 1) {
-        result = st.top();
-        st.pop();
+    if (operands.size() == 1) {
+        result = operands.pop_unchecked();
     }
-    
+    return result;
+}
+
+/// Function that calculates the postfix expression
+void BaresManager::calculate(void) {
+    bool borrowed;
+    Parser::input_int_type result = run_postfix(borrowed);
+
     // We calculate the result, just know if it is within the range (overflow occurred).
     if ( result < std::numeric_limits< Parser::required_int_type >::min() or
          result > std::numeric_limits< Parser::required_int_type >::max() ) {
@@ -206,9 +247,9 @@ void BaresManager::calculate(void) {
     }
 }
 
-/// Reads a line and compute a expression.
-void BaresManager::parse_and_compute(std::string expr) {
-    Parser parser; // Instancia um parser.
+/// Parse and compute an expression without writing anything.
+BaresManager::Result BaresManager::evaluate(const std::string & expr) {
+    Parser parser{ max_depth }; // Instancia um parser.
     final_value = 0;
 
     //======================================================================
@@ -241,13 +282,13 @@ void BaresManager::parse_and_compute(std::string expr) {
     //? Preparar cabeçalho da saida.
     // std::cout << std::setfill('=') << std::setw(80) << "\n";
     // std::cout << std::setfill(' ') << ">>> Parsing \"" << expr << "\"\n";
-    // Se deu pau, imprimir a mensagem adequada.
-    if ( status.type != Parser::ResultType::OK )
-        print_error_msg( status, expr );
-    else {
+    // Se deu certo, calcular o valor da expressão.
+    if ( status.type == Parser::ResultType::OK ) {
         // std::cout << ">>> Expression SUCCESSFULLY parsed!\n"; //? Deu certo.
         //* [II.1] Recuperar a lista de tokens no formato infixo.
-        tokens = parser.get_tokens();
+        tokens.assign(parser.tokens());
+        operator_depth = parser.operator_depth();
+        operand_depth = parser.operand_depth();
         // std::cout << ">>> Tokens: { ";
         // std::copy( tokens.begin(), tokens.end(),
         //         std::ostream_iterator< Token >(std::cout, " ") );
@@ -266,10 +307,92 @@ void BaresManager::parse_and_compute(std::string expr) {
 
         //* [III] Calcular a expressão pos fixa.
         calculate();
-        if ( status.type != Parser::ResultType::OK )
-            print_error_msg( status, expr );
-        else
-            std::cout << final_value << std::endl;
     }
+    return Result{ status, final_value };
+}
+
+/// Parse and compute an expression whose first bad byte is already known.
+BaresManager::Result BaresManager::evaluate(const std::string & expr, std::size_t invalid) {
+    if ( invalid == std::string::npos )
+        return evaluate(expr);
+    // Only white space before the bad byte: the first term is ill formed right there.
+    if ( expr.find_first_not_of(" \t\n\v\f\r") == invalid ) {
+        status = Parser::ResultType{ Parser::ResultType::ILL_FORMED_INTEGER,
+                                     static_cast< Parser::ResultType::size_type >( invalid ) };
+        final_value = 0;
+        return Result{ status, final_value };
+    }
+    // Otherwise the parser has to tell what the valid part before it is; it stops
+    // at the bad byte and the line never gets to the conversion or the calculation.
+    return evaluate(expr);
+}
+
+/// Parse and compute a piece of a longer expression.
+BaresManager::Piece BaresManager::evaluate_piece(const std::string & expr) {
+    Parser parser{ max_depth };
+    Piece piece{ parser.parse_and_tokenize(expr), 0, false };
+    if ( piece.status.type == Parser::ResultType::OK ) {
+        status = piece.status;
+        tokens.assign(parser.tokens());
+        operator_depth = parser.operator_depth();
+        operand_depth = parser.operand_depth();
+        infix_to_postfix();
+        piece.value = run_postfix(piece.borrowed);
+        piece.status = status;
+    }
+    return piece;
+}
+
+/// Parse an expression and compile it into a program, without computing it.
+Parser::ResultType BaresManager::compile(const std::string & expr, Program & program) {
+    Parser parser{ max_depth };
+    status = parser.parse_and_tokenize(expr);
+    if ( status.type == Parser::ResultType::OK ) {
+        tokens.assign(parser.tokens());
+        operator_depth = parser.operator_depth();
+        operand_depth = parser.operand_depth();
+        infix_to_postfix();
+        program = Program::compile(tokens);
+        status = program.diagnostic();
+    }
+    return status;
+}
+
+/// Parse an expression and build its syntax tree, without computing it.
+Parser::ResultType BaresManager::build_ast(const std::string & expr, Ast & ast, bool share) {
+    Parser parser{ max_depth };
+    status = parser.parse_and_tokenize(expr);
+    if ( status.type == Parser::ResultType::OK )
+        parser.build_ast(ast, share);
+    return status;
+}
+
+/// Parse an expression and give its tokens in postfix order, without computing it.
+Parser::ResultType BaresManager::to_postfix(const std::string & expr, TokenBuffer & out) {
+    Parser parser{ max_depth };
+    status = parser.parse_and_tokenize(expr);
+    if ( status.type == Parser::ResultType::OK ) {
+        tokens.assign(parser.tokens());
+        operator_depth = parser.operator_depth();
+        operand_depth = parser.operand_depth();
+        infix_to_postfix();
+        out.assign(tokens);
+    }
+    return status;
+}
+
+/// Reads a line and compute a expression.
+void BaresManager::parse_and_compute(std::string expr, Format format) {
+    Result res = evaluate( expr );
+    // Se deu pau, imprimir a mensagem adequada.
+    if ( res.status.type != Parser::ResultType::OK )
+        print_error_msg( res.status, expr, format );
+    else if ( format == Format::JSON ) {
+        std::string text;
+        append_result( res, text, format );
+        std::cout << text << std::flush;
+    }
+    else
+        std::cout << res.value << std::endl;
     // std::cout << "\n>>> Normal exiting...\n";
 }
\ No newline at end of file
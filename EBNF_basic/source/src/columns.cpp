@@ -0,0 +1,159 @@
+#include <bit>        // std::endian
+#include <cerrno>     // errno
+#include <cstring>    // std::memcmp, std::strerror
+#include <stdexcept>  // std::runtime_error
+#include <sys/mman.h> // mmap(), munmap(), madvise()
+#include <sys/stat.h> // fstat()
+
+#include "../include/columns.h"
+
+namespace {
+    /// Reports a file that cannot be read as columns.
+    [[noreturn]] void fail( const std::string & what ) {
+        throw std::runtime_error( "Binary results: " + what );
+    }
+
+    /// The next multiple of columns::ALIGNMENT.
+    constexpr std::size_t align( std::size_t n ) {
+        return ( n + columns::ALIGNMENT - 1 ) / columns::ALIGNMENT * columns::ALIGNMENT;
+    }
+
+    /// Appends an unsigned integer of `Bytes` bytes, little-endian.
+    template < std::size_t Bytes >
+    void put( std::uint64_t value, std::string & out ) {
+        for ( std::size_t i {0}; i < Bytes; i++ )
+            out += static_cast< char >( value >> ( 8 * i ) & 0xFF );
+    }
+
+    /// Reads an unsigned integer of `Bytes` bytes, little-endian (a single load on such machines).
+    template < std::size_t Bytes >
+    std::uint64_t get( const unsigned char * p ) {
+        std::uint64_t value {0};
+        for ( std::size_t i {0}; i < Bytes; i++ )
+            value |= std::uint64_t{ p[i] } << ( 8 * i );
+        return value;
+    }
+
+    /// Appends an array of integers, little-endian, then zeros up to the alignment.
+    template < typename T >
+    void put_column( const std::vector< T > & column, std::string & out ) {
+        const std::size_t start { out.size() };
+        if constexpr ( std::endian::native == std::endian::little )
+            out.append( reinterpret_cast< const char * >( column.data() ), column.size() * sizeof( T ) );
+        else
+            for ( T v : column ) put< sizeof( T ) >( static_cast< std::uint64_t >( v ), out );
+        out.resize( start + align( out.size() - start ), '\0' );
+    }
+}
+
+/// Creates a writer.
+ColumnWriter::ColumnWriter( std::size_t block_rows ) : m_block_rows{ block_rows > 0 ? block_rows : 1 } {
+    m_values.reserve( m_block_rows );
+    m_codes.reserve( m_block_rows );
+}
+
+/// Appends the header of the file.
+void ColumnWriter::append_header( std::string & out ) {
+    const std::size_t start { out.size() };
+    out.append( columns::MAGIC, sizeof( columns::MAGIC ) );
+    put< 4 >( columns::VERSION, out );
+    put< 4 >( columns::HEADER_SIZE, out );
+    put< 4 >( sizeof( Parser::required_int_type ), out );
+    out.resize( start + columns::HEADER_SIZE, '\0' );
+}
+
+/// Appends the block of the results gathered so far, and starts a new one.
+void ColumnWriter::append_block( std::string & out ) {
+    const std::size_t rows { m_values.size() };
+    if ( rows == 0 ) return;
+    const std::size_t values_at { columns::HEADER_SIZE };
+    const std::size_t codes_at { values_at + align( rows * sizeof( Parser::required_int_type ) ) };
+    const std::size_t columns_at { codes_at + align( rows ) };
+    const std::size_t size { columns_at + align( m_columns.size() * sizeof( std::uint32_t ) ) };
+
+    const std::size_t start { out.size() };
+    out.reserve( start + size );
+    put< 8 >( size, out );
+    put< 4 >( rows, out );
+    put< 4 >( m_columns.size(), out );
+    put< 4 >( values_at, out );
+    put< 4 >( codes_at, out );
+    put< 4 >( columns_at, out );
+    out.resize( start + columns::HEADER_SIZE, '\0' );
+    put_column( m_values, out );
+    put_column( m_codes, out );
+    put_column( m_columns, out );
+
+    m_values.clear();
+    m_codes.clear();
+    m_columns.clear();
+}
+
+/// The value of the i-th result.
+Parser::required_int_type ColumnFile::Block::value( std::size_t i ) const {
+    return static_cast< Parser::required_int_type >( get< sizeof( Parser::required_int_type ) >( m_values + i * sizeof( Parser::required_int_type ) ) );
+}
+
+/// The code of the i-th result.
+Parser::ResultType::code_t ColumnFile::Block::code( std::size_t i ) const {
+    return static_cast< Parser::ResultType::code_t >( m_codes[i] );
+}
+
+/// The column of the k-th syntax error.
+std::uint32_t ColumnFile::Block::column( std::size_t k ) const {
+    return static_cast< std::uint32_t >( get< 4 >( m_columns + 4 * k ) );
+}
+
+/// Maps a file of columns and checks its header.
+ColumnFile::ColumnFile( int fd ) : m_data{ nullptr }, m_size{ 0 }, m_next{ columns::HEADER_SIZE } {
+    struct stat st;
+    if ( fstat( fd, &st ) != 0 ) fail( std::strerror( errno ) );
+    if ( not S_ISREG( st.st_mode ) ) fail( "the input must be a regular file" );
+    m_size = static_cast< std::size_t >( st.st_size );
+    if ( m_size < columns::HEADER_SIZE ) fail( "the file is too short" );
+    void * data = mmap( nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+    if ( data == MAP_FAILED ) fail( std::strerror( errno ) );
+    m_data = static_cast< const unsigned char * >( data );
+    // The blocks are read once, front to back.
+    madvise( data, m_size, MADV_SEQUENTIAL );
+
+    if ( std::memcmp( m_data, columns::MAGIC, sizeof( columns::MAGIC ) ) != 0 or get< 4 >( m_data + 8 ) != columns::VERSION
+         or get< 4 >( m_data + 16 ) != sizeof( Parser::required_int_type ) ) {
+        munmap( data, m_size );
+        fail( "not a file of result columns, or another version" );
+    }
+    m_next = get< 4 >( m_data + 12 );
+}
+
+/// Unmaps the file.
+ColumnFile::~ColumnFile() {
+    munmap( const_cast< unsigned char * >( m_data ), m_size );
+}
+
+/// Gets the next block.
+bool ColumnFile::next( Block & block ) {
+    if ( m_next >= m_size ) return false;
+    if ( m_size - m_next < columns::HEADER_SIZE ) fail( "truncated block header" );
+    const unsigned char * base { m_data + m_next };
+    const std::uint64_t size { get< 8 >( base ) };
+    const std::size_t rows = get< 4 >( base + 8 ), errors = get< 4 >( base + 12 );
+    const std::size_t values_at = get< 4 >( base + 16 ), codes_at = get< 4 >( base + 20 ), columns_at = get< 4 >( base + 24 );
+    if ( size < columns::HEADER_SIZE or size > m_size - m_next or values_at + rows * sizeof( Parser::required_int_type ) > size
+         or codes_at + rows > size or columns_at + errors * 4 > size )
+        fail( "a block does not fit in the file" );
+
+    block.m_values = base + values_at;
+    block.m_codes = base + codes_at;
+    block.m_columns = base + columns_at;
+    block.m_rows = rows;
+    block.m_errors = errors;
+    // Each syntax error must have its column.
+    std::size_t with_column {0};
+    for ( std::size_t i {0}; i < rows; i++ ) {
+        if ( block.m_codes[i] > Parser::ResultType::NESTING_TOO_DEEP ) fail( "unknown result code" );
+        with_column += BaresManager::has_column( block.code( i ) );
+    }
+    if ( with_column != errors ) fail( "the columns do not match the codes" );
+    m_next += size;
+    return true;
+}
@@ -0,0 +1,59 @@
+#include "../include/corpus.h"
+
+/// Returns true with probability `p`.
+bool CorpusGenerator::coin( double p ) {
+    return std::uniform_real_distribution< double >{ 0.0, 1.0 }( m_rng ) < p;
+}
+
+/// Appends a random operand, mostly small numbers and sometimes negative ones.
+void CorpusGenerator::operand( std::string & out ) {
+    int value = std::uniform_int_distribution< int >{ 0, coin( 0.9 ) ? 99 : 9999 }( m_rng );
+    if ( value != 0 and coin( 0.15 ) ) out += '-';
+    out += std::to_string( value );
+}
+
+/// Appends an expression with `terms` operands; `nesting` is the chance of opening a parenthesis.
+void CorpusGenerator::expression( std::string & out, std::size_t terms, std::size_t depth, double nesting ) {
+    static const char ops[] = { '+', '-', '*', '/', '%', '+', '-', '*', '^' };
+    std::size_t done {0};
+    while ( done < terms ) {
+        if ( done > 0 ) {
+            char op = ops[ std::uniform_int_distribution< int >{ 0, sizeof(ops) - 1 }( m_rng ) ];
+            if ( coin( 0.3 ) ) out += ' ';
+            out += op;
+            if ( coin( 0.3 ) ) out += ' ';
+            // Keep powers cheap: the exponent is always a small constant.
+            if ( op == '^' ) {
+                out += std::to_string( std::uniform_int_distribution< int >{ 0, 4 }( m_rng ) );
+                done++;
+                continue;
+            }
+        }
+        std::size_t left = terms - done;
+        if ( left > 1 and depth < max_depth and coin( nesting ) ) {
+            // A parenthesized sub-expression takes part of the remaining terms.
+            std::size_t inner = std::uniform_int_distribution< std::size_t >{ 1, left }( m_rng );
+            out += '(';
+            expression( out, inner, depth + 1, nesting );
+            out += ')';
+            done += inner;
+        }
+        else {
+            operand( out );
+            done++;
+        }
+    }
+}
+
+/// Returns a new random expression: 94% tiny, 5% medium and 1% huge ones.
+std::string CorpusGenerator::next( void ) {
+    std::string out;
+    double kind = std::uniform_real_distribution< double >{ 0.0, 1.0 }( m_rng );
+    if ( kind < 0.94 )
+        expression( out, std::uniform_int_distribution< std::size_t >{ 1, 6 }( m_rng ), 0, 0.2 );
+    else if ( kind < 0.99 )
+        expression( out, std::uniform_int_distribution< std::size_t >{ 20, 300 }( m_rng ), 0, 0.3 );
+    else
+        expression( out, std::uniform_int_distribution< std::size_t >{ 2000, 20000 }( m_rng ), 0, 0.6 );
+    return out;
+}
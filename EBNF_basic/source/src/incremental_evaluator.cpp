@@ -0,0 +1,379 @@
+#include <algorithm> // std::min, std::max, std::partition_point, std::copy
+#include <cstddef>   // std::ptrdiff_t
+#include <limits>    // std::numeric_limits
+#include <stdexcept> // std::out_of_range, std::length_error
+
+#include "../include/incremental_evaluator.h"
+#include "../include/arithmetic.h" // bares::apply_operator(), bares::precedence()
+
+namespace {
+    /// Digits beyond this are out of range anyway: the value stops growing.
+    constexpr Parser::input_int_type SATURATED = 1'000'000;
+
+    bool is_digit( char c ) { return c >= '0' and c <= '9'; }
+    /// The white space std::isspace() knows in the "C" locale, which the Parser skips.
+    bool is_space( char c ) { return c == ' ' or ( c >= '\t' and c <= '\r' ); }
+
+    /// Columns are kept in 32 bits.
+    void check_length( std::size_t size ) {
+        if ( size >= std::numeric_limits< std::uint32_t >::max() )
+            throw std::length_error( "IncrementalEvaluator: the expression is too long" );
+    }
+}
+
+/// Creates an evaluator of the empty expression.
+IncrementalEvaluator::IncrementalEvaluator( std::size_t max_depth )
+    : m_max_depth{ max_depth }, m_bm{ max_depth } {
+    build();
+    finish();
+}
+
+/// Starts over with a new expression.
+BaresManager::Result IncrementalEvaluator::set( std::string_view expr ) {
+    check_length( expr.size() );
+    m_text.assign( expr );
+    build();
+    return finish();
+}
+
+/// Changes the expression to a new version, editing only what differs from the current one.
+BaresManager::Result IncrementalEvaluator::update( std::string_view expr ) {
+    const std::size_t common { std::min( m_text.size(), expr.size() ) };
+    std::size_t prefix {0}, suffix {0};
+    while ( prefix < common and m_text[prefix] == expr[prefix] ) prefix++;
+    while ( suffix < common - prefix and m_text[m_text.size() - 1 - suffix] == expr[expr.size() - 1 - suffix] ) suffix++;
+    return edit( prefix, m_text.size() - prefix - suffix, expr.substr( prefix, expr.size() - prefix - suffix ) );
+}
+
+/// Replaces part of the expression.
+BaresManager::Result IncrementalEvaluator::edit( std::size_t at, std::size_t erase, std::string_view insert ) {
+    if ( at > m_text.size() ) throw std::out_of_range( "IncrementalEvaluator: the edit starts past the end of the expression" );
+    erase = std::min( erase, m_text.size() - at );
+    check_length( m_text.size() - erase + insert.size() );
+    const std::size_t stop { at + erase };
+
+    // The lexemes the edit cuts or touches, which it may join to what it inserts.
+    // A parenthesis the edit does not erase stays as it is: only one at either end can be there.
+    const std::size_t n_lex { m_lex.size() };
+    std::size_t i0 = std::partition_point( m_lex.begin(), m_lex.end(),
+                                           [&]( const Lexeme & l ) { return l.pos + l.len < at; } ) - m_lex.begin();
+    std::size_t i1 = std::partition_point( m_lex.begin() + i0, m_lex.end(),
+                                           [&]( const Lexeme & l ) { return l.pos <= stop; } ) - m_lex.begin();
+    auto is_paren = [&]( std::size_t i ) { return m_lex[i].kind == Kind::OPEN or m_lex[i].kind == Kind::CLOSE; };
+    if ( i0 < i1 and is_paren( i0 ) and m_lex[i0].pos < at ) i0++;
+    if ( i0 < i1 and is_paren( i1 - 1 ) and m_lex[i1 - 1].pos >= stop ) i1--;
+    const std::size_t from { i0 < i1 ? std::min< std::size_t >( at, m_lex[i0].pos ) : at };
+    const std::size_t to { i0 < i1 ? std::max< std::size_t >( stop, m_lex[i1 - 1].pos + m_lex[i1 - 1].len ) : stop };
+
+    // The innermost group that holds them: the last one opened before them, or a group around it.
+    std::size_t g = std::partition_point( m_groups.begin() + 1, m_groups.end(),
+                                          [&]( const Group & grp ) { return grp.open < i0; } ) - m_groups.begin() - 1;
+    while ( g != 0 and m_groups[g].close < i1 ) g = m_groups[g].parent;
+
+    // Lex the span again.
+    const std::ptrdiff_t delta { static_cast< std::ptrdiff_t >( insert.size() ) - static_cast< std::ptrdiff_t >( erase ) };
+    m_text.replace( at, erase, insert );
+    m_fresh.clear();
+    lex( from, to + delta, m_fresh );
+
+    // Parentheses that come or go change the tree, but only inside the lowest group that keeps
+    // its own ")" (or keeps having none) and whose "(" none of them closes.
+    std::ptrdiff_t was {0}, now {0}, lowest {0};
+    bool reshaped {false};
+    for ( std::size_t i { i0 }; i < i1; i++ ) {
+        reshaped = reshaped or is_paren( i );
+        was += ( m_lex[i].kind == Kind::OPEN ) - ( m_lex[i].kind == Kind::CLOSE );
+    }
+    for ( const Lexeme & l : m_fresh ) {
+        reshaped = reshaped or l.kind == Kind::OPEN or l.kind == Kind::CLOSE;
+        now += ( l.kind == Kind::OPEN ) - ( l.kind == Kind::CLOSE );
+        lowest = std::min( lowest, now );
+    }
+    std::size_t top { g }, n_inside {0};
+    if ( reshaped ) {
+        for ( ; top != 0; top = m_groups[top].parent ) {
+            const std::ptrdiff_t above { static_cast< std::ptrdiff_t >( m_groups[g].depth - m_groups[top].depth ) };
+            const bool closed { m_groups[top].close < n_lex };
+            if ( above + lowest >= 0 and ( closed ? now == was : now >= was or i1 == n_lex ) ) break;
+        }
+        n_inside = std::partition_point( m_groups.begin() + top + 1, m_groups.end(),
+                                         [&]( const Group & grp ) { return grp.open < m_groups[top].close; } )
+                   - m_groups.begin() - top - 1;
+    }
+
+    // Put the new lexemes in place of the old ones; everything after them moves.
+    const std::size_t n_old { i1 - i0 }, n_new { m_fresh.size() };
+    if ( n_new > n_old )
+        m_lex.insert( m_lex.begin() + i1, n_new - n_old, Lexeme{} );
+    else
+        m_lex.erase( m_lex.begin() + i0 + n_new, m_lex.begin() + i1 );
+    std::copy( m_fresh.begin(), m_fresh.end(), m_lex.begin() + i0 );
+    if ( delta != 0 )
+        for ( std::size_t i { i0 + n_new }; i < m_lex.size(); i++ ) m_lex[i].pos = static_cast< std::uint32_t >( m_lex[i].pos + delta );
+    if ( n_new != n_old )
+        for ( std::size_t k {1}; k < m_groups.size(); k++ ) {
+            if ( m_groups[k].open >= i1 ) m_groups[k].open = m_groups[k].open + n_new - n_old;
+            if ( m_groups[k].close >= i1 ) m_groups[k].close = m_groups[k].close + n_new - n_old;
+        }
+    m_groups[0].close = m_lex.size();
+    m_reparsed = 0;
+    if ( reshaped ) rebuild( top, n_inside, i0, i0 + n_new );
+
+    // Parse that group again, then the groups around it while what they come to changes.
+    // Once it does not, the groups above only see their columns after the edit move.
+    auto moved = [&]( std::size_t col, std::size_t & to_col ) {
+        if ( col >= at and col < stop ) return false;
+        to_col = col < at ? col : col + delta;
+        return true;
+    };
+    bool changed { true };
+    for ( std::size_t c { top };; c = m_groups[c].parent ) {
+        Outcome & out = m_groups[c].out;
+        const std::size_t base { origin( c ) };
+        const bool error { out.status.type != Parser::ResultType::OK };
+        std::size_t col {0};
+        if ( not changed and ( not error or moved( base + out.status.at_col, col ) ) ) {
+            if ( error ) out.status.at_col = static_cast< Parser::ResultType::size_type >( col - base );
+        }
+        else {
+            const Outcome fresh { parse( c ) };
+            m_reparsed++;
+            changed = fresh.status.type != out.status.type or fresh.value != out.value or fresh.div != out.div
+                      or ( error and ( not moved( base + out.status.at_col, col )
+                                       or col != base + static_cast< std::size_t >( fresh.status.at_col ) ) );
+            out = fresh;
+        }
+        if ( c == 0 ) break;
+    }
+    return finish();
+}
+
+/// The lexemes of a span of the text.
+void IncrementalEvaluator::lex( std::size_t from, std::size_t to, std::vector< Lexeme > & out ) const {
+    for ( std::size_t i { from }; i < to; ) {
+        const char c { m_text[i] };
+        if ( is_space( c ) ) {
+            i++;
+            continue;
+        }
+        std::size_t len {1};
+        Kind kind { Kind::OTHER };
+        if ( is_digit( c ) ) {
+            kind = Kind::DIGITS;
+            while ( i + len < to and is_digit( m_text[i + len] ) ) len++;
+        }
+        else if ( c == '(' ) kind = Kind::OPEN;
+        else if ( c == ')' ) kind = Kind::CLOSE;
+        else if ( bares::precedence( c ) > 0 ) kind = Kind::OPERATOR;
+        out.push_back( Lexeme{ static_cast< std::uint32_t >( i ), static_cast< std::uint32_t >( len ), 0, kind } );
+        i += len;
+    }
+}
+
+/// Builds the tree and the outcome of each group.
+void IncrementalEvaluator::build( void ) {
+    m_lex.clear();
+    lex( 0, m_text.size(), m_lex );
+    m_groups.assign( 1, Group{ 0, m_lex.size(), 0, 0, Outcome{ Parser::ResultType{}, 0, false } } );
+    m_reparsed = 0;
+    rebuild( 0, 0, 0, m_lex.size() );
+    m_groups[0].out = parse( 0 );
+    m_reparsed++;
+}
+
+/// Builds again the groups inside a group, in place of the `n_old` it had, and their outcomes.
+/*!
+ * The lexemes [from, to) are new. A group whose parentheses are both on the
+ * same side of them keeps its ")" and its contents: it is moved, with the
+ * groups inside it, and is only parsed again if its depth changed and some
+ * group in it may be too deep now, or was before.
+ */
+void IncrementalEvaluator::rebuild( std::size_t top, std::size_t n_old, std::size_t from, std::size_t to ) {
+    // A ")" closes the last "(" still open; one that finds none stays a symbol of the expression.
+    m_inside.clear();
+    m_stale.clear();
+    m_open.assign( 1, top );
+    const std::size_t end { m_groups[top].close };
+    for ( std::size_t i { top == 0 ? 0 : m_groups[top].open + 1 }; i < end; i++ ) {
+        if ( m_lex[i].kind == Kind::OPEN ) {
+            const std::size_t id { top + 1 + m_inside.size() };
+            const std::size_t depth { m_groups[top].depth + m_open.size() };
+            const std::size_t old { m_lex[i].group };
+            if ( ( i < from and m_groups[old].close < from ) or i >= to ) {
+                // The groups inside it come right after it.
+                const std::size_t close { m_groups[old].close };
+                const std::size_t n = std::partition_point( m_groups.begin() + old + 1, m_groups.end(),
+                                                            [&]( const Group & grp ) { return grp.open < close; } )
+                                      - m_groups.begin() - old;
+                std::size_t deepest {0};
+                for ( std::size_t k {0}; k < n; k++ ) {
+                    Group grp { m_groups[old + k] };
+                    deepest = std::max( deepest, std::max( grp.depth, grp.depth + depth - m_groups[old].depth ) );
+                    grp.parent = k == 0 ? m_open.back() : grp.parent - old + id;
+                    grp.depth = grp.depth + depth - m_groups[old].depth;
+                    m_lex[grp.open].group = static_cast< std::uint32_t >( id + k );
+                    m_inside.push_back( grp );
+                }
+                if ( depth != m_groups[old].depth and deepest > m_max_depth )
+                    for ( std::size_t k {0}; k < n; k++ ) m_stale.push_back( id + k );
+                i = close;
+                continue;
+            }
+            m_lex[i].group = static_cast< std::uint32_t >( id );
+            m_inside.push_back( Group{ i, end, m_open.back(), depth, Outcome{ Parser::ResultType{}, 0, false } } );
+            m_stale.push_back( id );
+            m_open.push_back( id );
+        }
+        else if ( m_lex[i].kind == Kind::CLOSE and m_open.size() > 1 ) {
+            m_inside[m_open.back() - top - 1].close = i;
+            m_open.pop_back();
+        }
+    }
+
+    // The groups after them get new numbers.
+    const std::size_t n_new { m_inside.size() };
+    if ( n_new > n_old )
+        m_groups.insert( m_groups.begin() + top + 1 + n_old, n_new - n_old, Group{ 0, 0, 0, 0, Outcome{ Parser::ResultType{}, 0, false } } );
+    else
+        m_groups.erase( m_groups.begin() + top + 1 + n_new, m_groups.begin() + top + 1 + n_old );
+    std::copy( m_inside.begin(), m_inside.end(), m_groups.begin() + top + 1 );
+    if ( n_new != n_old ) {
+        for ( std::size_t k { top + 1 + n_new }; k < m_groups.size(); k++ )
+            if ( m_groups[k].parent > top + n_old ) m_groups[k].parent = m_groups[k].parent + n_new - n_old;
+        for ( std::size_t i { end }; i < m_lex.size(); i++ )
+            if ( m_lex[i].kind == Kind::OPEN ) m_lex[i].group = static_cast< std::uint32_t >( m_lex[i].group + n_new - n_old );
+    }
+
+    // A group comes after the one it is in.
+    for ( std::size_t k { m_stale.size() }; k-- > 0; )
+        m_groups[m_stale[k]].out = parse( m_stale[k] );
+    m_reparsed += m_stale.size();
+}
+
+/// The column the outcome of a group is counted from: its "(", or the start of the expression.
+std::size_t IncrementalEvaluator::origin( std::size_t g ) const {
+    return g == 0 ? 0 : m_lex[m_groups[g].open].pos;
+}
+
+/// What a group comes to, from its terms and the outcomes of its children.
+/*!
+ * This follows Parser::expression() on a single level. An error inside
+ * parentheses ends as an ill formed term at the start of the term (or of the
+ * ")") where it happened, except a missing ")" of the group itself and a
+ * nesting too deep, which the group above still tells apart; at the top, after
+ * an operator, an ill formed term is a missing term. The values are computed as infix_to_postfix() and calculate() would,
+ * every operator being left associative.
+ */
+IncrementalEvaluator::Outcome IncrementalEvaluator::parse( std::size_t g ) const {
+    using code_t = Parser::ResultType::code_t;
+    const Group & grp = m_groups[g];
+    const bool root { g == 0 };
+    const std::size_t base { origin( g ) };
+    const std::size_t end { grp.close };
+    auto at = [&]( std::size_t i ) -> std::size_t { return i < m_lex.size() ? m_lex[i].pos : m_text.size(); };
+    auto outcome = [&]( code_t code, std::size_t col ) {
+        return Outcome{ Parser::ResultType{ code, static_cast< Parser::ResultType::size_type >( col - base ) }, 0, false };
+    };
+    if ( root and m_lex.empty() ) return outcome( Parser::ResultType::UNEXPECTED_END_OF_EXPRESSION, m_text.size() );
+
+    bool after_op { false };
+    auto fail = [&]( code_t code, std::size_t col ) {
+        if ( code != Parser::ResultType::NESTING_TOO_DEEP ) {
+            if ( not root ) code = Parser::ResultType::ILL_FORMED_INTEGER;
+            else if ( after_op and code == Parser::ResultType::ILL_FORMED_INTEGER ) code = Parser::ResultType::MISSING_TERM;
+        }
+        return outcome( code, col );
+    };
+    // The value of a run of digits, as far as the range check needs it.
+    auto magnitude = [&]( const Lexeme & l ) {
+        Parser::input_int_type value {0};
+        for ( std::size_t k {0}; k < l.len and value < SATURATED; k++ ) value = value * 10 + ( m_text[l.pos + k] - '0' );
+        return value;
+    };
+
+    // The pending operators have increasing precedences: there are never more than three.
+    Parser::input_int_type values[4];
+    char ops[3];
+    std::size_t n_values {0}, n_ops {0};
+    bool div {false};
+    auto reduce = [&]() {
+        const char op { ops[--n_ops] };
+        const Parser::input_int_type rhs { values[--n_values] };
+        if ( not bares::apply_operator( op, values[n_values - 1], rhs, values[n_values - 1] ) ) div = true;
+    };
+
+    std::size_t i { root ? 0 : grp.open + 1 };
+    for ( ;; ) {
+        // [1] A term: an integer, or a group, maybe after a "-" that is then ignored.
+        const std::size_t begin { at( i ) };
+        Parser::input_int_type value;
+        bool zero_tail { false }; // A "0" followed by more digits: the term is only the "0".
+        if ( i < end and m_lex[i].kind == Kind::DIGITS ) {
+            if ( m_text[begin] == '0' ) {
+                value = 0;
+                zero_tail = m_lex[i].len > 1;
+            }
+            else if ( ( value = magnitude( m_lex[i] ) ) > std::numeric_limits< Parser::required_int_type >::max() )
+                return fail( Parser::ResultType::INTEGER_OUT_OF_RANGE, begin );
+            i++;
+        }
+        else if ( i + 1 < end and m_text[begin] == '-' and m_lex[i].kind == Kind::OPERATOR
+                  and m_lex[i + 1].kind == Kind::DIGITS and m_lex[i + 1].pos == begin + 1 and m_text[begin + 1] != '0' ) {
+            if ( ( value = -magnitude( m_lex[i + 1] ) ) < std::numeric_limits< Parser::required_int_type >::min() )
+                return fail( Parser::ResultType::INTEGER_OUT_OF_RANGE, begin );
+            i += 2;
+        }
+        else {
+            const bool minus { i < end and m_text[begin] == '-' };
+            const std::size_t j { minus ? i + 1 : i };
+            if ( j >= end or m_lex[j].kind != Kind::OPEN or ( minus and m_lex[j].pos != begin + 1 ) )
+                return fail( Parser::ResultType::ILL_FORMED_INTEGER, minus and root ? begin + 1 : begin );
+            const std::size_t child { m_lex[j].group };
+            if ( grp.depth >= m_max_depth ) return fail( Parser::ResultType::NESTING_TOO_DEEP, m_lex[j].pos );
+            const Outcome & in = m_groups[child].out;
+            if ( in.status.type != Parser::ResultType::OK )
+                return fail( in.status.type, origin( child ) + static_cast< std::size_t >( in.status.at_col ) );
+            value = in.value;
+            div = div or in.div;
+            i = m_groups[child].close + 1;
+        }
+        values[n_values++] = value;
+
+        // [2] After the term: an operator, or the end of the group.
+        if ( zero_tail )
+            return outcome( root ? Parser::ResultType::EXTRANEOUS_SYMBOL : Parser::ResultType::MISSING_CLOSING, m_lex[i - 1].pos + 1 );
+        if ( i < end and m_lex[i].kind == Kind::OPERATOR ) {
+            const char op { m_text[m_lex[i].pos] };
+            while ( n_ops > 0 and bares::precedence( op ) <= bares::precedence( ops[n_ops - 1] ) ) reduce();
+            ops[n_ops++] = op;
+            after_op = true;
+            i++;
+            continue;
+        }
+        if ( root ) {
+            if ( i < m_lex.size() ) return outcome( Parser::ResultType::EXTRANEOUS_SYMBOL, m_lex[i].pos );
+            break;
+        }
+        // Inside parentheses only the ")" may come; without one the expression ends first.
+        if ( i != end or end == m_lex.size() ) return outcome( Parser::ResultType::MISSING_CLOSING, at( i ) );
+        break;
+    }
+    while ( n_ops > 0 ) reduce();
+    return Outcome{ Parser::ResultType{ Parser::ResultType::OK }, values[0], div };
+}
+
+/// Makes the result from the outcome of group 0.
+BaresManager::Result IncrementalEvaluator::finish( void ) {
+    const Outcome & out = m_groups[0].out;
+    if ( out.status.type != Parser::ResultType::OK )
+        m_result = BaresManager::Result{ out.status, 0 };
+    // Which result stands for a quotient by zero depends on the order of every operation: ask the reference.
+    else if ( out.div )
+        m_result = m_bm.evaluate( m_text );
+    else if ( out.value < std::numeric_limits< Parser::required_int_type >::min()
+              or out.value > std::numeric_limits< Parser::required_int_type >::max() )
+        m_result = BaresManager::Result{ Parser::ResultType{ Parser::ResultType::OVERFLOW_ERROR }, 0 };
+    else
+        m_result = BaresManager::Result{ out.status, static_cast< Parser::required_int_type >( out.value ) };
+    return m_result;
+}
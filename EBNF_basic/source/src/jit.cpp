@@ -0,0 +1,423 @@
+#include <algorithm> // std::max
+#include <cstdint> // std::uint8_t, std::int32_t
+#include <cstring> // std::memcpy
+#include <limits>  // std::numeric_limits
+#include <vector>  // std::vector
+
+#if defined(__x86_64__) && defined(__unix__)
+#define BARES_HAVE_JIT 1
+#include <sys/mman.h> // mmap(), mprotect(), munmap(), memfd_create()
+#include <unistd.h>   // ftruncate(), close(), sysconf()
+#endif
+
+#include "../include/jit.h"
+
+#ifdef BARES_HAVE_JIT
+namespace {
+    /// x86-64 register numbers.
+    enum reg_t : std::uint8_t { RAX = 0, RCX = 1, RDX = 2, RSP = 4, RSI = 6, RDI = 7, R8 = 8, R9 = 9, R10 = 10, R11 = 11 };
+
+    /// Condition codes of the conditional jumps.
+    enum cond_t : std::uint8_t { CC_E = 0x4, CC_NE = 0x5, CC_S = 0x8, CC_L = 0xC, CC_G = 0xF };
+
+    /// The registers that hold the values on the bottom of the stack machine (all caller saved).
+    constexpr reg_t SLOT_REGS[] = { RSI, R8, R9, R10, R11 };
+    constexpr std::size_t N_SLOT_REGS { sizeof( SLOT_REGS ) / sizeof( SLOT_REGS[0] ) };
+
+    /// Writes machine code into a byte buffer.
+    /*!
+     * Only the handful of instructions the expressions need, all on 64-bit
+     * registers. Jumps always take a 32-bit displacement, patched by bind().
+     */
+    class Assembler {
+        public:
+            /// The bytes generated so far.
+            const std::vector< std::uint8_t > & bytes( void ) const { return m_code; }
+            /// Position of the next byte.
+            std::size_t here( void ) const { return m_code.size(); }
+
+            //=== Moves.
+            void mov( reg_t dst, reg_t src ) { if ( dst != src ) rr( 0x89, src, dst ); }
+            void mov( reg_t dst, std::int32_t imm ) { rex( 0, dst ); byte( 0xC7 ); modrm( 3, 0, dst ); imm32( imm ); }
+            void load( reg_t dst, std::int32_t disp ) { rex( dst, RSP ); byte( 0x8B ); rsp_disp( dst, disp ); }
+            void store( std::int32_t disp, reg_t src ) { rex( src, RSP ); byte( 0x89 ); rsp_disp( src, disp ); }
+            void store( std::int32_t disp, std::int32_t imm ) { rex( 0, RSP ); byte( 0xC7 ); rsp_disp( 0, disp ); imm32( imm ); }
+            void store_rdi( reg_t src ) { rex( src, RDI ); byte( 0x89 ); modrm( 0, src, RDI ); }
+            void movabs( reg_t dst, std::int64_t imm ) { rex( 0, dst ); byte( static_cast< std::uint8_t >( 0xB8 | ( dst & 7 ) ) ); imm32( static_cast< std::int32_t >( imm ) ); imm32( static_cast< std::int32_t >( imm >> 32 ) ); }
+            void mov_eax( std::int32_t imm ) { byte( 0xB8 ); imm32( imm ); }
+            void zero_eax( void ) { byte( 0x31 ); byte( 0xC0 ); }
+
+            //=== Arithmetic.
+            void add( reg_t dst, reg_t src ) { rr( 0x01, src, dst ); }
+            void add( reg_t dst, std::int32_t imm ) { rex( 0, dst ); byte( 0x81 ); modrm( 3, 0, dst ); imm32( imm ); }
+            void sub( reg_t dst, reg_t src ) { rr( 0x29, src, dst ); }
+            void sub( reg_t dst, std::int32_t imm ) { rex( 0, dst ); byte( 0x81 ); modrm( 3, 5, dst ); imm32( imm ); }
+            void imul( reg_t dst, reg_t src ) { rex( dst, src ); byte( 0x0F ); byte( 0xAF ); modrm( 3, dst, src ); }
+            void imul( reg_t dst, reg_t src, std::int32_t imm ) { rex( dst, src ); byte( 0x69 ); modrm( 3, dst, src ); imm32( imm ); }
+            /// rdx:rax = rax * r, signed.
+            void imul_wide( reg_t r ) { rex( 0, r ); byte( 0xF7 ); modrm( 3, 5, r ); }
+            void neg( reg_t r ) { rex( 0, r ); byte( 0xF7 ); modrm( 3, 3, r ); }
+            void shr1( reg_t r ) { rex( 0, r ); byte( 0xD1 ); modrm( 3, 5, r ); }
+            void shr( reg_t r, std::uint8_t n ) { rex( 0, r ); byte( 0xC1 ); modrm( 3, 5, r ); byte( n ); }
+            void sar( reg_t r, std::uint8_t n ) { rex( 0, r ); byte( 0xC1 ); modrm( 3, 7, r ); byte( n ); }
+            void cqo( void ) { byte( 0x48 ); byte( 0x99 ); }
+            void idiv( reg_t r ) { rex( 0, r ); byte( 0xF7 ); modrm( 3, 7, r ); }
+            void test( reg_t a, reg_t b ) { rr( 0x85, b, a ); }
+            void test( reg_t r, std::int32_t imm ) { rex( 0, r ); byte( 0xF7 ); modrm( 3, 0, r ); imm32( imm ); }
+            void cmp( reg_t r, std::int32_t imm ) { rex( 0, r ); byte( 0x81 ); modrm( 3, 7, r ); imm32( imm ); }
+            void sub_rsp( std::int32_t imm ) { byte( 0x48 ); byte( 0x81 ); byte( 0xEC ); imm32( imm ); }
+            void add_rsp( std::int32_t imm ) { byte( 0x48 ); byte( 0x81 ); byte( 0xC4 ); imm32( imm ); }
+            void ret( void ) { byte( 0xC3 ); }
+
+            //=== Jumps: return where the displacement is, to bind() it later.
+            std::size_t jcc( cond_t cc ) { byte( 0x0F ); byte( 0x80 | cc ); return displacement(); }
+            std::size_t jmp( void ) { byte( 0xE9 ); return displacement(); }
+            /// Makes the jump whose displacement is at `at` land on the current position.
+            void bind( std::size_t at ) { bind( at, here() ); }
+            /// Makes the jump whose displacement is at `at` land on `target`.
+            void bind( std::size_t at, std::size_t target ) {
+                auto rel = static_cast< std::int32_t >( target - ( at + 4 ) );
+                std::memcpy( &m_code[at], &rel, 4 );
+            }
+
+        private:
+            std::vector< std::uint8_t > m_code; //!< The machine code.
+
+            void byte( std::uint8_t b ) { m_code.push_back( b ); }
+            void imm32( std::int32_t v ) {
+                std::uint8_t b[4];
+                std::memcpy( b, &v, 4 );
+                for ( auto x : b ) byte( x );
+            }
+            std::size_t displacement( void ) { std::size_t at = here(); imm32( 0 ); return at; }
+            /// REX prefix with W set, extending the reg and the r/m fields.
+            void rex( std::uint8_t reg, std::uint8_t rm ) { byte( 0x48 | ( ( reg >> 3 ) << 2 ) | ( rm >> 3 ) ); }
+            void modrm( std::uint8_t mod, std::uint8_t reg, std::uint8_t rm ) {
+                byte( static_cast< std::uint8_t >( ( mod << 6 ) | ( ( reg & 7 ) << 3 ) | ( rm & 7 ) ) );
+            }
+            /// An instruction "op r/m64, r64" between two registers.
+            void rr( std::uint8_t op, reg_t reg, reg_t rm ) { rex( reg, rm ); byte( op ); modrm( 3, reg, rm ); }
+            /// The [rsp + disp32] operand.
+            void rsp_disp( std::uint8_t reg, std::int32_t disp ) { modrm( 2, reg, RSP ); byte( 0x24 ); imm32( disp ); }
+    };
+
+    /// Translates the instructions of a program into machine code.
+    class Translator {
+        public:
+            explicit Translator( const Program & program )
+                : m_spills { program.max_depth() > N_SLOT_REGS ? program.max_depth() - N_SLOT_REGS : 0 },
+                  m_frame { static_cast< std::int32_t >( 8 * m_spills ) } {
+                translate( program );
+            }
+            const std::vector< std::uint8_t > & bytes( void ) const { return m_as.bytes(); }
+
+        private:
+            Assembler m_as;
+            std::size_t m_spills;             //!< Slots that live in the native stack frame.
+            std::int32_t m_frame;             //!< Size of the native stack frame.
+            sc::vector< std::size_t > m_bail; //!< Jumps to the exit that hands over to the interpreter.
+
+            static bool in_reg( std::size_t slot ) { return slot < N_SLOT_REGS; }
+            static std::int32_t disp( std::size_t slot ) { return static_cast< std::int32_t >( 8 * ( slot - N_SLOT_REGS ) ); }
+
+            /// Copies a slot into a register.
+            void load( reg_t r, std::size_t slot ) {
+                if ( in_reg( slot ) ) m_as.mov( r, SLOT_REGS[slot] );
+                else m_as.load( r, disp( slot ) );
+            }
+            /// Copies a register into a slot.
+            void store( std::size_t slot, reg_t r ) {
+                if ( in_reg( slot ) ) m_as.mov( SLOT_REGS[slot], r );
+                else m_as.store( disp( slot ), r );
+            }
+            /// Returns from the function with a status in eax.
+            void leave( std::int32_t status ) {
+                if ( status == 0 ) m_as.zero_eax();
+                else m_as.mov_eax( status );
+                if ( m_frame > 0 ) m_as.add_rsp( m_frame );
+                m_as.ret();
+            }
+
+            void translate( const Program & program ) {
+                if ( m_frame > 0 ) m_as.sub_rsp( m_frame );
+                std::size_t depth {0};
+                const auto & code = program.code();
+                for ( std::size_t i {0}; i < code.size(); i++ ) {
+                    const Instr & in = code[i];
+                    if ( in.op == Instr::op_t::PUSH ) {
+                        if ( in_reg( depth ) ) m_as.mov( SLOT_REGS[depth], in.arg );
+                        else m_as.store( disp( depth ), in.arg );
+                        depth++;
+                        continue;
+                    }
+                    if ( in.in_place() ) {
+                        with_constant( in, program, depth - 1 );
+                        continue;
+                    }
+                    depth--;
+                    binary( in.op, depth - 1, depth );
+                }
+
+                // The final value must fit the required type.
+                load( RAX, 0 );
+                m_as.cmp( RAX, std::numeric_limits< Parser::required_int_type >::min() );
+                std::size_t low = m_as.jcc( CC_L );
+                m_as.cmp( RAX, std::numeric_limits< Parser::required_int_type >::max() );
+                std::size_t high = m_as.jcc( CC_G );
+                m_as.store_rdi( RAX );
+                leave( 0 );
+                m_as.bind( low );
+                m_as.bind( high );
+                leave( 1 );
+                for ( std::size_t k {0}; k < m_bail.size(); k++ )
+                    m_as.bind( m_bail[k] );
+                leave( 2 );
+            }
+
+            /// Applies a superinstruction to a slot.
+            void with_constant( const Instr & in, const Program & program, std::size_t slot ) {
+                switch ( in.op ) {
+                    case Instr::op_t::ADD_CONST:
+                    case Instr::op_t::SUB_CONST:
+                    case Instr::op_t::MUL_CONST: {
+                        reg_t r = in_reg( slot ) ? SLOT_REGS[slot] : RAX;
+                        if ( r == RAX ) load( RAX, slot );
+                        if ( in.op == Instr::op_t::ADD_CONST ) m_as.add( r, in.arg );
+                        else if ( in.op == Instr::op_t::SUB_CONST ) m_as.sub( r, in.arg );
+                        else m_as.imul( r, r, in.arg );
+                        if ( r == RAX ) store( slot, RAX );
+                        break;
+                    }
+                    case Instr::op_t::POW_CONST:
+                        power( in.arg, slot );
+                        break;
+                    case Instr::op_t::DIV_CONST:
+                    case Instr::op_t::MOD_CONST:
+                        by_constant( in, program.divisor( in ), slot );
+                        break;
+                    default:
+                        break;
+                }
+            }
+
+            /// Raises a slot to a known power, squaring and multiplying without a loop.
+            void power( std::int32_t exponent, std::size_t slot ) {
+                if ( exponent <= 0 )
+                    m_as.mov_eax( exponent == 0 ? 1 : 0 );
+                else {
+                    load( RDX, slot );
+                    bool started { false }; // Whether rax already holds a partial product.
+                    for ( auto e = static_cast< std::uint32_t >( exponent ); e != 0; e >>= 1 ) {
+                        if ( e & 1 ) {
+                            if ( started ) m_as.imul( RAX, RDX );
+                            else m_as.mov( RAX, RDX );
+                            started = true;
+                        }
+                        if ( e > 1 ) m_as.imul( RDX, RDX );
+                    }
+                }
+                store( slot, RAX );
+            }
+
+            /// Divides a slot by a constant with its magic number, as bares::divide_magic() does.
+            void by_constant( const Instr & in, const bares::magic_divisor & magic, std::size_t slot ) {
+                load( RCX, slot );
+                m_as.movabs( RAX, magic.multiplier );
+                m_as.imul_wide( RCX );
+                if ( in.arg > 0 and magic.multiplier < 0 ) m_as.add( RDX, RCX );
+                else if ( in.arg < 0 and magic.multiplier > 0 ) m_as.sub( RDX, RCX );
+                if ( magic.shift > 0 ) m_as.sar( RDX, static_cast< std::uint8_t >( magic.shift ) );
+                // Rounds toward zero: adds 1 to a negative quotient.
+                m_as.mov( RAX, RDX );
+                m_as.shr( RAX, 63 );
+                m_as.add( RDX, RAX );
+                if ( in.op == Instr::op_t::DIV_CONST )
+                    m_as.mov( RAX, RDX );
+                else {
+                    m_as.imul( RDX, RDX, in.arg );
+                    m_as.mov( RAX, RCX );
+                    m_as.sub( RAX, RDX );
+                }
+                store( slot, RAX );
+            }
+
+            /// Applies an operator to two slots, leaving the result in the first one.
+            void binary( Instr::op_t op, std::size_t lhs, std::size_t rhs ) {
+                // Additions, subtractions and products stay in the slot registers when possible.
+                if ( ( op == Instr::op_t::ADD or op == Instr::op_t::SUB or op == Instr::op_t::MUL ) and
+                     in_reg( lhs ) and in_reg( rhs ) ) {
+                    reg_t a = SLOT_REGS[lhs], b = SLOT_REGS[rhs];
+                    if ( op == Instr::op_t::ADD ) m_as.add( a, b );
+                    else if ( op == Instr::op_t::SUB ) m_as.sub( a, b );
+                    else m_as.imul( a, b );
+                    return;
+                }
+                switch ( op ) {
+                    case Instr::op_t::ADD:
+                    case Instr::op_t::SUB:
+                    case Instr::op_t::MUL:
+                        load( RAX, lhs );
+                        load( RCX, rhs );
+                        if ( op == Instr::op_t::ADD ) m_as.add( RAX, RCX );
+                        else if ( op == Instr::op_t::SUB ) m_as.sub( RAX, RCX );
+                        else m_as.imul( RAX, RCX );
+                        break;
+                    case Instr::op_t::DIV:
+                    case Instr::op_t::MOD: {
+                        load( RAX, lhs );
+                        load( RCX, rhs );
+                        // A zero divisor has its own rules: leave it to the interpreter.
+                        m_as.test( RCX, RCX );
+                        m_bail.push_back( m_as.jcc( CC_E ) );
+                        // idiv traps on the smallest value divided by -1, which wraps instead.
+                        m_as.cmp( RCX, -1 );
+                        std::size_t divide = m_as.jcc( CC_NE );
+                        if ( op == Instr::op_t::DIV ) m_as.neg( RAX );
+                        else m_as.zero_eax();
+                        std::size_t done = m_as.jmp();
+                        m_as.bind( divide );
+                        m_as.cqo();
+                        m_as.idiv( RCX );
+                        if ( op == Instr::op_t::MOD ) m_as.mov( RAX, RDX );
+                        m_as.bind( done );
+                        break;
+                    }
+                    case Instr::op_t::POW: {
+                        // Exponentiation by squaring: rax = rdx ^ rcx.
+                        load( RDX, lhs );
+                        load( RCX, rhs );
+                        m_as.mov_eax( 1 );
+                        m_as.test( RCX, RCX );
+                        std::size_t done = m_as.jcc( CC_E );
+                        std::size_t negative = m_as.jcc( CC_S );
+                        std::size_t loop = m_as.here();
+                        m_as.test( RCX, 1 );
+                        std::size_t even = m_as.jcc( CC_E );
+                        m_as.imul( RAX, RDX );
+                        m_as.bind( even );
+                        m_as.imul( RDX, RDX );
+                        m_as.shr1( RCX );
+                        m_as.bind( m_as.jcc( CC_NE ), loop );
+                        std::size_t end = m_as.jmp();
+                        m_as.bind( negative );
+                        m_as.zero_eax();
+                        m_as.bind( done );
+                        m_as.bind( end );
+                        break;
+                    }
+                    default: // PUSH and the superinstructions do not get here.
+                        break;
+                }
+                store( lhs, RAX );
+            }
+    };
+}
+#endif
+
+//=== CodeArena
+
+/// Releases all the memory.
+CodeArena::~CodeArena() {
+#ifdef BARES_HAVE_JIT
+    for ( const auto & chunk : m_chunks ) {
+        munmap( chunk.writable, chunk.size );
+        munmap( chunk.executable, chunk.size );
+    }
+#endif
+}
+
+/// Copies machine code into the arena.
+const void * CodeArena::install( const std::uint8_t * code, std::size_t size ) {
+#if defined(BARES_HAVE_JIT) && defined(MFD_CLOEXEC)
+    std::lock_guard< std::mutex > guard { m_lock };
+    // Functions start on 16 bytes boundaries, as compilers align them.
+    std::size_t at = ( m_used + 15 ) & ~std::size_t{ 15 };
+    if ( m_chunks.empty() or at + size > m_chunks.back().size ) {
+        const auto page = static_cast< std::size_t >( sysconf( _SC_PAGESIZE ) );
+        std::size_t chunk_size = ( std::max( m_chunk_size, size ) + page - 1 ) / page * page;
+        int fd = memfd_create( "bares-jit", MFD_CLOEXEC );
+        if ( fd < 0 ) return nullptr;
+        void * writable { MAP_FAILED }, * executable { MAP_FAILED };
+        if ( ftruncate( fd, static_cast< off_t >( chunk_size ) ) == 0 ) {
+            writable = mmap( nullptr, chunk_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+            executable = mmap( nullptr, chunk_size, PROT_READ | PROT_EXEC, MAP_SHARED, fd, 0 );
+        }
+        close( fd );
+        if ( writable == MAP_FAILED or executable == MAP_FAILED ) {
+            if ( writable != MAP_FAILED ) munmap( writable, chunk_size );
+            if ( executable != MAP_FAILED ) munmap( executable, chunk_size );
+            return nullptr;
+        }
+        m_chunks.push_back( Chunk{ writable, executable, chunk_size } );
+        at = 0;
+    }
+    Chunk & chunk = m_chunks.back();
+    std::memcpy( static_cast< char * >( chunk.writable ) + at, code, size );
+    m_used = at + size;
+    return static_cast< const char * >( chunk.executable ) + at;
+#else
+    (void) code;
+    (void) size;
+    return nullptr;
+#endif
+}
+
+//=== JitProgram
+
+/// Translates a program into native code.
+JitProgram::JitProgram( const Program & program, CodeArena * arena )
+    : m_program { program },
+      m_memory { nullptr },
+      m_size { 0 },
+      m_entry { nullptr } {
+#ifdef BARES_HAVE_JIT
+    Translator translator { m_program };
+    const auto & bytes = translator.bytes();
+    if ( arena != nullptr ) {
+        if ( const void * code = arena->install( bytes.data(), bytes.size() ) ) {
+            m_entry = reinterpret_cast< entry_type >( const_cast< void * >( code ) );
+            return;
+        }
+    }
+    m_size = bytes.size();
+    void * memory = mmap( nullptr, m_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+    if ( memory == MAP_FAILED ) return; // Everything goes to the interpreter.
+    std::memcpy( memory, bytes.data(), m_size );
+    if ( mprotect( memory, m_size, PROT_READ | PROT_EXEC ) != 0 ) {
+        munmap( memory, m_size );
+        return;
+    }
+    m_memory = memory;
+    m_entry = reinterpret_cast< entry_type >( memory );
+#endif
+}
+
+/// Releases the native code.
+JitProgram::~JitProgram() {
+#ifdef BARES_HAVE_JIT
+    if ( m_memory != nullptr ) munmap( m_memory, m_size );
+#endif
+}
+
+/// Tells whether this build and this system can generate native code at all.
+bool JitProgram::supported( void ) {
+#ifdef BARES_HAVE_JIT
+    return true;
+#else
+    return false;
+#endif
+}
+
+/// Runs the program, giving the same result as Program::run().
+BaresManager::Result JitProgram::run( void ) const {
+    if ( m_entry != nullptr ) {
+        Parser::input_int_type value;
+        switch ( m_entry( &value ) ) {
+            case 0: return BaresManager::Result{ Parser::ResultType{ Parser::ResultType::OK },
+                                                 static_cast< Parser::required_int_type >( value ) };
+            case 1: return BaresManager::Result{ Parser::ResultType{ Parser::ResultType::OVERFLOW_ERROR }, 0 };
+            default: break; // A division by zero.
+        }
+    }
+    return m_program.run();
+}
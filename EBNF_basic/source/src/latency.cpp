@@ -0,0 +1,43 @@
+#include <algorithm> // std::min
+#include <cmath>     // std::ceil
+#include <cstdio>    // std::snprintf
+
+#include "../include/latency.h"
+
+/// Adds the durations of another histogram.
+void LatencyHistogram::merge( const LatencyHistogram & other ) {
+    for ( std::size_t i {0}; i < N_BUCKETS; i++ )
+        m_counts[i] += other.m_counts[i];
+    m_count += other.m_count;
+    if ( other.m_max > m_max ) m_max = other.m_max;
+}
+
+/// Forgets every duration.
+void LatencyHistogram::clear( void ) {
+    *this = LatencyHistogram{};
+}
+
+/// The duration that a fraction of the others do not exceed.
+std::uint64_t LatencyHistogram::percentile( double q ) const {
+    if ( m_count == 0 ) return 0;
+    // The rank of the duration, from 1.
+    const double wanted { std::ceil( q * static_cast< double >( m_count ) ) };
+    const std::uint64_t rank { wanted < 1 ? 1 : std::min( m_count, static_cast< std::uint64_t >( wanted ) ) };
+    std::uint64_t seen {0};
+    std::size_t i {0};
+    while ( ( seen += m_counts[i] ) < rank ) i++;
+    if ( i < 2 * SUB ) return i;
+    const unsigned shift { static_cast< unsigned >( i >> SUB_BITS ) - 1 };
+    const std::uint64_t upper { ( ( SUB + ( i & ( SUB - 1 ) ) + 1 ) << shift ) - 1 };
+    return std::min( upper, m_max );
+}
+
+/// Appends a line with the count, p50, p90, p99, p99.9 and the maximum, in microseconds.
+void LatencyHistogram::append_summary( std::string & out ) const {
+    char line[160];
+    auto us = []( std::uint64_t ns ) { return static_cast< double >( ns ) / 1000.0; };
+    std::snprintf( line, sizeof( line ), "%llu requests, latency p50 %.1f us, p90 %.1f us, p99 %.1f us, p99.9 %.1f us, max %.1f us\n",
+                   static_cast< unsigned long long >( m_count ), us( percentile( 0.5 ) ), us( percentile( 0.9 ) ),
+                   us( percentile( 0.99 ) ), us( percentile( 0.999 ) ), us( m_max ) );
+    out += line;
+}
@@ -0,0 +1,146 @@
+#include <cstring> // std::memcpy, std::memset
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define BARES_HAVE_SIMD_SCAN
+#include <immintrin.h> // SSE2 and AVX2 intrinsics
+#endif
+
+#include "../include/line_scanner.h"
+
+namespace {
+    /// Fills the masks of 64 bytes: bit i is set if byte i is a line break, or outside the alphabet.
+    using classify_type = void (*)( const char * p, std::uint64_t & newlines, std::uint64_t & invalid );
+
+    /// One byte at a time, for the processors we have no vector code for.
+    [[maybe_unused]] void classify_scalar( const char * p, std::uint64_t & newlines, std::uint64_t & invalid ) {
+        newlines = invalid = 0;
+        for ( unsigned i {0}; i < 64; i++ ) {
+            if ( p[i] == '\n' ) newlines |= std::uint64_t{1} << i;
+            else if ( not LineScanner::accepted( p[i] ) ) invalid |= std::uint64_t{1} << i;
+        }
+    }
+
+#ifdef BARES_HAVE_SIMD_SCAN
+    /*
+     * The alphabet is "(" to "9" (but "," and "."), plus "%", "^" and the white
+     * space std::isspace() knows: " " and "\t" to "\r".
+     * The range test uses signed comparisons, which put the bytes from 0x80 up
+     * below "(", out of the range, as they should be.
+     */
+
+    /// 16 bytes at a time with SSE2, which every x86-64 processor has.
+    void classify_sse2( const char * p, std::uint64_t & newlines, std::uint64_t & invalid ) {
+        newlines = invalid = 0;
+        for ( unsigned i {0}; i < 64; i += 16 ) {
+            const __m128i c = _mm_loadu_si128( reinterpret_cast< const __m128i * >( p + i ) );
+            const __m128i nl = _mm_cmpeq_epi8( c, _mm_set1_epi8( '\n' ) );
+            __m128i ok = _mm_and_si128( _mm_cmpgt_epi8( c, _mm_set1_epi8( '(' - 1 ) ),
+                                        _mm_cmplt_epi8( c, _mm_set1_epi8( '9' + 1 ) ) );
+            ok = _mm_andnot_si128( _mm_or_si128( _mm_cmpeq_epi8( c, _mm_set1_epi8( ',' ) ),
+                                                 _mm_cmpeq_epi8( c, _mm_set1_epi8( '.' ) ) ), ok );
+            ok = _mm_or_si128( ok, _mm_and_si128( _mm_cmpgt_epi8( c, _mm_set1_epi8( '\t' - 1 ) ),
+                                                  _mm_cmplt_epi8( c, _mm_set1_epi8( '\r' + 1 ) ) ) );
+            ok = _mm_or_si128( ok, _mm_cmpeq_epi8( c, _mm_set1_epi8( ' ' ) ) );
+            ok = _mm_or_si128( ok, _mm_or_si128( _mm_cmpeq_epi8( c, _mm_set1_epi8( '%' ) ),
+                                                 _mm_cmpeq_epi8( c, _mm_set1_epi8( '^' ) ) ) );
+            const auto nl_bits = static_cast< std::uint64_t >( static_cast< unsigned >( _mm_movemask_epi8( nl ) ) );
+            const auto ok_bits = static_cast< std::uint64_t >( static_cast< unsigned >( _mm_movemask_epi8( _mm_or_si128( ok, nl ) ) ) );
+            newlines |= nl_bits << i;
+            invalid |= ( ~ok_bits & 0xFFFF ) << i;
+        }
+    }
+
+    /// 32 bytes at a time with AVX2, compiled for it whatever the flags of the build.
+    __attribute__(( target( "avx2" ) ))
+    void classify_avx2( const char * p, std::uint64_t & newlines, std::uint64_t & invalid ) {
+        newlines = invalid = 0;
+        for ( unsigned i {0}; i < 64; i += 32 ) {
+            const __m256i c = _mm256_loadu_si256( reinterpret_cast< const __m256i * >( p + i ) );
+            const __m256i nl = _mm256_cmpeq_epi8( c, _mm256_set1_epi8( '\n' ) );
+            __m256i ok = _mm256_and_si256( _mm256_cmpgt_epi8( c, _mm256_set1_epi8( '(' - 1 ) ),
+                                           _mm256_cmpgt_epi8( _mm256_set1_epi8( '9' + 1 ), c ) );
+            ok = _mm256_andnot_si256( _mm256_or_si256( _mm256_cmpeq_epi8( c, _mm256_set1_epi8( ',' ) ),
+                                                       _mm256_cmpeq_epi8( c, _mm256_set1_epi8( '.' ) ) ), ok );
+            ok = _mm256_or_si256( ok, _mm256_and_si256( _mm256_cmpgt_epi8( c, _mm256_set1_epi8( '\t' - 1 ) ),
+                                                        _mm256_cmpgt_epi8( _mm256_set1_epi8( '\r' + 1 ), c ) ) );
+            ok = _mm256_or_si256( ok, _mm256_cmpeq_epi8( c, _mm256_set1_epi8( ' ' ) ) );
+            ok = _mm256_or_si256( ok, _mm256_or_si256( _mm256_cmpeq_epi8( c, _mm256_set1_epi8( '%' ) ),
+                                                       _mm256_cmpeq_epi8( c, _mm256_set1_epi8( '^' ) ) ) );
+            const auto nl_bits = static_cast< std::uint64_t >( static_cast< unsigned >( _mm256_movemask_epi8( nl ) ) );
+            const auto ok_bits = static_cast< std::uint64_t >( static_cast< unsigned >( _mm256_movemask_epi8( _mm256_or_si256( ok, nl ) ) ) );
+            newlines |= nl_bits << i;
+            invalid |= ( ~ok_bits & 0xFFFFFFFF ) << i;
+        }
+    }
+#endif
+
+    /// Picks the widest version the processor runs.
+    classify_type pick_classify( void ) {
+#ifdef BARES_HAVE_SIMD_SCAN
+        __builtin_cpu_init();
+        if ( __builtin_cpu_supports( "avx2" ) ) return classify_avx2;
+        return classify_sse2;
+#else
+        return classify_scalar;
+#endif
+    }
+
+    const classify_type classify { pick_classify() };
+
+    /// Index of the lowest bit set (the mask must not be 0).
+    inline unsigned lowest_bit( std::uint64_t mask ) {
+        return static_cast< unsigned >( __builtin_ctzll( mask ) );
+    }
+}
+
+/// Starts scanning a text.
+LineScanner::LineScanner( std::string_view text )
+    : m_text { text },
+      m_pos { 0 },
+      m_block { 0 },
+      m_newlines { 0 },
+      m_invalid { 0 } {
+    if ( not m_text.empty() ) load();
+}
+
+/// Classifies the block at m_block; a short last block is padded with spaces.
+void LineScanner::load( void ) {
+    if ( m_block + BLOCK <= m_text.size() ) {
+        classify( m_text.data() + m_block, m_newlines, m_invalid );
+        return;
+    }
+    char tail[BLOCK];
+    std::memset( tail, ' ', BLOCK );
+    std::memcpy( tail, m_text.data() + m_block, m_text.size() - m_block );
+    classify( tail, m_newlines, m_invalid );
+}
+
+/// Gets the next line.
+bool LineScanner::next( Line & line ) {
+    if ( m_pos >= m_text.size() ) return false;
+    line.invalid = npos;
+    for ( ;; ) {
+        // The bits of the block that still belong to this line.
+        const std::uint64_t in_line = m_newlines != 0 ? ( m_newlines & ( 0 - m_newlines ) ) - 1 : ~std::uint64_t{0};
+        if ( line.invalid == npos and ( m_invalid & in_line ) != 0 )
+            line.invalid = m_block + lowest_bit( m_invalid & in_line ) - m_pos;
+        if ( m_newlines != 0 ) {
+            const std::size_t end { m_block + lowest_bit( m_newlines ) };
+            line.text = m_text.substr( m_pos, end - m_pos );
+            m_pos = end + 1;
+            // Forget everything up to the line break.
+            const std::uint64_t done = ( in_line << 1 ) | 1;
+            m_newlines &= ~done;
+            m_invalid &= ~done;
+            return true;
+        }
+        if ( m_block + BLOCK >= m_text.size() ) {
+            // The last line may not have a line break.
+            line.text = m_text.substr( m_pos );
+            m_pos = m_text.size();
+            return true;
+        }
+        m_block += BLOCK;
+        load();
+    }
+}
@@ -10,17 +10,599 @@
  * @copyright Copyright (c) 2021
  */
 
+#include <cerrno>  // errno
+#include <cstdio>  // std::rename
+#include <cstring> // std::strerror
+#include <stdexcept> // std::runtime_error
+#include <fcntl.h>  // open()
+#include <unistd.h> // close(), isatty(), lseek(), pread(), write()
+#include <sys/mman.h> // memfd_create()
+
 #include "../include/bares_manager.h"
+#include "../include/options.h"
+#include "../include/scheduler.h"
+#include "../include/pipeline.h"
+#include "../include/corpus.h"
+#include "../include/async_io.h"
+#include "../include/stream_parser.h"
+#include "../include/split_evaluator.h"
+#include "../include/program.h"
+#include "../include/jit.h"
+#include "../include/ast.h"
+#include "../include/compile_time.h"
+#include "../include/aggregate.h"
+#include "../include/columns.h"
+#include "../include/program_cache.h"
+#include "../include/sheet.h"
+#include "../include/incremental_evaluator.h"
+#include "../include/server.h"
+
+/// Opens a file given on the command line, reporting failures.
+static int open_file( const std::string & name, int flags ) {
+    int fd = open( name.c_str(), flags | O_CLOEXEC, 0644 );
+    if ( fd < 0 )
+        std::cerr << "Cannot open \"" << name << "\": " << std::strerror( errno ) << ".\n";
+    return fd;
+}
+
+/// Writes the summary of --aggregate.
+static void write_summary( const Options & opt, const Aggregate & totals, AsyncOutput & out ) {
+    std::string text;
+    totals.append_summary( text, opt.format );
+    out.write( text );
+    out.flush();
+}
+
+namespace {
+/// Writes the results of --format binary: the header first, then a block each time one fills up.
+class BinarySink {
+    public:
+        /// Starts the file.
+        explicit BinarySink( AsyncOutput & out ) : m_out{ out } {
+            ColumnWriter::append_header( m_text );
+            m_out.write( m_text );
+        }
+        /// Adds a result.
+        void operator()( const BaresManager::Result & res ) {
+            m_columns.add( res );
+            if ( m_columns.full() ) write_block();
+        }
+        /// Writes the last block.
+        void finish( void ) {
+            write_block();
+            m_out.flush();
+        }
+
+    private:
+        AsyncOutput & m_out;    //!< Where the file goes.
+        ColumnWriter m_columns; //!< The results not written yet.
+        std::string m_text;     //!< The bytes of a block.
+
+        void write_block( void ) {
+            m_text.clear();
+            m_columns.append_block( m_text );
+            m_out.write( m_text );
+        }
+};
+}
+
+/// Reads the whole input and evaluates it with the work-stealing scheduler.
+static void run_batch( const Options & opt, AsyncInput & in, AsyncOutput & out ) {
+    std::string input;
+    for ( auto chunk = in.next_chunk(); not chunk.empty(); chunk = in.next_chunk() )
+        input.append( chunk.data(), chunk.size() );
+    auto lines = WorkStealingScheduler::split_lines( input );
+
+    WorkStealingScheduler scheduler { opt.threads, opt.max_depth };
+    if ( opt.aggregate != 0 ) {
+        write_summary( opt, scheduler.aggregate( lines, opt.aggregate ), out );
+        return;
+    }
+    if ( opt.format == BaresManager::Format::BINARY ) {
+        BinarySink binary { out };
+        scheduler.run( lines, [&]( std::size_t, const BaresManager::Result & res ) { binary( res ); } );
+        binary.finish();
+        return;
+    }
+    std::string text;
+    scheduler.run( lines, [&]( std::size_t i, const BaresManager::Result & res ) {
+        text.clear();
+        BaresManager::append_result( res, text, opt.format, lines[i].text );
+        out.write( text );
+    } );
+    out.flush();
+}
+
+/// Evaluates the lines one after the other, each long one in pieces on several threads.
+static void run_split( const Options & opt, AsyncInput & in, AsyncOutput & out ) {
+    std::string input;
+    for ( auto chunk = in.next_chunk(); not chunk.empty(); chunk = in.next_chunk() )
+        input.append( chunk.data(), chunk.size() );
+    auto lines = WorkStealingScheduler::split_lines( input );
+
+    SplitEvaluator evaluator { opt.threads, opt.max_depth };
+    BaresManager bm { opt.max_depth };
+    Aggregate totals { opt.aggregate };
+    std::unique_ptr< BinarySink > binary;
+    if ( opt.aggregate == 0 and opt.format == BaresManager::Format::BINARY ) binary.reset( new BinarySink{ out } );
+    std::string expr, text;
+    for ( std::size_t i {0}; i < lines.size(); i++ ) {
+        expr.assign( lines[i].text );
+        // A line with a bad byte is not worth splitting.
+        BaresManager::Result res = lines[i].invalid == LineScanner::npos ? evaluator.evaluate( expr )
+                                                                         : bm.evaluate( expr, lines[i].invalid );
+        if ( opt.aggregate != 0 ) {
+            totals.add( res );
+            continue;
+        }
+        if ( binary ) {
+            ( *binary )( res );
+            continue;
+        }
+        text.clear();
+        BaresManager::append_result( res, text, opt.format, expr );
+        out.write( text );
+    }
+    if ( opt.aggregate != 0 )
+        write_summary( opt, totals, out );
+    else if ( binary )
+        binary->finish();
+    else
+        out.flush();
+}
+
+/// Evaluates the lines one after the other, parsing the chunks of the input as they arrive.
+static void run_sequential( const Options & opt, AsyncInput & in, AsyncOutput & out ) {
+    StreamParser parser { opt.max_depth };
+    Aggregate totals { opt.aggregate };
+    std::unique_ptr< BinarySink > binary;
+    if ( opt.aggregate == 0 and opt.format == BaresManager::Format::BINARY ) binary.reset( new BinarySink{ out } );
+    std::string text, line;
+    auto sink = [&]( const BaresManager::Result & res ) {
+        if ( opt.aggregate != 0 ) {
+            totals.add( res );
+            return;
+        }
+        if ( binary ) {
+            ( *binary )( res );
+            return;
+        }
+        text.clear();
+        BaresManager::append_result( res, text, opt.format, line );
+        out.write( text );
+    };
+    for ( auto chunk = in.next_chunk(); not chunk.empty(); chunk = in.next_chunk() ) {
+        if ( opt.format != BaresManager::Format::CARET or opt.aggregate != 0 ) {
+            parser.feed( chunk, sink );
+            continue;
+        }
+        // The parser keeps nothing of a line: the caret needs it, so it is kept here, line by line.
+        while ( not chunk.empty() ) {
+            auto brk = chunk.find( '\n' );
+            auto piece = chunk.substr( 0, brk == std::string_view::npos ? chunk.size() : brk + 1 );
+            line.append( piece.data(), brk == std::string_view::npos ? piece.size() : brk );
+            parser.feed( piece, sink );
+            if ( brk != std::string_view::npos ) line.clear();
+            chunk.remove_prefix( piece.size() );
+        }
+    }
+    parser.finish( sink );
+    if ( opt.aggregate != 0 )
+        write_summary( opt, totals, out );
+    else if ( binary )
+        binary->finish();
+    else
+        out.flush();
+}
+
+/// Writes the results of a file of columns as text, straight from the mapped file.
+static void run_decode( const Options & opt, int in_fd, AsyncOutput & out ) {
+    ColumnFile file { in_fd };
+    std::string text;
+    file.for_each( [&]( const BaresManager::Result & res ) {
+        text.clear();
+        BaresManager::append_result( res, text, opt.format );
+        out.write( text );
+    } );
+    out.flush();
+}
+
+/// Whether a line has nothing but blanks.
+static bool is_blank( std::string_view line ) {
+    return line.find_first_not_of( " \t\r" ) == std::string_view::npos;
+}
+
+/// Appends what a line of a sheet came to, once the sheet is computed.
+static void append_definition( const Sheet & sheet, std::size_t n, std::string & out ) {
+    if ( n == Sheet::npos )
+        out += "Not a definition, expected <name> = <expression>!\n";
+    else
+        sheet.append_cell( n, out );
+}
+
+/// Reads every definition, computes them all, then writes what the definition of each line came to.
+static void run_sheet( const Options & opt, AsyncInput & in, AsyncOutput & out ) {
+    std::string input;
+    for ( auto chunk = in.next_chunk(); not chunk.empty(); chunk = in.next_chunk() )
+        input.append( chunk.data(), chunk.size() );
+    auto lines = WorkStealingScheduler::split_lines( input );
+
+    // A name defined twice keeps its last definition.
+    Sheet sheet { opt.threads, opt.max_depth };
+    std::vector< std::size_t > defines( lines.size(), Sheet::npos );
+    for ( std::size_t i {0}; i < lines.size(); i++ ) {
+        std::string_view name;
+        std::size_t at;
+        if ( Sheet::split_definition( lines[i].text, name, at ) )
+            defines[i] = sheet.set( name, lines[i].text.substr( at ), at );
+    }
+    sheet.recompute();
 
-int main( void ) {
-    BaresManager bm; // an instance of class BaresManager
+    std::string text;
+    for ( std::size_t i {0}; i < lines.size(); i++ ) {
+        if ( defines[i] == Sheet::npos and is_blank( lines[i].text ) ) continue;
+        text.clear();
+        append_definition( sheet, defines[i], text );
+        out.write( text );
+    }
+    out.flush();
+}
+
+/// Reads definitions as they are typed, and shows each one and every other it changed.
+static void run_sheet_typed( const Options & opt ) {
+    Sheet sheet { opt.threads, opt.max_depth };
+    std::string line, text;
+    while ( std::getline( std::cin, line ) ) {
+        std::string_view name;
+        std::size_t at;
+        if ( is_blank( line ) ) continue;
+        text.clear();
+        if ( not Sheet::split_definition( line, name, at ) ) {
+            append_definition( sheet, Sheet::npos, text );
+            std::cout << text << std::flush;
+            continue;
+        }
+        const std::size_t n { sheet.set( name, std::string_view{ line }.substr( at ), at ) };
+        sheet.recompute();
+        append_definition( sheet, n, text );
+        for ( std::size_t i {0}; i < sheet.size(); i++ )
+            if ( i != n and sheet.defined( i ) and sheet.changed( i ) ) sheet.append_cell( i, text );
+        std::cout << text << std::flush;
+    }
+}
 
-    std::string expr;
-    // evaluate an expression while has lines to read.
-    while (std::getline(std::cin, expr))
+/// Evaluates each line as a new version of the line before it, parsing again only what changed.
+static void run_incremental( const Options & opt, AsyncInput & in, AsyncOutput & out ) {
+    IncrementalEvaluator inc { opt.max_depth };
+    std::string line, text;
+    auto evaluate = [&]() {
+        text.clear();
+        BaresManager::append_result( inc.update( line ), text, opt.format, line );
+        out.write( text );
+        line.clear();
+    };
+    for ( auto chunk = in.next_chunk(); not chunk.empty(); chunk = in.next_chunk() ) {
+        for ( auto brk = chunk.find( '\n' ); brk != std::string_view::npos; brk = chunk.find( '\n' ) ) {
+            line.append( chunk.data(), brk );
+            evaluate();
+            chunk.remove_prefix( brk + 1 );
+        }
+        line.append( chunk.data(), chunk.size() );
+    }
+    if ( not line.empty() ) evaluate();
+    out.flush();
+}
+
+/// Evaluates each typed line as a new version of the line before it.
+static void run_incremental_typed( const Options & opt ) {
+    IncrementalEvaluator inc { opt.max_depth };
+    std::string line, text;
+    while ( std::getline( std::cin, line ) ) {
+        text.clear();
+        BaresManager::append_result( inc.update( line ), text, opt.format, line );
+        std::cout << text << std::flush;
+    }
+}
+
+/// Whether a cache file exists and was built from this input.
+static bool cache_is_fresh( const std::string & name, const ProgramCache::Source & source ) {
+    int fd = open( name.c_str(), O_RDONLY | O_CLOEXEC );
+    if ( fd < 0 ) return false;
+    bool fresh { false };
+    try {
+        fresh = ProgramCache{ fd }.matches( source );
+    }
+    catch ( const std::runtime_error & ) { /* Not a cache we can read: it is built again. */ }
+    close( fd );
+    return fresh;
+}
+
+/// Runs the programs of a cache of the input, building the cache first if it is missing or stale.
+static void run_cached( const Options & opt, AsyncInput & in, int in_fd, AsyncOutput & out ) {
+    const ProgramCache::Source source = ProgramCache::describe( in_fd, opt.max_depth );
+    if ( not cache_is_fresh( opt.cache, source ) ) {
+        std::string input;
+        for ( auto chunk = in.next_chunk(); not chunk.empty(); chunk = in.next_chunk() )
+            input.append( chunk.data(), chunk.size() );
+        auto lines = WorkStealingScheduler::split_lines( input );
+        // Written aside and renamed, so no other run ever maps half a cache.
+        const std::string temp { opt.cache + ".tmp" };
+        int fd = open_file( temp, O_WRONLY | O_CREAT | O_TRUNC );
+        if ( fd < 0 ) throw std::runtime_error( "Cannot write the cache." );
+        {
+            AsyncOutput cache_out { fd, opt.io };
+            BaresManager bm { opt.max_depth };
+            ProgramCache::build( lines, source, bm, cache_out );
+        }
+        close( fd );
+        if ( std::rename( temp.c_str(), opt.cache.c_str() ) != 0 )
+            throw std::runtime_error( "Cannot write the cache \"" + opt.cache + "\": " + std::strerror( errno ) );
+    }
+
+    int fd = open_file( opt.cache, O_RDONLY );
+    if ( fd < 0 ) throw std::runtime_error( "Cannot read the cache." );
+    ProgramCache cache { fd };
+    Aggregate totals { opt.aggregate };
+    std::unique_ptr< BinarySink > binary;
+    if ( opt.aggregate == 0 and opt.format == BaresManager::Format::BINARY ) binary.reset( new BinarySink{ out } );
+    std::string text;
+    cache.for_each( [&]( const BaresManager::Result & res ) {
+        if ( opt.aggregate != 0 )
+            totals.add( res );
+        else if ( binary )
+            ( *binary )( res );
+        else {
+            text.clear();
+            BaresManager::append_result( res, text, opt.format );
+            out.write( text );
+        }
+    } );
+    close( fd );
+    if ( opt.aggregate != 0 )
+        write_summary( opt, totals, out );
+    else if ( binary )
+        binary->finish();
+    else
+        out.flush();
+}
+
+/// Tells whether two results would be printed the same way and carry the same value.
+static bool same_result( const BaresManager::Result & a, const BaresManager::Result & b ) {
+    return a.status.type == b.status.type and a.status.at_col == b.status.at_col and a.value == b.value;
+}
+
+/// Makes a file in memory that holds `text`, ready to be read from its start.
+static int memory_file( std::string_view text ) {
+    int fd = memfd_create( "bares-verify", MFD_CLOEXEC );
+    if ( fd < 0 ) throw std::runtime_error( std::string{ "memfd_create: " } + std::strerror( errno ) );
+    for ( std::size_t done {0}; done < text.size(); ) {
+        const ssize_t w = write( fd, text.data() + done, text.size() - done );
+        if ( w < 0 and errno == EINTR ) continue;
+        if ( w < 0 ) {
+            const int err { errno };
+            close( fd );
+            throw std::runtime_error( std::string{ "write: " } + std::strerror( err ) );
+        }
+        done += static_cast< std::size_t >( w );
+    }
+    lseek( fd, 0, SEEK_SET );
+    return fd;
+}
+
+/// Reads the whole of a file in memory.
+static std::string read_memory_file( int fd ) {
+    std::string text;
+    char buffer[1u << 16];
+    for ( off_t at {0};; ) {
+        const ssize_t r = pread( fd, buffer, sizeof( buffer ), at );
+        if ( r < 0 and errno == EINTR ) continue;
+        if ( r < 0 ) throw std::runtime_error( std::string{ "pread: " } + std::strerror( errno ) );
+        if ( r == 0 ) return text;
+        text.append( buffer, static_cast< std::size_t >( r ) );
+        at += r;
+    }
+}
+
+/// Checks that one Pipeline gives the reference results when it runs, then aggregates twice. @return the mismatches.
+static std::size_t check_pipeline( const Options & opt, std::string_view input, const std::string & expected_text,
+                                   const std::string & expected_summary ) {
+    // Small blocks, so that each run goes through the ring of evaluated blocks more than once.
+    Pipeline pipeline { 2, opt.max_depth, BaresManager::Format::TEXT, 1u << 12 };
+    std::size_t mismatches {0};
+    const int in_fd { memory_file( input ) }, out_fd { memory_file( {} ) };
     {
-        bm.parse_and_compute(expr);
+        AsyncInput in { in_fd, opt.io };
+        AsyncOutput out { out_fd, opt.io };
+        pipeline.run( in, out );
+    }
+    if ( read_memory_file( out_fd ) != expected_text ) {
+        mismatches++;
+        std::cerr << "The results of the pipeline differ from the reference evaluation.\n";
+    }
+    for ( int round {1}; round <= 2; round++ ) {
+        lseek( in_fd, 0, SEEK_SET );
+        AsyncInput in { in_fd, opt.io };
+        std::string summary;
+        pipeline.aggregate( in, Aggregate::ALL ).append_summary( summary );
+        if ( summary != expected_summary ) {
+            mismatches++;
+            std::cerr << "Aggregate " << round << " of the pipeline differs from the reference evaluation.\n";
+        }
+    }
+    close( in_fd );
+    close( out_fd );
+    return mismatches;
+}
+
+/// Checks, line by line, that the compiled engines agree with the reference evaluation.
+static bool run_verify( const Options & opt, AsyncInput & in, AsyncOutput & out ) {
+    std::string input;
+    for ( auto chunk = in.next_chunk(); not chunk.empty(); chunk = in.next_chunk() )
+        input.append( chunk.data(), chunk.size() );
+    auto lines = WorkStealingScheduler::split_lines( input );
+
+    BaresManager bm { opt.max_depth };
+    Program program;
+    Ast ast;
+    std::string expected_text;
+    Aggregate expected_totals { Aggregate::ALL };
+    std::size_t compiled {0}, mismatches {0}, zero_divisors {0};
+    bool native { JitProgram::supported() };
+    for ( std::size_t i {0}; i < lines.size(); i++ ) {
+        std::string expr { lines[i].text };
+        BaresManager::Result expected = bm.evaluate( expr );
+        BaresManager::append_result( expected, expected_text );
+        expected_totals.add( expected );
+        // The constexpr evaluation must agree on every line, errors included.
+        BaresManager::Result constant = bares::evaluate( expr, opt.max_depth );
+        if ( not same_result( expected, constant ) and ++mismatches <= 10 ) {
+            std::string exp_text, got_text;
+            BaresManager::append_result( expected, exp_text );
+            BaresManager::append_result( constant, got_text );
+            std::cerr << "Line " << i + 1 << " (constexpr): expected " << exp_text << "  but got " << got_text;
+        }
+        Parser::ResultType status = bm.compile( expr, program );
+        if ( status.type == Parser::ResultType::DIVISION_BY_ZERO ) {
+            // A literal zero divisor always divides by zero, unless the final value overflows.
+            zero_divisors++;
+            if ( expected.status.type != Parser::ResultType::DIVISION_BY_ZERO and
+                 expected.status.type != Parser::ResultType::OVERFLOW_ERROR and ++mismatches <= 10 )
+                std::cerr << "Line " << i + 1 << ": a zero divisor at column " << status.at_col + 1
+                          << " was found, but the evaluation did not divide by zero.\n";
+        }
+        else if ( status.type != Parser::ResultType::OK ) continue;
+        compiled++;
+        JitProgram jit { program };
+        native = native and jit.native();
+        // The tree is also split among threads, even for small subtrees, to check that path.
+        bm.build_ast( expr, ast, true );
+        BaresManager::Result shared = ast.evaluate();
+        BaresManager::Result parallel = ast.evaluate( 4, 1 );
+        bm.build_ast( expr, ast, false );
+        const char * engines[] = { "bytecode", "jit", "ast", "ast-parallel", "ast-unshared" };
+        BaresManager::Result got[] = { program.run(), jit.run(), shared, parallel, ast.evaluate( 4, 1 ) };
+        for ( std::size_t e {0}; e < 5; e++ ) {
+            if ( same_result( expected, got[e] ) ) continue;
+            if ( ++mismatches <= 10 ) {
+                std::string exp_text, got_text;
+                BaresManager::append_result( expected, exp_text );
+                BaresManager::append_result( got[e], got_text );
+                std::cerr << "Line " << i + 1 << " (" << engines[e] << "): expected " << exp_text
+                          << "  but got " << got_text;
+            }
+        }
+    }
+    // The pipeline must also give them, however many times it is run.
+    std::string expected_summary;
+    expected_totals.append_summary( expected_summary );
+    mismatches += check_pipeline( opt, input, expected_text, expected_summary );
+
+    std::string summary = std::to_string( compiled ) + " of " + std::to_string( lines.size() )
+                        + " lines compiled and checked (" + std::to_string( zero_divisors )
+                        + " with a literal zero divisor), " + std::to_string( mismatches ) + " mismatches"
+                        + ( native ? "" : " (no native code, the JIT used the interpreter)" ) + ".\n";
+    out.write( summary );
+    out.flush();
+    return mismatches == 0;
+}
+
+int main( int argc, char * argv[] ) {
+    Options opt;
+    if ( not parse_options( argc, argv, opt ) ) {
+        print_usage( std::cerr, argv[0] );
+        return EXIT_FAILURE;
+    }
+    if ( opt.help ) {
+        print_usage( std::cout, argv[0] );
+        return EXIT_SUCCESS;
+    }
+    std::ios::sync_with_stdio( false );
+
+    if ( opt.generate > 0 ) {
+        CorpusGenerator generator { opt.seed };
+        for ( std::size_t i {0}; i < opt.generate; i++ )
+            std::cout << generator.next() << '\n';
+        return EXIT_SUCCESS;
+    }
+
+    if ( not opt.serve.empty() ) {
+        try {
+            EvalServer server { opt.serve, opt.threads, opt.max_depth };
+            std::cerr << "Serving on \"" << opt.serve << "\" (SIGINT or SIGTERM to stop).\n";
+            server.run();
+        }
+        catch ( const std::exception & e ) {
+            std::cerr << e.what() << '\n';
+            return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+    }
+
+    // Someone typing the expressions gets each answer right away, as before.
+    if ( opt.input.empty() and opt.output.empty() and not opt.batch and not opt.pipeline and not opt.verify
+         and not opt.split and opt.aggregate == 0 and not opt.decode and opt.cache.empty() and isatty( 0 ) ) {
+        if ( opt.sheet ) {
+            run_sheet_typed( opt );
+            return EXIT_SUCCESS;
+        }
+        if ( opt.incremental ) {
+            run_incremental_typed( opt );
+            return EXIT_SUCCESS;
+        }
+        BaresManager bm{ opt.max_depth }; // an instance of class BaresManager
+
+        std::string expr;
+        // evaluate an expression while has lines to read.
+        while (std::getline(std::cin, expr))
+        {
+            bm.parse_and_compute(expr, opt.format);
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    int in_fd { 0 }, out_fd { 1 };
+    if ( not opt.input.empty() and ( in_fd = open_file( opt.input, O_RDONLY ) ) < 0 )
+        return EXIT_FAILURE;
+    if ( not opt.output.empty() and ( out_fd = open_file( opt.output, O_WRONLY | O_CREAT | O_TRUNC ) ) < 0 )
+        return EXIT_FAILURE;
+
+    try {
+        AsyncOutput out { out_fd, opt.io };
+        if ( opt.decode )
+            run_decode( opt, in_fd, out ); // The file is mapped, not read.
+        else {
+            AsyncInput in { in_fd, opt.io };
+            if ( not opt.cache.empty() )
+                run_cached( opt, in, in_fd, out );
+            else if ( opt.sheet )
+                run_sheet( opt, in, out );
+            else if ( opt.incremental )
+                run_incremental( opt, in, out );
+            else if ( opt.verify ) {
+                if ( not run_verify( opt, in, out ) ) return EXIT_FAILURE;
+            }
+            else if ( opt.batch )
+                run_batch( opt, in, out );
+            else if ( opt.split )
+                run_split( opt, in, out );
+            else if ( opt.pipeline ) {
+                Pipeline pipeline { opt.threads, opt.max_depth, opt.format };
+                if ( opt.aggregate != 0 )
+                    write_summary( opt, pipeline.aggregate( in, opt.aggregate ), out );
+                else
+                    pipeline.run( in, out );
+            }
+            else
+                run_sequential( opt, in, out );
+        }
+    }
+    catch ( const std::exception & e ) {
+        std::cerr << e.what() << '\n';
+        return EXIT_FAILURE;
     }
 
+    if ( in_fd != 0 ) close( in_fd );
+    if ( out_fd != 1 ) close( out_fd );
     return EXIT_SUCCESS;
 }
@@ -0,0 +1,268 @@
+#include <string> // std::string, std::stoul
+
+#include "../include/options.h"
+#include "../include/aggregate.h"
+
+/// Converts the value of an option to a number, reporting invalid values.
+static bool to_number( const std::string & name, const char * value, std::size_t & number ) {
+    try {
+        std::size_t used;
+        number = std::stoul( value, &used );
+        if ( used == std::string{ value }.size() )
+            return true;
+    }
+    catch ( const std::exception & ) { /* reported below */ }
+    std::cerr << "Invalid value \"" << value << "\" for option " << name << ".\n";
+    return false;
+}
+
+/// Reads the command line arguments.
+bool parse_options( int argc, char * argv[], Options & opt ) {
+    for ( int i {1}; i < argc; i++ ) {
+        std::string arg { argv[i] };
+        std::string value;
+        bool has_value { false };
+        // Accept both "--name value" and "--name=value".
+        auto eq = arg.find( '=' );
+        if ( arg.rfind( "--", 0 ) == 0 and eq != std::string::npos ) {
+            value = arg.substr( eq + 1 );
+            arg = arg.substr( 0, eq );
+            has_value = true;
+        }
+        // Fetches the value of an option that needs one.
+        auto next_value = [&]() -> const char * {
+            if ( has_value ) return value.c_str();
+            if ( i + 1 < argc ) return argv[++i];
+            std::cerr << "Option " << arg << " requires a value.\n";
+            return nullptr;
+        };
+
+        if ( arg == "-h" or arg == "--help" ) {
+            opt.help = true;
+        }
+        else if ( arg == "-b" or arg == "--batch" ) {
+            opt.batch = true;
+        }
+        else if ( arg == "-p" or arg == "--pipeline" ) {
+            opt.pipeline = true;
+        }
+        else if ( arg == "-s" or arg == "--split" ) {
+            opt.split = true;
+        }
+        else if ( arg == "--verify" ) {
+            opt.verify = true;
+        }
+        else if ( arg == "--cache" ) {
+            const char * v = next_value();
+            if ( v == nullptr ) return false;
+            opt.cache = v;
+        }
+        else if ( arg == "--decode" ) {
+            opt.decode = true;
+        }
+        else if ( arg == "--sheet" ) {
+            opt.sheet = true;
+        }
+        else if ( arg == "--incremental" ) {
+            opt.incremental = true;
+        }
+        else if ( arg == "--serve" ) {
+            const char * v = next_value();
+            if ( v == nullptr ) return false;
+            opt.serve = v;
+        }
+        else if ( arg == "-t" or arg == "--threads" ) {
+            const char * v = next_value();
+            if ( v == nullptr or not to_number( arg, v, opt.threads ) ) return false;
+        }
+        else if ( arg == "--max-depth" ) {
+            const char * v = next_value();
+            if ( v == nullptr or not to_number( arg, v, opt.max_depth ) ) return false;
+        }
+        else if ( arg == "--generate" ) {
+            const char * v = next_value();
+            if ( v == nullptr or not to_number( arg, v, opt.generate ) ) return false;
+        }
+        else if ( arg == "--seed" ) {
+            std::size_t seed;
+            const char * v = next_value();
+            if ( v == nullptr or not to_number( arg, v, seed ) ) return false;
+            opt.seed = static_cast< unsigned >( seed );
+        }
+        else if ( arg == "-i" or arg == "--input" ) {
+            const char * v = next_value();
+            if ( v == nullptr ) return false;
+            opt.input = v;
+        }
+        else if ( arg == "-o" or arg == "--output" ) {
+            const char * v = next_value();
+            if ( v == nullptr ) return false;
+            opt.output = v;
+        }
+        else if ( arg == "--io" ) {
+            const char * v = next_value();
+            if ( v == nullptr ) return false;
+            std::string name { v };
+            if ( name == "auto" ) opt.io = IoBackend::AUTO;
+            else if ( name == "uring" ) opt.io = IoBackend::URING;
+            else if ( name == "sync" ) opt.io = IoBackend::SYNC;
+            else {
+                std::cerr << "Invalid value \"" << name << "\" for option " << arg << ".\n";
+                return false;
+            }
+        }
+        else if ( arg == "--format" ) {
+            const char * v = next_value();
+            if ( v == nullptr ) return false;
+            std::string name { v };
+            if ( name == "text" ) opt.format = BaresManager::Format::TEXT;
+            else if ( name == "caret" ) opt.format = BaresManager::Format::CARET;
+            else if ( name == "json" ) opt.format = BaresManager::Format::JSON;
+            else if ( name == "binary" ) opt.format = BaresManager::Format::BINARY;
+            else {
+                std::cerr << "Invalid value \"" << name << "\" for option " << arg << ".\n";
+                return false;
+            }
+        }
+        else if ( arg == "--aggregate" ) {
+            const char * v = next_value();
+            if ( v == nullptr ) return false;
+            if ( not Aggregate::parse_parts( v, opt.aggregate ) ) {
+                std::cerr << "Invalid value \"" << v << "\" for option " << arg << ".\n";
+                return false;
+            }
+        }
+        else {
+            std::cerr << "Unknown option \"" << argv[i] << "\".\n";
+            return false;
+        }
+    }
+    // Asking for more than one thread means the batch mode, unless the pipeline was chosen.
+    if ( opt.threads > 1 and not opt.pipeline and not opt.verify and not opt.split and not opt.decode and opt.cache.empty()
+         and not opt.sheet and not opt.incremental and opt.serve.empty() ) opt.batch = true;
+    if ( opt.batch and opt.pipeline ) {
+        std::cerr << "Options --batch and --pipeline cannot be used together.\n";
+        return false;
+    }
+    if ( opt.split and ( opt.batch or opt.pipeline or opt.verify ) ) {
+        std::cerr << "Option --split cannot be used with --batch, --pipeline or --verify.\n";
+        return false;
+    }
+    if ( opt.decode and ( opt.batch or opt.pipeline or opt.split or opt.verify or opt.aggregate != 0 ) ) {
+        std::cerr << "Option --decode cannot be used with --batch, --pipeline, --split, --verify or --aggregate.\n";
+        return false;
+    }
+    if ( opt.decode and opt.format != BaresManager::Format::TEXT and opt.format != BaresManager::Format::JSON ) {
+        std::cerr << "Option --decode writes the text or json formats only.\n";
+        return false;
+    }
+    if ( not opt.cache.empty() ) {
+        if ( opt.batch or opt.pipeline or opt.split or opt.verify or opt.decode ) {
+            std::cerr << "Option --cache cannot be used with --batch, --pipeline, --split, --verify or --decode.\n";
+            return false;
+        }
+        if ( opt.input.empty() ) {
+            std::cerr << "Option --cache needs the input file, given with --input.\n";
+            return false;
+        }
+        if ( opt.format == BaresManager::Format::CARET ) {
+            std::cerr << "Option --cache keeps no expressions to show with --format caret.\n";
+            return false;
+        }
+    }
+    if ( opt.sheet ) {
+        if ( opt.batch or opt.pipeline or opt.split or opt.verify or opt.decode or not opt.cache.empty() or opt.aggregate != 0 ) {
+            std::cerr << "Option --sheet cannot be used with --batch, --pipeline, --split, --verify, --decode, --cache or --aggregate.\n";
+            return false;
+        }
+        if ( opt.format != BaresManager::Format::TEXT ) {
+            std::cerr << "Option --sheet writes the text format only.\n";
+            return false;
+        }
+    }
+    if ( opt.incremental ) {
+        if ( opt.batch or opt.pipeline or opt.split or opt.verify or opt.decode or not opt.cache.empty() or opt.aggregate != 0
+             or opt.sheet ) {
+            std::cerr << "Option --incremental cannot be used with --batch, --pipeline, --split, --verify, --decode, --cache,"
+                         " --aggregate or --sheet.\n";
+            return false;
+        }
+        if ( opt.format == BaresManager::Format::BINARY ) {
+            std::cerr << "Option --incremental writes the text, caret or json formats only.\n";
+            return false;
+        }
+    }
+    if ( not opt.serve.empty() ) {
+        if ( opt.batch or opt.pipeline or opt.split or opt.verify or opt.decode or not opt.cache.empty() or opt.aggregate != 0
+             or opt.sheet or opt.incremental or not opt.input.empty() or not opt.output.empty() ) {
+            std::cerr << "Option --serve cannot be used with --batch, --pipeline, --split, --verify, --decode, --cache,"
+                         " --aggregate, --sheet, --incremental, --input or --output.\n";
+            return false;
+        }
+        if ( opt.format != BaresManager::Format::TEXT ) {
+            std::cerr << "Option --serve answers with the frames of its own protocol, not in a --format.\n";
+            return false;
+        }
+    }
+    if ( opt.verify and opt.aggregate != 0 ) {
+        std::cerr << "Options --verify and --aggregate cannot be used together.\n";
+        return false;
+    }
+    if ( opt.verify and ( opt.batch or opt.pipeline ) ) {
+        std::cerr << "Option --verify cannot be used with --batch or --pipeline.\n";
+        return false;
+    }
+    return true;
+}
+
+/// Writes the usage message.
+void print_usage( std::ostream & os, const char * prog ) {
+    os << "Usage: " << prog << " [options] [< input]\n"
+       << "Evaluates one arithmetic expression per input line.\n\n"
+       << "Options:\n"
+       << "  -b, --batch          read the whole input and evaluate it in parallel\n"
+       << "                       with the work-stealing scheduler\n"
+       << "  -p, --pipeline       overlap reading, evaluating and writing: one reader,\n"
+       << "                       <n> evaluator threads and one writer\n"
+       << "  -s, --split          evaluate each long line in pieces cut at its outermost\n"
+       << "                       \"+\" and \"-\", on <n> threads (for huge expressions)\n"
+       << "  -t, --threads <n>    number of worker threads (0 = one per core); n > 1 implies\n"
+       << "                       --batch unless --pipeline or --split is given\n"
+       << "      --verify         instead of printing the results, check that the bytecode\n"
+       << "                       interpreter, the JIT, the syntax tree and the constexpr\n"
+       << "                       evaluation agree with the reference evaluation\n"
+       << "      --max-depth <n>  refuse expressions with more than <n> nested parentheses\n"
+       << "                       (default " << Parser::DEFAULT_MAX_DEPTH << ")\n"
+       << "      --generate <n>   write <n> random expressions with skewed sizes and exit\n"
+       << "      --seed <s>       seed for --generate (default 1)\n"
+       << "  -i, --input <file>   read the expressions from <file> instead of the standard input\n"
+       << "  -o, --output <file>  write the results to <file> instead of the standard output\n"
+       << "      --io <backend>   how to read and write: auto (io_uring if available, the\n"
+       << "                       default), uring or sync (plain read/write)\n"
+       << "      --format <f>     how to write the results: text (the default), caret (text,\n"
+       << "                       plus the expression and a \"^\" under the column of each\n"
+       << "                       syntax error) or json (one object per line, with the\n"
+       << "                       status code and the value or the column) or binary\n"
+       << "                       (little-endian columns of values, codes and columns, in\n"
+       << "                       blocks aligned to 64 bytes, to be mapped in memory)\n"
+       << "      --decode         read a file written with --format binary and write its\n"
+       << "                       results as text (or json)\n"
+       << "      --cache <file>   keep the compiled lines of the --input file in <file>, and\n"
+       << "                       run them from there (mapped in memory, nothing parsed)\n"
+       << "                       while the input does not change\n"
+       << "      --aggregate <p>  write a summary of all the results instead of each one;\n"
+       << "                       <p> is a comma separated list of sum (count, sum and mean\n"
+       << "                       of the values), minmax, errors (lines of each result code),\n"
+       << "                       histogram (times each value came out) or all\n"
+       << "      --sheet          read definitions, \"name = expression\", whose expressions\n"
+       << "                       may use the names of the others, and write the value of\n"
+       << "                       each one (typed ones show what each change recomputed);\n"
+       << "                       the independent definitions are computed on <n> threads\n"
+       << "      --incremental    take each line as an edit of the line before it (as an\n"
+       << "                       editor sends an expression while it is typed) and parse\n"
+       << "                       again only the parentheses around what changed\n"
+       << "      --serve <path>   serve the clients of a Unix domain socket made at <path>\n"
+       << "                       (length-prefixed requests and binary results), batching\n"
+       << "                       their requests on <n> threads, until SIGINT or SIGTERM\n"
+       << "  -h, --help           show this message\n";
+}
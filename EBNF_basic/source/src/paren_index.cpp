@@ -0,0 +1,90 @@
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define BARES_HAVE_SSE2_INDEX
+#include <emmintrin.h> // SSE2 intrinsics
+#endif
+
+#include "../include/paren_index.h"
+
+namespace {
+#ifdef BARES_HAVE_SSE2_INDEX
+    /// The highest of 16 signed bytes.
+    inline int highest( __m128i v ) {
+        // Flipping the sign bit makes the unsigned maximum work on signed bytes.
+        v = _mm_xor_si128( v, _mm_set1_epi8( -128 ) );
+        v = _mm_max_epu8( v, _mm_srli_si128( v, 8 ) );
+        v = _mm_max_epu8( v, _mm_srli_si128( v, 4 ) );
+        v = _mm_max_epu8( v, _mm_srli_si128( v, 2 ) );
+        v = _mm_max_epu8( v, _mm_srli_si128( v, 1 ) );
+        return ( _mm_cvtsi128_si32( v ) & 0xFF ) - 128;
+    }
+#endif
+}
+
+/// Indexes the parentheses of a line.
+void ParenIndex::build( std::string_view line ) {
+    m_balance = 0;
+    m_max_depth = 0;
+    m_stray = npos;
+
+    std::ptrdiff_t depth {0}, highest_depth {0};
+    std::size_t i {0};
+#ifdef BARES_HAVE_SSE2_INDEX
+    for ( ; i + 16 <= line.size(); i += 16 ) {
+        const __m128i c = _mm_loadu_si128( reinterpret_cast< const __m128i * >( line.data() + i ) );
+        const __m128i open = _mm_cmpeq_epi8( c, _mm_set1_epi8( '(' ) );
+        const __m128i close = _mm_cmpeq_epi8( c, _mm_set1_epi8( ')' ) );
+        if ( _mm_movemask_epi8( _mm_or_si128( open, close ) ) == 0 ) continue;
+
+        // The masks are -1 where they match: +1 for each "(", -1 for each ")".
+        __m128i sum = _mm_sub_epi8( close, open );
+        // Prefix sum: byte j gets the sum of bytes 0 to j of the block.
+        sum = _mm_add_epi8( sum, _mm_slli_si128( sum, 1 ) );
+        sum = _mm_add_epi8( sum, _mm_slli_si128( sum, 2 ) );
+        sum = _mm_add_epi8( sum, _mm_slli_si128( sum, 4 ) );
+        sum = _mm_add_epi8( sum, _mm_slli_si128( sum, 8 ) );
+
+        if ( depth + highest( sum ) > highest_depth ) highest_depth = depth + highest( sum );
+        if ( m_stray == npos and depth - highest( _mm_sub_epi8( _mm_setzero_si128(), sum ) ) < 0 ) {
+            // Somewhere in this block a ")" closes nothing: find which one.
+            std::ptrdiff_t d { depth };
+            for ( std::size_t j { i }; m_stray == npos; j++ ) {
+                if ( line[j] == '(' ) d++;
+                else if ( line[j] == ')' and --d < 0 ) m_stray = j;
+            }
+        }
+        depth += static_cast< signed char >( _mm_extract_epi16( sum, 7 ) >> 8 );
+    }
+#endif
+    // What is left, or the whole line where there is no vector code.
+    for ( ; i < line.size(); i++ ) {
+        if ( line[i] == '(' ) {
+            if ( ++depth > highest_depth ) highest_depth = depth;
+        }
+        else if ( line[i] == ')' ) {
+            if ( --depth < 0 and m_stray == npos ) m_stray = i;
+        }
+    }
+
+    m_balance = depth;
+    m_max_depth = static_cast< std::size_t >( highest_depth );
+}
+
+/// Lists the parentheses and pairs every ")" with the last "(" still open before it.
+void ParenIndex::match( std::string_view line ) {
+    m_position.clear();
+    m_partner.clear();
+    m_open.clear();
+    for ( std::size_t i {0}; i < line.size(); i++ ) {
+        if ( line[i] != '(' and line[i] != ')' ) continue;
+        const auto k = static_cast< std::uint32_t >( m_position.size() );
+        m_position.push_back( static_cast< std::uint32_t >( i ) );
+        m_partner.push_back( NONE );
+        if ( line[i] == '(' )
+            m_open.push( k );
+        else if ( not m_open.empty() ) {
+            std::uint32_t other = m_open.pop_unchecked();
+            m_partner[other] = k;
+            m_partner[k] = other;
+        }
+    }
+}
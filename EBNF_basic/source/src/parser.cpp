@@ -1,4 +1,8 @@
+#include <stdexcept> // std::out_of_range
+
 #include "../include/parser.h"
+#include "../include/arithmetic.h"
+#include "../include/ast.h"
 #include "../lib/stack.h"
 
 /// Converts the input character c_ into its corresponding terminal symbol code.
@@ -90,118 +94,203 @@ void Parser::skip_ws( void ) {
 /// Validates (i.e. returns true or false) and consumes an **expression** from the input expression string.
 /*! This method parses a valid expression from the input and, at the same time, it tokenizes its components.
  *
- * Production rule is:
+ * Production rules are:
  * ```
- *  <expr> := <term>,{ ("+"|"-"),<term> };
+ *  <expr> := <term>,{ ("+"|"-"|"*"|"/"|"%"|"^"),<term> };
+ *  <term> := "(",<expr>,")" | <integer>;
  * ```
- * An expression might be just a term or one or more terms with '+'/'-' between them.
+ * An expression might be just a term or one or more terms with operators between them.
+ *
+ * A "(" starts a new expression inside the current one. Instead of calling this
+ * method again, the state of the outer expression (whether its term followed an
+ * operator) is pushed on a stack and popped back at the matching ")". That keeps
+ * the native stack usage constant however deep the input is nested, and lets us
+ * refuse more than `m_max_depth` open parentheses.
  */
 bool Parser::expression( void ) {
-    if ( not term() ) return false;
-    // Process terms
-    while( m_result.type == ResultType::OK ) {
-        skip_ws();
-        if ( accept( Parser::terminal_symbol_t::TS_MINUS ) ) {
-            // Stores the "-" token in the list.
-            m_tk_list.emplace_back( Token{ "-", Token::token_t::OPERATOR } );
-        }
-        else if ( accept( Parser::terminal_symbol_t::TS_PLUS ) ) {
-            // Stores the "+" token in the list.
-            m_tk_list.emplace_back( Token{ "+", Token::token_t::OPERATOR } );
-        }
-        else if ( accept( Parser::terminal_symbol_t::TS_MULTI ) ) {
-            // Stores the "*" token in the list.
-            m_tk_list.emplace_back( Token{ "*", Token::token_t::OPERATOR } );
-        }
-        else if ( accept( Parser::terminal_symbol_t::TS_DIVISION ) ) {
-            // Stores the "/" token in the list.
-            m_tk_list.emplace_back( Token{ "/", Token::token_t::OPERATOR } );
-        }
-        else if ( accept( Parser::terminal_symbol_t::TS_REST ) ) {
-            // Stores the "%" token in the list.
-            m_tk_list.emplace_back( Token{ "%", Token::token_t::OPERATOR } );
+    // For each "(" still open: whether that parenthesized term follows an operator.
+    sta::stack< bool > open;
+    open.reserve( std::min( m_parens.max_depth(), m_max_depth ) );
+    // Whether the term being parsed follows an operator.
+    bool after_op { false };
+
+    for ( ;; ) {
+        // [1] A term: an integer or a "(" that begins a new expression.
+        if ( not term() and m_result.type == ResultType::OK ) {
+            if ( accept( Parser::terminal_symbol_t::TS_OPEN_PARENTHESES ) ) {
+                if ( open.size() >= m_max_depth ) {
+                    // Too deep: report the "(" itself.
+                    m_result = ResultType{ ResultType::NESTING_TOO_DEEP,
+                                           std::distance( m_expr.begin(), m_it_curr_symb ) - 1 };
+                }
+                else {
+                    // Add a "(" to token list.
+                    if ( m_tokenize ) {
+                        m_tokens.push( Token::token_t::OPEN_PARENTHESES, '(',
+                                       static_cast< std::size_t >( std::distance( m_expr.begin(), m_it_curr_symb ) ) - 1 );
+                        count_parenthesis( '(' );
+                    }
+                    // Go to the next symbol and store the beginning of the term.
+                    skip_ws();
+                    begin_token();
+                    // Parse the inner expression, starting from its first term.
+                    open.push( after_op );
+                    after_op = false;
+                    continue;
+                }
+            }
+            else {
+                // Create the corresponding error.
+                m_result = ResultType{ ResultType::ILL_FORMED_INTEGER, std::distance( m_expr.begin(), m_it_curr_symb ) };
+            }
         }
-        else if ( accept( Parser::terminal_symbol_t::TS_EXPO ) ) {
-            // Stores the "^" token in the list.
-            m_tk_list.emplace_back( Token{ "^", Token::token_t::OPERATOR } );
+
+        // [2] The term is over: go on with the expression it belongs to.
+        for ( ;; ) {
+            if ( m_result.type != ResultType::OK ) {
+                // After a operator we expect a valid term, otherwise we have a missing term.
+                if ( after_op and m_result.type == ResultType::ILL_FORMED_INTEGER )
+                    m_result.type = ResultType::MISSING_TERM;
+                if ( open.empty() or m_result.type == ResultType::NESTING_TOO_DEEP )
+                    return false;
+                // After a "(" we expect a valid expression, otherwise the whole term is ill formed.
+                m_result = ResultType{ ResultType::ILL_FORMED_INTEGER, token_location() };
+                after_op = open.pop();
+                continue;
+            }
+
+            skip_ws();
+            if ( accept_operator() ) {
+                after_op = true;
+                break; // Back to [1], for the term after the operator.
+            }
+
+            // This expression is over.
+            if ( open.empty() ) return true;
+            // Go to the next symbol and store the beginning of the term.
+            skip_ws();
+            begin_token();
+            // And check if close the parentheses.
+            if ( accept( Parser::terminal_symbol_t::TS_CLOSE_PARENTHESES ) ) {
+                if ( m_tokenize ) {
+                    m_tokens.push( Token::token_t::CLOSE_PARENTHESES, ')', static_cast< std::size_t >( token_location() ) );
+                    count_parenthesis( ')' );
+                }
+            }
+            // After an expression beginning with "(" we expect a ")" at end.
+            else {
+                m_result = ResultType{ ResultType::MISSING_CLOSING, token_location() };
+            }
+            // Either way the parenthesized term is over, back in the outer expression.
+            after_op = open.pop();
         }
-        else break;
+    }
+}
 
-        // After a operator we expect a valid term, otherwise we have a missing term.
-        if ( not term() and m_result.type == ResultType::ILL_FORMED_INTEGER ) {
-            // Make the error more specific.
-            m_result.type = ResultType::MISSING_TERM;
+/// Tries to accept a binary operator, storing its token.
+/*!
+ * @return true if an operator was consumed; false otherwise.
+ */
+bool Parser::accept_operator( void ) {
+    static const std::pair< terminal_symbol_t, const char * > operators[] = {
+        { terminal_symbol_t::TS_MINUS, "-" },
+        { terminal_symbol_t::TS_PLUS, "+" },
+        { terminal_symbol_t::TS_MULTI, "*" },
+        { terminal_symbol_t::TS_DIVISION, "/" },
+        { terminal_symbol_t::TS_REST, "%" },
+        { terminal_symbol_t::TS_EXPO, "^" },
+    };
+    for ( const auto & op : operators ) {
+        if ( accept( op.first ) ) {
+            // Stores the operator token in the list.
+            auto col = static_cast< std::size_t >( std::distance( m_expr.begin(), m_it_curr_symb ) ) - 1;
+            if ( m_tokenize ) {
+                m_tokens.push( Token::token_t::OPERATOR, op.second[0], col );
+                count_operator( op.second[0] );
+            }
+            return true;
         }
     }
-    // Return true if everything ran smoothly.
-    return m_result.type == ResultType::OK;
+    return false;
 }
 
-/// Validates (i.e. returns true or false) and consumes a **term** from the input expression string.
-/*! This method parses and tokenizes a valid term from the input.
+/// Replays an operand on the depth counters: the calculation pushes it.
+void Parser::count_operand( void ) {
+    if ( ++m_operands > m_max_operands ) m_max_operands = m_operands;
+}
+
+/// Replays an operator on the depth counters, as BaresManager::infix_to_postfix() treats it.
+/*!
+ * The operators it pops go to the postfix list, where each one will replace
+ * two values by one on the operand stack.
+ */
+void Parser::count_operator( char op ) {
+    while ( not m_pending.empty() and bares::precedence( op ) <= bares::precedence( m_pending.top() ) ) {
+        m_pending.pop_unchecked();
+        m_operands--;
+    }
+    m_pending.push( op );
+    if ( m_pending.size() > m_max_pending ) m_max_pending = m_pending.size();
+}
+
+/// Replays a "(" or a ")" on the depth counters.
+void Parser::count_parenthesis( char p ) {
+    if ( p == '(' ) {
+        m_pending.push( p );
+        if ( m_pending.size() > m_max_pending ) m_max_pending = m_pending.size();
+        return;
+    }
+    // Everything back to the "(" goes to the postfix list.
+    while ( m_pending.top() != '(' ) {
+        m_pending.pop_unchecked();
+        m_operands--;
+    }
+    m_pending.pop_unchecked();
+}
+
+/// Validates (i.e. returns true or false) and consumes an **integer term** from the input expression string.
+/*! This method parses and tokenizes an integer term from the input; a parenthesized
+ * term is handled by expression().
  *
  * Production rule is:
  * ```
- *  <term> := <integer>;
+ *  <term> := "(",<expr>,")" | <integer>;
  * ```
- * A term is made of a single integer.
  *
- * @return true if a term has been successfuly parsed from the input; false otherwise.
+ * @return true if an integer term has been successfuly parsed from the input; false otherwise
+ * (with an error in m_result if the integer is out of range, or no error at all if there is no integer here).
  */
 bool Parser::term( void ) {
     // Guarda o início do termo no input, para possíveis mensagens de erro.
     begin_token();
     // Vamos tokenizar o inteiro, se ele for bem formado.
-    if ( integer() ) {
-        // Copiar a substring correspondente para uma variável string.
-        std::string token = complete_token();
-        // Tentar realizar a conversão de string para inteiro (usar stoll()).
-        input_int_type token_value;
+    if ( not integer() )
+        return false;
+    // Copiar a substring correspondente para uma variável string.
+    std::string token = complete_token();
+    // Tentar realizar a conversão de string para inteiro (usar stoll()).
+    input_int_type token_value;
+    try {
         token_value = stoll( token );
-
-        // Recebemos um inteiro válido, resta saber se está dentro da faixa.
-        if ( token_value < std::numeric_limits< required_int_type >::min() or
-             token_value > std::numeric_limits< required_int_type >::max() ) {
-            // Fora da faixa, reportar erro.
-            m_result = ResultType{ ResultType::INTEGER_OUT_OF_RANGE, token_location() };
-                               // std::distance( m_expr.begin(), begin_token ) );
-        }
-        else {
-            // Coloca o novo token na nossa lista de tokens.
-            m_tk_list.emplace_back( Token{ token, Token::token_t::OPERAND } );
-        }
     }
-    // Check if it starts with a "(".
-    else if ( accept( Parser::terminal_symbol_t::TS_OPEN_PARENTHESES ) ) {
-        // Add a "(" to token list.
-        m_tk_list.emplace_back( Token{ "(", Token::token_t::OPEN_PARENTHESES } );
-        // Go to the next symbol and store the beginning of the term.
-        skip_ws();
-        begin_token();
-        // Check if it is a expression.
-        if ( expression() ) {
-            // Go to the next symbol and store the beginning of the term.
-            skip_ws();
-            begin_token();
-            // And check if close the parentheses.
-            if ( accept( Parser::terminal_symbol_t::TS_CLOSE_PARENTHESES ) ) {
-                m_tk_list.emplace_back( Token{ ")", Token::token_t::CLOSE_PARENTHESES } );
-            }
-            // After an expression beginning with "(" we expect a ")" at end.
-            else {
-                m_result = ResultType{ ResultType::MISSING_CLOSING, token_location() };
-            }
-        }
-        // After a "(" we expect a valid expression, otherwise we have a missing expression.
-        else {
-            m_result = ResultType{ ResultType::ILL_FORMED_INTEGER, token_location() };
-        }
+    catch ( const std::out_of_range & ) {
+        // Too many digits even for the input type: clearly out of range.
+        token_value = std::numeric_limits< input_int_type >::max();
     }
-    else {
-        // Create the corresponding error.
-        m_result =  ResultType{ ResultType::ILL_FORMED_INTEGER, std::distance( m_expr.begin(), m_it_curr_symb ) } ;
+
+    // Recebemos um inteiro válido, resta saber se está dentro da faixa.
+    if ( token_value < std::numeric_limits< required_int_type >::min() or
+         token_value > std::numeric_limits< required_int_type >::max() ) {
+        // Fora da faixa, reportar erro.
+        m_result = ResultType{ ResultType::INTEGER_OUT_OF_RANGE, token_location() };
+        return false;
+    }
+    // Coloca o novo token na nossa lista de tokens.
+    if ( m_tokenize ) {
+        m_tokens.push( Token::token_t::OPERAND, token_value, static_cast< std::size_t >( token_location() ) );
+        count_operand();
     }
-    return m_result.type == ResultType::OK;
+    return true;
 }
 
 /// Validates (i.e. returns true or false) and consumes an **integer** from the input expression string.
@@ -290,7 +379,16 @@ Parser::ResultType Parser::parse_and_tokenize( std::string e_ ) {
     m_result = ResultType{ ResultType::OK }; // Ok, by default,
 
     // We alway clean up the token from (possible) previous processing.
-    m_tk_list.clear();
+    m_tokens.clear();
+    m_pending.clear();
+    m_operands = m_max_pending = m_max_operands = 0;
+
+    // Unbalanced parentheses always end in an error (whose column only the parsing
+    // can tell): there is no need to build the tokens of such a line.
+    m_parens.build( m_expr );
+    m_tokenize = m_parens.balanced();
+    // A nesting level has at most a "(" and an operator of each precedence pending.
+    m_pending.reserve( 4 * std::min( m_parens.max_depth(), m_max_depth ) + 3 );
 
     // Let us ignore any leading white spaces.
     skip_ws();
@@ -336,7 +434,20 @@ Parser::ResultType::size_type Parser::token_location(void) {
  */
 sc::vector< Token >
 Parser::get_tokens( void ) const {
-    return m_tk_list;
+    sc::vector< Token > list;
+    list.reserve( m_tokens.size() );
+    for ( std::size_t i {0}; i < m_tokens.size(); i++ )
+        list.push_back( m_tokens.token( i ) );
+    return list;
+}
+
+/**
+ * Builds the syntax tree of the last expression from its tokens.
+ * The expression must have been parsed successfuly.
+ */
+void
+Parser::build_ast( Ast & ast, bool share ) const {
+    ast.build( m_tokens, share );
 }
 
 //==========================[ End of parse.cpp ]==========================//
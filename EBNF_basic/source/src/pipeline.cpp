@@ -0,0 +1,161 @@
+#include <thread>    // std::thread
+#include <vector>    // std::vector
+#include <algorithm> // std::max
+#include <limits>    // std::numeric_limits
+
+#include "../include/pipeline.h"
+#include "../include/line_scanner.h"
+#include "../include/columns.h"
+
+namespace {
+    /// The smallest power of two not less than n.
+    std::size_t ceil_pow2( std::size_t n ) {
+        std::size_t p {1};
+        while ( p < n ) p <<= 1;
+        return p;
+    }
+}
+
+/// Creates a pipeline with its pool of blocks (the threads only run inside run()).
+Pipeline::Pipeline( std::size_t evaluators, std::size_t max_depth, BaresManager::Format format, std::size_t block_size )
+    : m_n_evaluators { evaluators > 0 ? evaluators : std::max( 1u, std::thread::hardware_concurrency() ) },
+      m_max_depth { max_depth },
+      m_format { format },
+      m_block_size { std::max< std::size_t >( block_size, 1 ) },
+      // Enough blocks to keep every evaluator busy while others are being read and written.
+      m_n_blocks { ceil_pow2( 2 * m_n_evaluators + 4 ) },
+      m_blocks { new Block[m_n_blocks] },
+      m_free { m_n_blocks },
+      m_work { m_n_blocks },
+      m_done { m_n_blocks },
+      m_total { std::numeric_limits< std::size_t >::max() },
+      m_base { 0 },
+      m_spare { nullptr },
+      m_parts { 0 } {
+    for ( std::size_t i {0}; i < m_n_blocks; i++ )
+        m_free.push( &m_blocks[i] );
+}
+
+/// The reader stage: splits the input in blocks of whole lines.
+void Pipeline::read( AsyncInput & in ) {
+    std::string carry; // The beginning of a line that did not fit in the previous block.
+    std::size_t n {0}; // Blocks read.
+    bool eof { false };
+    while ( not eof ) {
+        // Waits here while all blocks are in use.
+        Block * block = m_spare != nullptr ? m_spare : m_free.pop();
+        m_spare = nullptr;
+        block->seq = m_base + n;
+        block->text.swap( carry );
+        carry.clear();
+        // Read until the block is big enough and has at least one whole line, or the input is over.
+        for ( ;; ) {
+            auto chunk = in.next_chunk();
+            if ( chunk.empty() ) {
+                eof = true;
+                break;
+            }
+            block->text.append( chunk.data(), chunk.size() );
+            if ( block->text.size() < m_block_size ) continue;
+            auto brk = block->text.rfind( '\n' );
+            if ( brk != std::string::npos ) {
+                // Keep the unfinished line for the next block.
+                carry.assign( block->text, brk + 1, std::string::npos );
+                block->text.resize( brk + 1 );
+                break;
+            }
+        }
+        if ( block->text.empty() ) {
+            // Nothing left to read. Only the writer gives blocks back to the free ring,
+            // so the reader keeps this one for the next run.
+            m_spare = block;
+            break;
+        }
+        m_work.push( block );
+        n++;
+    }
+    m_total.store( n, std::memory_order_release );
+    // One empty pointer per evaluator tells them to stop.
+    for ( std::size_t i {0}; i < m_n_evaluators; i++ )
+        m_work.push( nullptr );
+}
+
+/// The evaluator stage: computes every line of the blocks it gets.
+void Pipeline::evaluate( void ) {
+    BaresManager bm { m_max_depth };
+    Aggregate totals { m_parts };
+    ColumnWriter writer;
+    const bool binary { m_parts == 0 and m_format == BaresManager::Format::BINARY };
+    std::string text;
+    for ( ;; ) {
+        Block * block = m_work.pop();
+        if ( block == nullptr ) break;
+        block->out.clear();
+        LineScanner scanner { block->text };
+        LineScanner::Line line;
+        while ( scanner.next( line ) ) {
+            text.assign( line.text );
+            if ( m_parts != 0 )
+                totals.add( bm.evaluate( text, line.invalid ) );
+            else if ( binary )
+                writer.add( bm.evaluate( text, line.invalid ) );
+            else
+                BaresManager::append_result( bm.evaluate( text, line.invalid ), block->out, m_format, text );
+        }
+        // Each block of the input becomes a block of columns.
+        if ( binary ) writer.append_block( block->out );
+        m_done.publish( block->seq, block );
+    }
+    if ( m_parts != 0 ) {
+        std::lock_guard< std::mutex > guard { m_totals_lock };
+        m_totals.merge( totals );
+    }
+}
+
+/// Evaluates every line of the input, writing the results in order.
+void Pipeline::run( AsyncInput & in, AsyncOutput & out ) {
+    m_parts = 0;
+    drive( in, &out );
+}
+
+/// Evaluates every line of the input and merges what each evaluator folded.
+Aggregate Pipeline::aggregate( AsyncInput & in, unsigned parts ) {
+    m_parts = parts;
+    m_totals = Aggregate{ parts };
+    drive( in, nullptr );
+    m_parts = 0;
+    return m_totals;
+}
+
+/// Runs the reader and the evaluators, and the writer on the calling thread (which writes to `out`, if any).
+void Pipeline::drive( AsyncInput & in, AsyncOutput * out ) {
+    m_total.store( std::numeric_limits< std::size_t >::max(), std::memory_order_relaxed );
+
+    std::thread reader { &Pipeline::read, this, std::ref( in ) };
+    std::vector< std::thread > evaluators;
+    for ( std::size_t i {0}; i < m_n_evaluators; i++ )
+        evaluators.emplace_back( &Pipeline::evaluate, this );
+
+    // The writer stage: blocks come back in input order.
+    if ( out != nullptr and m_parts == 0 and m_format == BaresManager::Format::BINARY ) {
+        std::string header;
+        ColumnWriter::append_header( header );
+        out->write( header );
+    }
+    Block * block;
+    for ( std::size_t n {0}; n < m_total.load( std::memory_order_acquire ); ) {
+        if ( not m_done.try_consume( m_base + n, block ) ) {
+            std::this_thread::yield();
+            continue;
+        }
+        if ( out != nullptr ) out->write( block->out );
+        m_free.push( block );
+        n++;
+    }
+    if ( out != nullptr ) out->flush();
+
+    reader.join();
+    for ( auto & t : evaluators ) t.join();
+    // The slots of m_done wait for the sequences after this run's: the next run starts from there.
+    m_base += m_total.load( std::memory_order_relaxed );
+}
@@ -0,0 +1,150 @@
+#include <limits>  // std::numeric_limits
+#include <map>     // std::map
+#include <memory>  // std::unique_ptr
+
+#include "../include/program.h"
+#include "../include/arithmetic.h"
+
+/// Compiles a list of tokens in postfix order.
+Program Program::compile( const TokenBuffer & postfix ) {
+    Program program;
+    program.m_code.reserve( postfix.size() );
+    for ( std::size_t i {0}; i < postfix.size(); i++ ) {
+        if ( postfix.kind( i ) == Token::token_t::OPERAND ) {
+            // The parser only lets through operands that fit the required type.
+            program.m_code.push_back( Instr{ Instr::op_t::PUSH, 0, static_cast< std::int32_t >( postfix.value( i ) ) } );
+            continue;
+        }
+        auto op = static_cast< Instr::op_t >( postfix.symbol( i ) );
+        // In postfix order, a literal divisor is the instruction just before the operator.
+        if ( ( op == Instr::op_t::DIV or op == Instr::op_t::MOD ) and program.m_diagnostic.type == Parser::ResultType::OK and
+             program.m_code.back().op == Instr::op_t::PUSH and program.m_code.back().arg == 0 )
+            program.m_diagnostic = Parser::ResultType{ Parser::ResultType::DIVISION_BY_ZERO,
+                                                       static_cast< Parser::ResultType::size_type >( postfix.col( i ) ) };
+        program.m_code.push_back( Instr{ op, 0, 0 } );
+    }
+    program.peephole();
+
+    std::size_t depth {0};
+    for ( std::size_t i {0}; i < program.m_code.size(); i++ ) {
+        const Instr & in = program.m_code[i];
+        if ( in.op == Instr::op_t::PUSH ) {
+            if ( ++depth > program.m_max_depth ) program.m_max_depth = depth;
+        }
+        else if ( not in.in_place() )
+            depth--;
+    }
+    return program;
+}
+
+/// Fuses each PUSH with the binary operator right after it into one superinstruction.
+void Program::peephole( void ) {
+    std::map< std::int32_t, std::uint16_t > known; // Index of each divisor in m_divisors.
+    std::size_t out {0};
+    for ( std::size_t i {0}; i < m_code.size(); i++ ) {
+        Instr in = m_code[i];
+        if ( in.op != Instr::op_t::PUSH or i + 1 == m_code.size() ) {
+            m_code[out++] = in;
+            continue;
+        }
+        switch ( m_code[i + 1].op ) {
+            case Instr::op_t::ADD: in.op = Instr::op_t::ADD_CONST; break;
+            case Instr::op_t::SUB: in.op = Instr::op_t::SUB_CONST; break;
+            case Instr::op_t::MUL: in.op = Instr::op_t::MUL_CONST; break;
+            case Instr::op_t::POW: in.op = Instr::op_t::POW_CONST; break;
+            case Instr::op_t::DIV:
+            case Instr::op_t::MOD:
+                // Dividing by 0, 1 or -1 is left to apply_operator(), which knows their rules.
+                if ( in.arg == 0 or in.arg == 1 or in.arg == -1 ) break;
+                {
+                    auto found = known.find( in.arg );
+                    if ( found == known.end() ) {
+                        found = known.emplace( in.arg, static_cast< std::uint16_t >( m_divisors.size() ) ).first;
+                        m_divisors.push_back( bares::compute_magic( in.arg ) );
+                    }
+                    in.aux = found->second;
+                }
+                in.op = m_code[i + 1].op == Instr::op_t::DIV ? Instr::op_t::DIV_CONST : Instr::op_t::MOD_CONST;
+                break;
+            default:
+                break;
+        }
+        if ( in.op != Instr::op_t::PUSH ) i++; // The operator is now part of the superinstruction.
+        m_code[out++] = in;
+    }
+    while ( m_code.size() > out ) m_code.pop_back();
+}
+
+/// Runs the program, giving the same result as BaresManager::calculate().
+BaresManager::Result Program::run( void ) const {
+    return run( m_code.size() > 0 ? &m_code[0] : nullptr, m_code.size(),
+                m_divisors.size() > 0 ? &m_divisors[0] : nullptr, m_max_depth );
+}
+
+/// Runs instructions kept somewhere else.
+BaresManager::Result Program::run( const Instr * code, std::size_t size,
+                                   const bares::magic_divisor * divisors, std::size_t max_depth ) {
+    // Most expressions fit in a small stack on the native stack.
+    constexpr std::size_t LOCAL_DEPTH { 64 };
+    value_type local[LOCAL_DEPTH];
+    std::unique_ptr< value_type[] > heap;
+    value_type * st { local };
+    if ( max_depth > LOCAL_DEPTH ) {
+        heap.reset( new value_type[max_depth] );
+        st = heap.get();
+    }
+
+    BaresManager::Result res { Parser::ResultType{ Parser::ResultType::OK }, 0 };
+    // The value on top lives in a local (a register); `st` keeps the ones below it.
+    value_type tos {0};
+    value_type * below { st };
+    value_type result {0}; // The result of the last operation.
+    for ( std::size_t i {0}; i < size; i++ ) {
+        const Instr & in = code[i];
+        if ( in.op == Instr::op_t::PUSH ) {
+            *below++ = tos;
+            tos = in.arg;
+            continue;
+        }
+        // Short chains of tests instead of a switch: a switch becomes an indirect
+        // jump through a table, which the processor mispredicts all the time when
+        // many different programs run one after the other.
+        if ( in.in_place() ) {
+            if ( in.op == Instr::op_t::DIV_CONST or in.op == Instr::op_t::MOD_CONST ) {
+                value_type quotient = bares::divide_magic( tos, in.arg, divisors[in.aux] );
+                result = in.op == Instr::op_t::DIV_CONST ? quotient : tos - quotient * in.arg;
+            }
+            else if ( in.op == Instr::op_t::ADD_CONST )
+                bares::apply_operator( '+', tos, in.arg, result );
+            else if ( in.op == Instr::op_t::SUB_CONST )
+                bares::apply_operator( '-', tos, in.arg, result );
+            else if ( in.op == Instr::op_t::MUL_CONST )
+                bares::apply_operator( '*', tos, in.arg, result );
+            else
+                bares::apply_operator( '^', tos, in.arg, result );
+        }
+        else {
+            value_type lhs = *--below;
+            if ( in.op == Instr::op_t::ADD )
+                bares::apply_operator( '+', lhs, tos, result );
+            else if ( in.op == Instr::op_t::SUB )
+                bares::apply_operator( '-', lhs, tos, result );
+            else if ( in.op == Instr::op_t::MUL )
+                bares::apply_operator( '*', lhs, tos, result );
+            else if ( in.op == Instr::op_t::POW )
+                bares::apply_operator( '^', lhs, tos, result );
+            // On a division by zero the previous result takes the place of the operands.
+            else if ( not bares::apply_operator( in.op == Instr::op_t::DIV ? '/' : '%', lhs, tos, result ) )
+                res.status = Parser::ResultType{ Parser::ResultType::DIVISION_BY_ZERO };
+        }
+        tos = result;
+    }
+    result = tos;
+
+    if ( result < std::numeric_limits< Parser::required_int_type >::min() or
+         result > std::numeric_limits< Parser::required_int_type >::max() )
+        res.status = Parser::ResultType{ Parser::ResultType::OVERFLOW_ERROR };
+    else
+        res.value = static_cast< Parser::required_int_type >( result );
+    return res;
+}
@@ -0,0 +1,209 @@
+#include <algorithm>   // std::max
+#include <bit>         // std::endian
+#include <cerrno>      // errno
+#include <cstddef>     // offsetof
+#include <cstring>     // std::memcmp, std::strerror
+#include <stdexcept>   // std::runtime_error
+#include <string>      // std::to_string
+#include <sys/mman.h>  // mmap(), munmap()
+#include <sys/stat.h>  // fstat()
+
+#include "../include/program_bundle.h"
+
+namespace {
+    constexpr char MAGIC[8] = { 'B', 'A', 'R', 'E', 'S', 'B', 'D', 'L' }; //!< The first bytes of a bundle.
+    constexpr std::size_t HEADER_SIZE = 64; //!< Bytes of the header.
+    constexpr std::size_t ENTRY_SIZE = 32;  //!< Bytes of a directory entry.
+    constexpr std::size_t DIVISOR_SIZE = 16; //!< Bytes of a magic divisor in a program.
+    constexpr std::size_t INSTR_SIZE = 8;    //!< Bytes of an instruction.
+
+    // The programs run where they lie: the layout of the file must be the one in memory.
+    static_assert( sizeof( Instr ) == INSTR_SIZE and offsetof( Instr, aux ) == 2 and offsetof( Instr, arg ) == 4,
+                   "Instr must be laid out as in a bundle" );
+    static_assert( sizeof( bares::magic_divisor ) == DIVISOR_SIZE and offsetof( bares::magic_divisor, shift ) == 8,
+                   "magic_divisor must be laid out as in a bundle" );
+
+    /// Reports a bundle that cannot be used.
+    [[noreturn]] void fail( const std::string & what ) {
+        throw std::runtime_error( "Program bundle: " + what );
+    }
+
+    /// Appends an unsigned integer of `Bytes` bytes, little-endian.
+    template < std::size_t Bytes >
+    void put( std::uint64_t value, std::string & out ) {
+        for ( std::size_t b {0}; b < Bytes; b++ )
+            out += static_cast< char >( value >> ( 8 * b ) & 0xFF );
+    }
+
+    /// Appends zeros up to the next multiple of 8 bytes.
+    void pad( std::string & out ) {
+        out.resize( ( out.size() + 7 ) / 8 * 8, '\0' );
+    }
+
+    /// Whether a byte is one of the operations of Instr::op_t.
+    bool valid_op( unsigned op ) {
+        return op <= static_cast< unsigned >( Instr::op_t::POW_CONST ) or op == '+' or op == '-' or op == '*'
+               or op == '/' or op == '%' or op == '^';
+    }
+}
+
+/// Adds a valid expression, as compiled.
+std::size_t ProgramBundle::Writer::add( const Program & program ) {
+    const auto & code = program.code();
+    const auto & divisors = program.divisors();
+    m_entries.push_back( Entry{ program.diagnostic(), m_bodies.size(), static_cast< std::uint32_t >( code.size() ),
+                                static_cast< std::uint32_t >( divisors.size() ), program.max_depth() } );
+    for ( std::size_t d {0}; d < divisors.size(); d++ ) {
+        put< 8 >( static_cast< std::uint64_t >( divisors[d].multiplier ), m_bodies );
+        put< 4 >( divisors[d].shift, m_bodies );
+        put< 4 >( 0, m_bodies );
+    }
+    for ( std::size_t c {0}; c < code.size(); c++ ) {
+        put< 1 >( static_cast< std::uint8_t >( code[c].op ), m_bodies );
+        put< 1 >( 0, m_bodies );
+        put< 2 >( code[c].aux, m_bodies );
+        put< 4 >( static_cast< std::uint32_t >( code[c].arg ), m_bodies );
+    }
+    pad( m_bodies );
+    return m_entries.size() - 1;
+}
+
+/// Adds an expression that does not parse.
+std::size_t ProgramBundle::Writer::add( const Parser::ResultType & status ) {
+    m_entries.push_back( Entry{ status, ~std::uint64_t{0}, 0, 0, 0 } );
+    return m_entries.size() - 1;
+}
+
+/// Parses, compiles and adds an expression.
+std::size_t ProgramBundle::Writer::add( BaresManager & bm, const std::string & expr ) {
+    const Parser::ResultType status = bm.compile( expr, m_program );
+    // A literal zero divisor is only a diagnostic: the program runs like any other.
+    if ( status.type == Parser::ResultType::OK or status.type == Parser::ResultType::DIVISION_BY_ZERO )
+        return add( m_program );
+    return add( status );
+}
+
+/// Appends the bundle.
+void ProgramBundle::Writer::append_to( std::string & out ) const {
+    const std::size_t start { out.size() };
+    const std::uint64_t bodies { HEADER_SIZE + ENTRY_SIZE * m_entries.size() };
+    const std::uint64_t size { bodies + m_bodies.size() };
+    out.reserve( start + size );
+    out.append( MAGIC, sizeof( MAGIC ) );
+    put< 2 >( MAJOR, out );
+    put< 2 >( MINOR, out );
+    put< 4 >( 0, out );
+    put< 8 >( m_entries.size(), out );
+    put< 8 >( HEADER_SIZE, out );
+    put< 8 >( size, out );
+    for ( std::uint64_t t : m_tag ) put< 8 >( t, out );
+    for ( std::size_t i {0}; i < m_entries.size(); i++ ) {
+        const Entry & e = m_entries[i];
+        put< 4 >( e.status.type, out );
+        put< 4 >( e.status.at_col, out );
+        put< 8 >( e.body == ~std::uint64_t{0} ? 0 : bodies + e.body, out );
+        put< 4 >( e.size, out );
+        put< 4 >( e.divisors, out );
+        put< 8 >( e.depth, out );
+    }
+    out += m_bodies;
+}
+
+/// Maps a file that holds a bundle, and checks it.
+ProgramBundle::ProgramBundle( int fd, std::size_t offset )
+    : m_data{ nullptr }, m_bytes{ 0 }, m_count{ 0 }, m_dir{ nullptr }, m_map{ nullptr }, m_map_size{ 0 } {
+    struct stat st;
+    if ( fstat( fd, &st ) != 0 ) fail( std::strerror( errno ) );
+    m_map_size = static_cast< std::size_t >( st.st_size );
+    if ( not S_ISREG( st.st_mode ) or m_map_size < offset + HEADER_SIZE or offset % 8 != 0 ) fail( "no bundle there" );
+    m_map = mmap( nullptr, m_map_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+    if ( m_map == MAP_FAILED ) {
+        m_map = nullptr;
+        fail( std::strerror( errno ) );
+    }
+    m_data = static_cast< const unsigned char * >( m_map ) + offset;
+    try {
+        check( m_map_size - offset );
+    }
+    catch ( ... ) {
+        munmap( m_map, m_map_size );
+        throw;
+    }
+}
+
+/// Uses a bundle already in memory.
+ProgramBundle::ProgramBundle( const void * data, std::size_t size )
+    : m_data{ static_cast< const unsigned char * >( data ) }, m_bytes{ 0 }, m_count{ 0 }, m_dir{ nullptr },
+      m_map{ nullptr }, m_map_size{ 0 } {
+    if ( reinterpret_cast< std::uintptr_t >( data ) % 8 != 0 ) fail( "not aligned to 8 bytes" );
+    check( size );
+}
+
+/// Unmaps the file, if the bundle mapped one.
+ProgramBundle::~ProgramBundle() {
+    if ( m_map != nullptr ) munmap( m_map, m_map_size );
+}
+
+/// Checks the header, the directory and every program, so that running them is safe.
+void ProgramBundle::check( std::size_t available ) {
+    if constexpr ( std::endian::native != std::endian::little )
+        fail( "programs only run in place on little-endian machines" );
+    if ( available < HEADER_SIZE or std::memcmp( m_data, MAGIC, sizeof( MAGIC ) ) != 0 ) fail( "not a bundle" );
+    if ( load< 2 >( m_data + 8 ) != MAJOR ) fail( "version " + std::to_string( load< 2 >( m_data + 8 ) ) + " is not supported" );
+    const std::uint64_t count { load< 8 >( m_data + 16 ) }, dir { load< 8 >( m_data + 24 ) }, size { load< 8 >( m_data + 32 ) };
+    if ( size > available or size < HEADER_SIZE or dir < HEADER_SIZE or dir % 8 != 0 or dir > size
+         or count > ( size - dir ) / ENTRY_SIZE )
+        fail( "the directory does not fit" );
+    m_bytes = size;
+    m_count = count;
+    m_dir = m_data + dir;
+
+    for ( std::size_t i {0}; i < m_count; i++ ) {
+        const unsigned char * e { entry( i ) };
+        if ( load< 4 >( e ) > Parser::ResultType::NESTING_TOO_DEEP ) fail( "unknown status code" );
+        const std::uint64_t at { load< 8 >( e + 8 ) }, n { load< 4 >( e + 16 ) }, n_div { load< 4 >( e + 20 ) };
+        const std::uint64_t depth { load< 8 >( e + 24 ) };
+        if ( at == 0 ) continue;
+        if ( at % 8 != 0 or at < dir + ENTRY_SIZE * count or at > size
+             or ( n_div * DIVISOR_SIZE + n * INSTR_SIZE ) > size - at or n == 0 )
+            fail( "program " + std::to_string( i ) + " does not fit" );
+        const unsigned char * divisors { m_data + at };
+        for ( std::uint64_t d {0}; d < n_div; d++ )
+            if ( load< 4 >( divisors + DIVISOR_SIZE * d + 8 ) >= 64 ) fail( "bad divisor in program " + std::to_string( i ) );
+        // Every instruction must be known and find its operands, and the stack must stay within its depth.
+        const unsigned char * code { divisors + DIVISOR_SIZE * n_div };
+        std::uint64_t stack {0}, most {0};
+        for ( std::uint64_t k {0}; k < n; k++ ) {
+            const unsigned char * in { code + INSTR_SIZE * k };
+            const auto op = static_cast< Instr::op_t >( in[0] );
+            if ( not valid_op( in[0] ) ) fail( "bad instruction in program " + std::to_string( i ) );
+            if ( op == Instr::op_t::PUSH )
+                most = std::max( most, ++stack );
+            else if ( op == Instr::op_t::DIV_CONST or op == Instr::op_t::MOD_CONST ) {
+                if ( stack < 1 or load< 2 >( in + 2 ) >= n_div ) fail( "bad instruction in program " + std::to_string( i ) );
+            }
+            else if ( op <= Instr::op_t::POW_CONST ) {
+                if ( stack < 1 ) fail( "bad instruction in program " + std::to_string( i ) );
+            }
+            else if ( stack-- < 2 )
+                fail( "bad instruction in program " + std::to_string( i ) );
+        }
+        if ( stack != 1 or most > depth or depth > n ) fail( "bad stack in program " + std::to_string( i ) );
+    }
+}
+
+/// The status of the i-th expression.
+Parser::ResultType ProgramBundle::status( std::size_t i ) const {
+    return Parser::ResultType{ static_cast< Parser::ResultType::code_t >( load< 4 >( entry( i ) ) ),
+                               static_cast< Parser::ResultType::size_type >( load< 4 >( entry( i ) + 4 ) ) };
+}
+
+/// Runs the i-th expression where it lies.
+BaresManager::Result ProgramBundle::run( std::size_t i ) const {
+    const unsigned char * e { entry( i ) };
+    const std::uint64_t at { load< 8 >( e + 8 ) };
+    if ( at == 0 ) return BaresManager::Result{ status( i ), 0 };
+    const auto * divisors = reinterpret_cast< const bares::magic_divisor * >( m_data + at );
+    const auto * code = reinterpret_cast< const Instr * >( m_data + at + DIVISOR_SIZE * load< 4 >( e + 20 ) );
+    return Program::run( code, load< 4 >( e + 16 ), divisors, load< 8 >( e + 24 ) );
+}
@@ -0,0 +1,35 @@
+#include <string>     // std::string
+#include <sys/stat.h> // fstat()
+
+#include "../include/program_cache.h"
+
+/// Describes an input file.
+ProgramCache::Source ProgramCache::describe( int fd, std::size_t max_depth ) {
+    struct stat st;
+    if ( fstat( fd, &st ) != 0 or not S_ISREG( st.st_mode ) ) return Source{};
+    return Source{ static_cast< std::uint64_t >( st.st_size ),
+                   static_cast< std::uint64_t >( st.st_mtim.tv_sec ) * 1000000000u + static_cast< std::uint64_t >( st.st_mtim.tv_nsec ),
+                   max_depth };
+}
+
+/// Compiles every line and writes the cache.
+void ProgramCache::build( const sc::vector< LineScanner::Line > & lines, const Source & source,
+                          BaresManager & bm, AsyncOutput & out ) {
+    ProgramBundle::Writer writer;
+    writer.tag( source.size, source.mtime, source.max_depth );
+    std::string expr;
+    for ( std::size_t i {0}; i < lines.size(); i++ ) {
+        expr.assign( lines[i].text );
+        writer.add( bm, expr );
+    }
+    std::string bytes;
+    writer.append_to( bytes );
+    out.write( bytes );
+    out.flush();
+}
+
+/// Whether the cache was built from this input.
+bool ProgramCache::matches( const Source & source ) const {
+    return source.size != 0 and source.size == m_bundle.tag( 0 ) and source.mtime == m_bundle.tag( 1 )
+           and source.max_depth == m_bundle.tag( 2 );
+}
@@ -0,0 +1,225 @@
+#include <algorithm> // std::min
+
+#include "../include/scheduler.h"
+
+/// Creates a scheduler with its workers (the threads start with the first batch).
+WorkStealingScheduler::WorkStealingScheduler( std::size_t workers, std::size_t max_depth,
+                                              std::size_t grain, std::size_t window )
+    : m_n_workers { workers > 0 ? workers : std::max( 1u, std::thread::hardware_concurrency() ) },
+      m_workers { new Worker[m_n_workers] },
+      m_grain { std::max< std::size_t >( grain, 1 ) },
+      m_ring { window },
+      m_base { 0 },
+      m_lines { nullptr },
+      m_thieves { 0 },
+      m_folded { 0 },
+      m_aggregating { false },
+      m_done { false },
+      m_round { 0 },
+      m_busy { 0 },
+      m_quit { false } {
+    for ( std::size_t i {0}; i < m_n_workers; i++ ) {
+        m_workers[i].size.store( 0, std::memory_order_relaxed );
+        m_workers[i].manager = BaresManager{ max_depth };
+    }
+}
+
+/// Stops the worker threads, which are parked between batches.
+WorkStealingScheduler::~WorkStealingScheduler() {
+    {
+        std::lock_guard< std::mutex > guard { m_park_lock };
+        m_quit = true;
+    }
+    m_wake.notify_all();
+    for ( auto & t : m_threads ) t.join();
+}
+
+/// The life of a worker thread: it works on a batch each time it is woken, and parks in between.
+void WorkStealingScheduler::park( std::size_t id ) {
+    std::size_t seen {0}; // The last batch it worked on.
+    for ( ;; ) {
+        {
+            std::unique_lock< std::mutex > guard { m_park_lock };
+            m_wake.wait( guard, [&] { return m_quit or m_round != seen; } );
+            if ( m_quit ) return;
+            seen = m_round;
+        }
+        work( id );
+        std::lock_guard< std::mutex > guard { m_park_lock };
+        if ( --m_busy == 0 ) m_idle.notify_one();
+    }
+}
+
+/// Wakes the workers for a batch, starting them the first time.
+void WorkStealingScheduler::start( void ) {
+    m_done.store( false, std::memory_order_relaxed );
+    {
+        std::lock_guard< std::mutex > guard { m_park_lock };
+        m_busy = m_n_workers;
+        m_round++;
+    }
+    if ( m_threads.empty() )
+        for ( std::size_t id {0}; id < m_n_workers; id++ )
+            m_threads.emplace_back( &WorkStealingScheduler::park, this, id );
+    else
+        m_wake.notify_all();
+}
+
+/// Ends the batch and waits until every worker is parked, so that the next one finds them all waiting.
+void WorkStealingScheduler::finish( void ) {
+    m_done.store( true, std::memory_order_release );
+    std::unique_lock< std::mutex > guard { m_park_lock };
+    m_idle.wait( guard, [&] { return m_busy == 0; } );
+}
+
+/// Splits a text into lines, the same way std::getline() does.
+sc::vector< LineScanner::Line > WorkStealingScheduler::split_lines( const std::string & text ) {
+    sc::vector< LineScanner::Line > lines;
+    LineScanner scanner { text };
+    LineScanner::Line line;
+    while ( scanner.next( line ) )
+        lines.push_back( line );
+    return lines;
+}
+
+/// Pushes a range at the back of the deque of a worker.
+void WorkStealingScheduler::push( std::size_t id, LineRange range ) {
+    Worker & w = m_workers[id];
+    std::lock_guard< std::mutex > guard { w.lock };
+    w.tasks.push_back( range );
+    w.size.store( w.tasks.size(), std::memory_order_relaxed );
+}
+
+/// Takes the most recent range of the own deque (the smallest, with the lowest lines left).
+bool WorkStealingScheduler::pop( std::size_t id, LineRange & range ) {
+    Worker & w = m_workers[id];
+    if ( w.size.load( std::memory_order_relaxed ) == 0 ) return false;
+    std::lock_guard< std::mutex > guard { w.lock };
+    if ( w.tasks.empty() ) return false;
+    range = w.tasks.back();
+    w.tasks.pop_back();
+    w.size.store( w.tasks.size(), std::memory_order_relaxed );
+    return true;
+}
+
+/// Takes the oldest range (the biggest one) from the first other worker that has any.
+bool WorkStealingScheduler::steal( std::size_t id, LineRange & range ) {
+    for ( std::size_t k {1}; k < m_n_workers; k++ ) {
+        Worker & victim = m_workers[( id + k ) % m_n_workers];
+        if ( victim.size.load( std::memory_order_relaxed ) == 0 ) continue;
+        std::unique_lock< std::mutex > guard { victim.lock, std::try_to_lock };
+        if ( not guard.owns_lock() or victim.tasks.empty() ) continue;
+        range = victim.tasks.front();
+        victim.tasks.pop_front();
+        victim.size.store( victim.tasks.size(), std::memory_order_relaxed );
+        return true;
+    }
+    return false;
+}
+
+/// Evaluates a range of lines, splitting off its upper half whenever someone could use it.
+void WorkStealingScheduler::process( std::size_t id, LineRange range ) {
+    Worker & self = m_workers[id];
+    std::size_t folded {0};
+    while ( range.first < range.last ) {
+        // Adaptive splitting: only pay for a split if the work may be stolen.
+        if ( range.last - range.first > m_grain and
+             ( self.size.load( std::memory_order_relaxed ) == 0 or
+               m_thieves.load( std::memory_order_relaxed ) > 0 ) ) {
+            std::size_t mid = range.first + ( range.last - range.first ) / 2;
+            push( id, LineRange{ mid, range.last } );
+            range.last = mid;
+            continue;
+        }
+        const auto & line = (*m_lines)[range.first];
+        if ( m_aggregating ) {
+            self.totals.add( self.manager.evaluate( std::string{ line.text }, line.invalid ) );
+            folded++;
+        }
+        else
+            m_ring.publish( m_base + range.first, self.manager.evaluate( std::string{ line.text }, line.invalid ) );
+        range.first++;
+    }
+    // Nobody waits for folded results one by one: they are counted once per range.
+    if ( folded > 0 ) m_folded.fetch_add( folded, std::memory_order_release );
+}
+
+/// The loop of a worker thread: work on the own deque, otherwise try to steal.
+void WorkStealingScheduler::work( std::size_t id ) {
+    LineRange range;
+    bool hungry { false };
+    while ( not m_done.load( std::memory_order_acquire ) ) {
+        if ( pop( id, range ) or steal( id, range ) ) {
+            if ( hungry ) {
+                m_thieves.fetch_sub( 1, std::memory_order_relaxed );
+                hungry = false;
+            }
+            process( id, range );
+        }
+        else {
+            if ( not hungry ) {
+                m_thieves.fetch_add( 1, std::memory_order_relaxed );
+                hungry = true;
+            }
+            std::this_thread::yield();
+        }
+    }
+    if ( hungry ) m_thieves.fetch_sub( 1, std::memory_order_relaxed );
+}
+
+/// Evaluates all the lines and hands each result to the sink, in order.
+void WorkStealingScheduler::run( const sc::vector< LineScanner::Line > & lines, const sink_type & sink ) {
+    const std::size_t n_lines { lines.size() };
+    const std::size_t window { m_ring.capacity() };
+    m_lines = &lines;
+    start();
+
+    std::size_t admitted {0}; // Lines already handed to the workers.
+    std::size_t written {0};  // Lines already handed to the sink.
+    std::size_t next_worker {0};
+    BaresManager::Result res;
+    while ( written < n_lines ) {
+        // Hand out the lines that fit in the window, in big ranges that get split on demand.
+        std::size_t limit = std::min( n_lines, written + window );
+        if ( limit > admitted and ( limit - admitted >= window / 2 or limit == n_lines ) ) {
+            push( next_worker, LineRange{ admitted, limit } );
+            next_worker = ( next_worker + 1 ) % m_n_workers;
+            admitted = limit;
+        }
+        // Write everything that is ready, in order.
+        if ( m_ring.try_consume( m_base + written, res ) )
+            sink( written++, res );
+        else
+            std::this_thread::yield();
+    }
+
+    finish();
+    // The ring goes on where this run stopped, so run() may be called again.
+    m_base += n_lines;
+    m_lines = nullptr;
+}
+
+/// Evaluates all the lines, each worker folding its results, and merges what the workers folded.
+Aggregate WorkStealingScheduler::aggregate( const sc::vector< LineScanner::Line > & lines, unsigned parts ) {
+    m_lines = &lines;
+    m_aggregating = true;
+    m_folded.store( 0, std::memory_order_relaxed );
+    for ( std::size_t id {0}; id < m_n_workers; id++ )
+        m_workers[id].totals = Aggregate{ parts };
+    // No ring, so no window: every line is handed out at once, one range per worker.
+    const std::size_t n_lines { lines.size() };
+    for ( std::size_t id {0}; id < m_n_workers; id++ )
+        push( id, LineRange{ n_lines * id / m_n_workers, n_lines * ( id + 1 ) / m_n_workers } );
+
+    start();
+    while ( m_folded.load( std::memory_order_acquire ) < n_lines )
+        std::this_thread::yield();
+    finish();
+
+    Aggregate totals { parts };
+    for ( std::size_t id {0}; id < m_n_workers; id++ )
+        totals.merge( m_workers[id].totals );
+    m_aggregating = false;
+    m_lines = nullptr;
+    return totals;
+}
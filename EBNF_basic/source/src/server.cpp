@@ -0,0 +1,347 @@
+#include <algorithm>      // std::max
+#include <cerrno>         // errno
+#include <chrono>         // std::chrono::steady_clock
+#include <csignal>        // sigset_t, sigemptyset(), sigaddset()
+#include <cstring>        // std::memcpy, std::memmove, std::strerror
+#include <iostream>       // std::cerr
+#include <stdexcept>      // std::runtime_error
+#include <pthread.h>      // pthread_sigmask()
+#include <sys/epoll.h>    // epoll_create1(), epoll_ctl(), epoll_wait()
+#include <sys/signalfd.h> // signalfd()
+#include <sys/socket.h>   // socket(), bind(), listen(), accept4(), connect(), recv(), send()
+#include <sys/stat.h>     // lstat()
+#include <sys/un.h>       // sockaddr_un
+#include <unistd.h>       // close(), read(), unlink()
+
+#include "../include/server.h"
+#include "../include/wire.h"
+
+namespace {
+    /// Reports a system call that failed.
+    [[noreturn]] void fail( const char * what, int err ) {
+        throw std::runtime_error( std::string{ "Server: " } + what + ": " + std::strerror( err ) );
+    }
+
+    /// Nanoseconds of a monotonic clock.
+    std::uint64_t now_ns( void ) {
+        return static_cast< std::uint64_t >( std::chrono::duration_cast< std::chrono::nanoseconds >(
+            std::chrono::steady_clock::now().time_since_epoch() ).count() );
+    }
+
+    constexpr std::uint64_t LISTEN_TOKEN = static_cast< std::uint64_t >( -1 ); //!< The epoll data of the listening socket.
+    constexpr std::uint64_t SIGNAL_TOKEN = static_cast< std::uint64_t >( -2 ); //!< The epoll data of the signalfd.
+    constexpr std::size_t READ_CHUNK = 1u << 16;  //!< Free space made in the arena of a client before a read.
+    constexpr std::size_t READ_LIMIT = 1u << 20;  //!< Bytes read from a client in a round, so the others get their turn.
+    constexpr std::size_t KEEP_LIMIT = 1u << 22;  //!< Bigger buffers are freed with their connection.
+    constexpr int MAX_EVENTS = 64;                //!< Events taken by each epoll_wait().
+
+    /// Starts watching a file descriptor.
+    void watch( int epoll, int fd, std::uint32_t events, std::uint64_t token ) {
+        epoll_event ev {};
+        ev.events = events;
+        ev.data.u64 = token;
+        if ( epoll_ctl( epoll, EPOLL_CTL_ADD, fd, &ev ) != 0 ) fail( "epoll_ctl", errno );
+    }
+}
+
+/// Creates the socket and starts listening on it.
+EvalServer::EvalServer( std::string path, std::size_t threads, std::size_t max_depth, std::size_t parallel_batch )
+    : m_path { std::move( path ) },
+      m_parallel_batch { std::max< std::size_t >( parallel_batch, 1 ) },
+      m_bm { max_depth } {
+    if ( threads != 1 ) {
+        m_scheduler.reset( new WorkStealingScheduler{ threads, max_depth } );
+        if ( m_scheduler->workers() == 1 ) m_scheduler.reset();
+    }
+    sockaddr_un addr {};
+    addr.sun_family = AF_UNIX;
+    if ( m_path.empty() or m_path.size() >= sizeof( addr.sun_path ) )
+        throw std::runtime_error( "Server: the path of the socket must have from 1 to "
+                                  + std::to_string( sizeof( addr.sun_path ) - 1 ) + " bytes." );
+    std::memcpy( addr.sun_path, m_path.data(), m_path.size() );
+
+    // A socket nobody listens on is what a server that stopped left behind.
+    struct stat st;
+    if ( lstat( m_path.c_str(), &st ) == 0 and S_ISSOCK( st.st_mode ) ) {
+        int probe = socket( AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0 );
+        const bool alive { probe >= 0 and connect( probe, reinterpret_cast< sockaddr * >( &addr ), sizeof( addr ) ) == 0 };
+        if ( probe >= 0 ) close( probe );
+        if ( alive ) throw std::runtime_error( "Server: another server listens on \"" + m_path + "\"." );
+        unlink( m_path.c_str() );
+    }
+
+    int fd = socket( AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0 );
+    if ( fd < 0 ) fail( "socket", errno );
+    if ( bind( fd, reinterpret_cast< sockaddr * >( &addr ), sizeof( addr ) ) != 0 ) {
+        const int err { errno };
+        close( fd );
+        fail( m_path.c_str(), err );
+    }
+    m_listen = fd; // From here on the socket file is ours to remove.
+    try {
+        if ( listen( m_listen, SOMAXCONN ) != 0 ) fail( "listen", errno );
+        m_epoll = epoll_create1( EPOLL_CLOEXEC );
+        if ( m_epoll < 0 ) fail( "epoll_create1", errno );
+        watch( m_epoll, m_listen, EPOLLIN, LISTEN_TOKEN );
+    }
+    catch ( ... ) {
+        release();
+        throw;
+    }
+}
+
+/// Closes every connection and removes the socket.
+EvalServer::~EvalServer() {
+    release();
+}
+
+/// Closes what is open and removes the socket.
+void EvalServer::release( void ) {
+    for ( auto & conn : m_conns )
+        if ( conn->fd >= 0 ) {
+            close( conn->fd );
+            conn->fd = -1;
+        }
+    if ( m_epoll >= 0 ) close( m_epoll );
+    if ( m_listen >= 0 ) {
+        close( m_listen );
+        unlink( m_path.c_str() );
+    }
+    m_epoll = m_listen = -1;
+}
+
+/// Serves the clients until SIGINT or SIGTERM.
+void EvalServer::run( void ) {
+    // The signals are taken as events of the loop (the threads of the scheduler inherit the mask).
+    sigset_t stop_signals, old_mask;
+    sigemptyset( &stop_signals );
+    sigaddset( &stop_signals, SIGINT );
+    sigaddset( &stop_signals, SIGTERM );
+    pthread_sigmask( SIG_BLOCK, &stop_signals, &old_mask );
+    m_signals = signalfd( -1, &stop_signals, SFD_NONBLOCK | SFD_CLOEXEC );
+    if ( m_signals < 0 ) {
+        pthread_sigmask( SIG_SETMASK, &old_mask, nullptr );
+        fail( "signalfd", errno );
+    }
+    watch( m_epoll, m_signals, EPOLLIN, SIGNAL_TOKEN );
+
+    epoll_event events[MAX_EVENTS];
+    bool stop { false };
+    while ( not stop ) {
+        const int n = epoll_wait( m_epoll, events, MAX_EVENTS, -1 );
+        if ( n < 0 ) {
+            if ( errno == EINTR ) continue;
+            fail( "epoll_wait", errno );
+        }
+        const std::uint64_t now { now_ns() };
+        for ( int i {0}; i < n; i++ ) {
+            const std::uint64_t token { events[i].data.u64 };
+            if ( token == LISTEN_TOKEN )
+                accept_all();
+            else if ( token == SIGNAL_TOKEN ) {
+                // Taken, so it is not delivered again once unblocked.
+                signalfd_siginfo info;
+                stop = read( m_signals, &info, sizeof( info ) ) == static_cast< ssize_t >( sizeof( info ) );
+            }
+            else {
+                const std::size_t c { static_cast< std::size_t >( token ) };
+                if ( events[i].events & ( EPOLLIN | EPOLLHUP | EPOLLERR ) ) receive( c, now );
+                touch( c );
+            }
+        }
+        if ( not m_requests.empty() ) {
+            evaluate();
+            respond();
+        }
+        for ( std::size_t c : m_touched ) flush( c );
+        m_touched.clear();
+    }
+
+    epoll_ctl( m_epoll, EPOLL_CTL_DEL, m_signals, nullptr );
+    close( m_signals );
+    m_signals = -1;
+    pthread_sigmask( SIG_SETMASK, &old_mask, nullptr );
+    std::string summary;
+    m_latency.append_summary( summary );
+    std::cerr << "Server: " << summary << std::flush;
+}
+
+/// Accepts the clients that are waiting.
+void EvalServer::accept_all( void ) {
+    for ( ;; ) {
+        int fd = accept4( m_listen, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC );
+        if ( fd < 0 ) {
+            if ( errno == EINTR or errno == ECONNABORTED ) continue;
+            // Out of descriptors: the client waits in the backlog until one is closed.
+            if ( errno != EAGAIN and errno != EWOULDBLOCK ) std::cerr << "Server: accept: " << std::strerror( errno ) << ".\n";
+            return;
+        }
+        std::size_t c;
+        if ( m_free.empty() ) {
+            c = m_conns.size();
+            m_conns.emplace_back( new Connection );
+        }
+        else {
+            c = m_free.back();
+            m_free.pop_back();
+        }
+        // The buffers of the slot are kept, empty.
+        Connection & conn = *m_conns[c];
+        conn.fd = fd;
+        conn.filled = conn.framed = conn.sent = 0;
+        conn.out.clear();
+        conn.events = EPOLLIN;
+        conn.eof = conn.broken = conn.touched = false;
+        watch( m_epoll, fd, conn.events, c );
+    }
+}
+
+/// Reads a client and takes its whole requests.
+void EvalServer::receive( std::size_t c, std::uint64_t now ) {
+    Connection & conn = *m_conns[c];
+    if ( conn.eof or conn.broken ) return;
+    for ( std::size_t got {0}; got < READ_LIMIT; ) {
+        if ( conn.in.size() - conn.filled < READ_CHUNK )
+            conn.in.resize( std::max( 2 * conn.in.size(), conn.filled + READ_CHUNK ) );
+        const std::size_t room { conn.in.size() - conn.filled };
+        const ssize_t r = recv( conn.fd, conn.in.data() + conn.filled, room, 0 );
+        if ( r > 0 ) {
+            conn.filled += static_cast< std::size_t >( r );
+            got += static_cast< std::size_t >( r );
+            if ( static_cast< std::size_t >( r ) < room ) break; // Nothing else is waiting.
+            continue;
+        }
+        if ( r == 0 )
+            conn.eof = true;
+        else if ( errno == EINTR )
+            continue;
+        else if ( errno != EAGAIN and errno != EWOULDBLOCK )
+            conn.broken = true;
+        break;
+    }
+
+    // The expressions stay where they are: the lines of the batch point into the arena.
+    while ( conn.filled - conn.framed >= wire::LENGTH_SIZE ) {
+        const char * p { conn.in.data() + conn.framed };
+        const std::uint32_t n { static_cast< std::uint32_t >( wire::get< 4 >( p ) ) };
+        if ( n == wire::STATS ) {
+            m_requests.push_back( Request{ c, STATS, now } );
+            conn.framed += wire::LENGTH_SIZE;
+            continue;
+        }
+        if ( n > wire::MAX_REQUEST ) {
+            std::cerr << "Server: a client sent a request of " << n << " bytes, it is disconnected.\n";
+            conn.broken = true;
+            return;
+        }
+        if ( conn.filled - conn.framed - wire::LENGTH_SIZE < n ) break;
+        const std::string_view text { p + wire::LENGTH_SIZE, n };
+        std::size_t invalid { LineScanner::npos };
+        for ( std::size_t k {0}; k < n; k++ )
+            if ( not LineScanner::accepted( text[k] ) ) {
+                invalid = k;
+                break;
+            }
+        m_requests.push_back( Request{ c, m_lines.size(), now } );
+        m_lines.push_back( LineScanner::Line{ text, invalid } );
+        conn.framed += wire::LENGTH_SIZE + n;
+    }
+}
+
+/// Evaluates the lines of the batch.
+void EvalServer::evaluate( void ) {
+    const std::size_t n { m_lines.size() };
+    if ( n == 0 ) return;
+    m_results.resize( n );
+    if ( m_scheduler and n >= m_parallel_batch )
+        m_scheduler->run( m_lines, [this]( std::size_t i, const BaresManager::Result & res ) { m_results[i] = res; } );
+    else
+        for ( std::size_t i {0}; i < n; i++ ) {
+            m_expr.assign( m_lines[i].text );
+            m_results[i] = m_bm.evaluate( m_expr, m_lines[i].invalid );
+        }
+    m_batches++;
+}
+
+/// Appends the response of each request, in order of arrival (so in order for each client).
+void EvalServer::respond( void ) {
+    const std::uint64_t now { now_ns() };
+    std::string stats;
+    for ( const Request & r : m_requests ) {
+        Connection & conn = *m_conns[r.conn];
+        if ( r.line != STATS ) {
+            wire::append_result( m_results[r.line], conn.out );
+            m_latency.add( now - r.arrived );
+            continue;
+        }
+        stats.clear();
+        m_latency.append_summary( stats );
+        wire::put< 4 >( stats.size(), conn.out );
+        conn.out += stats;
+    }
+    m_requests.clear();
+    m_lines.clear();
+}
+
+/// Sends what a client may take, and watches it again.
+void EvalServer::flush( std::size_t c ) {
+    Connection & conn = *m_conns[c];
+    conn.touched = false;
+    // The requests are answered: only the start of the next one is kept, at the front.
+    if ( conn.framed > 0 ) {
+        std::memmove( conn.in.data(), conn.in.data() + conn.framed, conn.filled - conn.framed );
+        conn.filled -= conn.framed;
+        conn.framed = 0;
+    }
+    while ( not conn.broken and conn.sent < conn.out.size() ) {
+        const ssize_t w = send( conn.fd, conn.out.data() + conn.sent, conn.out.size() - conn.sent, MSG_NOSIGNAL );
+        if ( w >= 0 )
+            conn.sent += static_cast< std::size_t >( w );
+        else if ( errno == EINTR )
+            continue;
+        else {
+            if ( errno != EAGAIN and errno != EWOULDBLOCK ) conn.broken = true;
+            break;
+        }
+    }
+    if ( conn.sent == conn.out.size() ) {
+        conn.out.clear();
+        conn.sent = 0;
+    }
+    else if ( conn.sent >= conn.out.size() / 2 ) {
+        conn.out.erase( 0, conn.sent );
+        conn.sent = 0;
+    }
+    const std::size_t pending { conn.out.size() - conn.sent };
+    if ( conn.broken or ( conn.eof and pending == 0 ) ) {
+        close_conn( c );
+        return;
+    }
+    std::uint32_t events { pending > 0 ? static_cast< std::uint32_t >( EPOLLOUT ) : 0u };
+    if ( not conn.eof and pending < OUT_LIMIT ) events |= EPOLLIN;
+    if ( events != conn.events ) {
+        epoll_event ev {};
+        ev.events = events;
+        ev.data.u64 = c;
+        if ( epoll_ctl( m_epoll, EPOLL_CTL_MOD, conn.fd, &ev ) != 0 ) fail( "epoll_ctl", errno );
+        conn.events = events;
+    }
+}
+
+/// Adds a connection to m_touched.
+void EvalServer::touch( std::size_t c ) {
+    Connection & conn = *m_conns[c];
+    if ( conn.touched ) return;
+    conn.touched = true;
+    m_touched.push_back( c );
+}
+
+/// Closes a connection and frees its slot.
+void EvalServer::close_conn( std::size_t c ) {
+    Connection & conn = *m_conns[c];
+    close( conn.fd ); // Which also takes it out of the epoll set.
+    conn.fd = -1;
+    if ( conn.in.capacity() > KEEP_LIMIT ) conn.in = std::string{};
+    if ( conn.out.capacity() > KEEP_LIMIT ) conn.out = std::string{};
+    m_free.push_back( c );
+}
@@ -0,0 +1,414 @@
+#include <algorithm> // std::max, std::min, std::find
+#include <barrier>   // std::barrier
+#include <limits>    // std::numeric_limits
+#include <thread>    // std::thread
+
+#include "../include/sheet.h"
+#include "../include/arithmetic.h"   // bares::apply_operator()
+#include "../include/token_buffer.h" // class TokenBuffer
+
+namespace {
+    /// A level with fewer dirty definitions than this is computed by a single thread.
+    constexpr std::size_t GRAIN = 1024;
+
+    bool is_blank( char c ) { return c == ' ' or c == '\t' or c == '\r'; }
+    bool is_digit( char c ) { return c >= '0' and c <= '9'; }
+    bool starts_name( char c ) { return ( c >= 'a' and c <= 'z' ) or ( c >= 'A' and c <= 'Z' ) or c == '_'; }
+    bool in_name( char c ) { return starts_name( c ) or is_digit( c ); }
+}
+
+/// Creates an empty sheet.
+Sheet::Sheet( std::size_t threads, std::size_t max_depth )
+    : m_n_threads { threads > 0 ? threads : std::max( 1u, std::thread::hardware_concurrency() ) },
+      m_bm { max_depth } { /* empty */ }
+
+/// Splits a line of the form `name = expression`.
+bool Sheet::split_definition( std::string_view line, std::string_view & name, std::size_t & expr_at ) {
+    std::size_t i {0};
+    while ( i < line.size() and is_blank( line[i] ) ) i++;
+    if ( i == line.size() or not starts_name( line[i] ) ) return false;
+    std::size_t end { i + 1 };
+    while ( end < line.size() and in_name( line[end] ) ) end++;
+    name = line.substr( i, end - i );
+    while ( end < line.size() and is_blank( line[end] ) ) end++;
+    if ( end == line.size() or line[end] != '=' ) return false;
+    expr_at = end + 1;
+    return true;
+}
+
+/// The index of a name, or npos.
+std::size_t Sheet::find( std::string_view name ) const {
+    auto it = m_index.find( std::string{ name } );
+    return it == m_index.end() ? npos : it->second;
+}
+
+/// The index of a name, added if new.
+std::size_t Sheet::intern( std::string_view name ) {
+    auto [ it, added ] = m_index.emplace( std::string{ name }, m_nodes.size() );
+    if ( added ) {
+        m_nodes.emplace_back();
+        m_nodes.back().name = it->first;
+        if ( m_buckets.empty() ) m_buckets.resize( 1 );
+    }
+    return it->second;
+}
+
+/// Defines a name, or changes its definition.
+std::size_t Sheet::set( std::string_view name, std::string_view expr, std::size_t col ) {
+    const std::size_t n { intern( name ) };
+    // Each name becomes a "1" padded with blanks, so the columns stay where they were.
+    // A name right after a digit is left alone: the parser reports it as it would any letter there.
+    std::string text { expr };
+    std::vector< std::size_t > starts, uses;
+    for ( std::size_t i {0}; i < text.size(); ) {
+        if ( not starts_name( text[i] ) ) {
+            // Digits and names are scanned whole, so "x1" is a name and "1x" is a number and a letter.
+            const bool digits { is_digit( text[i] ) };
+            i++;
+            while ( digits and i < text.size() and in_name( text[i] ) ) i++;
+            continue;
+        }
+        std::size_t end { i + 1 };
+        while ( end < text.size() and in_name( text[end] ) ) end++;
+        starts.push_back( i );
+        uses.push_back( intern( std::string_view{ text }.substr( i, end - i ) ) );
+        text[i] = '1';
+        std::fill( text.begin() + i + 1, text.begin() + end, ' ' );
+        i = end;
+    }
+
+    Node & node = m_nodes[n];
+    std::vector< std::size_t > inputs, input_cols;
+    node.defined = true;
+    node.terms.clear();
+    node.depth = 0;
+    TokenBuffer postfix;
+    node.status = m_bm.to_postfix( text, postfix );
+    node.status.at_col += static_cast< Parser::ResultType::size_type >( col );
+    if ( node.status.type == Parser::ResultType::OK ) {
+        std::size_t depth {0};
+        for ( std::size_t t {0}; t < postfix.size(); t++ ) {
+            if ( postfix.kind( t ) != Token::token_t::OPERAND ) {
+                node.terms.push_back( Term{ 0, NO_INPUT, postfix.symbol( t ), false } );
+                depth--;
+                continue;
+            }
+            depth++;
+            node.depth = std::max( node.depth, depth );
+            // The operand starts at the name, or at the "-" right before it.
+            std::size_t at { postfix.col( t ) };
+            const bool negate { text[at] == '-' };
+            if ( negate ) at++;
+            auto s = std::lower_bound( starts.begin(), starts.end(), at );
+            if ( s == starts.end() or *s != at ) {
+                node.terms.push_back( Term{ postfix.value( t ), NO_INPUT, 0, false } );
+                continue;
+            }
+            const std::size_t m { uses[ s - starts.begin() ] };
+            auto k = std::find( inputs.begin(), inputs.end(), m );
+            if ( k == inputs.end() ) {
+                inputs.push_back( m );
+                input_cols.push_back( col + at );
+                k = inputs.end() - 1;
+            }
+            node.terms.push_back( Term{ 0, static_cast< std::uint32_t >( k - inputs.begin() ), 0, negate } );
+        }
+    }
+    // Only other names in use change the graph.
+    if ( inputs != node.inputs ) relink( n, std::move( inputs ) );
+    node.input_cols = std::move( input_cols );
+    if ( not node.dirty ) {
+        node.dirty = true;
+        m_dirty.push_back( n );
+    }
+    return n;
+}
+
+/// Changes the names a definition uses, moving the levels that depend on it.
+void Sheet::relink( std::size_t n, std::vector< std::size_t > inputs ) {
+    if ( not m_reshaped and not m_nodes[n].in_cycle ) {
+        for ( std::size_t m : m_nodes[n].inputs ) {
+            auto & outputs = m_nodes[m].outputs;
+            *std::find( outputs.begin(), outputs.end(), n ) = outputs.back();
+            outputs.pop_back();
+        }
+        for ( std::size_t m : inputs ) m_nodes[m].outputs.push_back( n );
+    }
+    m_nodes[n].inputs = std::move( inputs );
+    // Leaving a cycle may break it: only reshape() knows.
+    if ( m_reshaped or m_nodes[n].in_cycle ) {
+        m_reshaped = true;
+        return;
+    }
+    const auto & uses = m_nodes[n].inputs;
+    // Levels never drop along a path, so a name it uses that is also downstream of it
+    // (which makes a cycle) is found before the levels get higher than those it uses.
+    // Reaching a cycle, whose level moves with all of it, is left to reshape().
+    std::size_t top {0};
+    for ( std::size_t m : uses ) top = std::max( top, m_nodes[m].level );
+    std::vector< std::size_t > pending { n };
+    m_search++;
+    while ( not pending.empty() ) {
+        const std::size_t v { pending.back() };
+        pending.pop_back();
+        if ( std::find( uses.begin(), uses.end(), v ) != uses.end() or m_nodes[v].in_cycle or ++m_work > m_nodes.size() ) {
+            m_reshaped = true;
+            return;
+        }
+        for ( std::size_t w : m_nodes[v].outputs ) {
+            Node & out = m_nodes[w];
+            if ( out.level > top or out.seen == m_search ) continue;
+            out.seen = m_search;
+            pending.push_back( w );
+        }
+    }
+    // Now the levels downstream, as far as they move.
+    pending.push_back( n );
+    while ( not pending.empty() ) {
+        Node & node = m_nodes[ pending.back() ];
+        pending.pop_back();
+        std::size_t level {0};
+        for ( std::size_t m : node.inputs ) level = std::max( level, m_nodes[m].level + 1 );
+        if ( level == node.level ) continue;
+        if ( ++m_work > m_nodes.size() ) {
+            m_reshaped = true;
+            return;
+        }
+        node.level = level;
+        if ( level >= m_buckets.size() ) m_buckets.resize( level + 1 );
+        for ( std::size_t w : node.outputs ) {
+            if ( m_nodes[w].in_cycle ) {
+                m_reshaped = true;
+                return;
+            }
+            pending.push_back( w );
+        }
+    }
+}
+
+/// Finds the cycles and the levels again.
+void Sheet::reshape( void ) {
+    for ( Node & node : m_nodes ) node.outputs.clear();
+    for ( std::size_t n {0}; n < m_nodes.size(); n++ )
+        for ( std::size_t m : m_nodes[n].inputs ) m_nodes[m].outputs.push_back( n );
+
+    // Tarjan's algorithm, without recursion: a component is complete only after
+    // every component it uses, so the level of its inputs is already known.
+    constexpr std::size_t UNSEEN = npos;
+    std::vector< std::size_t > index( m_nodes.size(), UNSEEN ), low( m_nodes.size() ), component;
+    std::vector< bool > on_stack( m_nodes.size(), false );
+    std::vector< std::pair< std::size_t, std::size_t > > path; // A node and its next input to visit.
+    std::size_t counter {0}, top_level {0};
+    for ( std::size_t root {0}; root < m_nodes.size(); root++ ) {
+        if ( index[root] != UNSEEN ) continue;
+        path.emplace_back( root, 0 );
+        while ( not path.empty() ) {
+            auto & [ n, next ] = path.back();
+            if ( next == 0 ) {
+                index[n] = low[n] = counter++;
+                component.push_back( n );
+                on_stack[n] = true;
+            }
+            if ( next < m_nodes[n].inputs.size() ) {
+                const std::size_t m { m_nodes[n].inputs[next++] };
+                if ( index[m] == UNSEEN )
+                    path.emplace_back( m, 0 );
+                else if ( on_stack[m] )
+                    low[n] = std::min( low[n], index[m] );
+                continue;
+            }
+            const std::size_t done { n };
+            path.pop_back();
+            if ( not path.empty() ) low[ path.back().first ] = std::min( low[ path.back().first ], low[done] );
+            if ( low[done] != index[done] ) continue;
+            // `done` is the root of a component: pop it.
+            auto first = std::find( component.rbegin(), component.rend(), done ).base() - 1;
+            const bool cycle { component.end() - first > 1
+                               or std::find( m_nodes[done].inputs.begin(), m_nodes[done].inputs.end(), done )
+                                  != m_nodes[done].inputs.end() };
+            // The whole component takes one level, above every other it uses (its own
+            // nodes are the ones still on the stack), so levels never drop along an edge.
+            std::size_t level {0};
+            for ( auto c = first; c != component.end(); c++ )
+                for ( std::size_t m : m_nodes[*c].inputs )
+                    if ( not on_stack[m] ) level = std::max( level, m_nodes[m].level + 1 );
+            top_level = std::max( top_level, level );
+            for ( auto c = first; c != component.end(); c++ ) {
+                Node & node = m_nodes[*c];
+                on_stack[*c] = false;
+                node.level = level;
+                if ( node.in_cycle != cycle and not node.dirty ) {
+                    node.dirty = true;
+                    m_dirty.push_back( *c );
+                }
+                node.in_cycle = cycle;
+            }
+            component.erase( first, component.end() );
+        }
+    }
+    m_buckets.resize( m_nodes.empty() ? 0 : top_level + 1 );
+    m_reshaped = false;
+    m_work = 0;
+}
+
+/// Puts a node in the bucket of its level.
+void Sheet::schedule( std::size_t n ) {
+    Node & node = m_nodes[n];
+    if ( node.queued ) return;
+    node.queued = true;
+    m_buckets[node.level].push_back( n );
+}
+
+/// Computes one definition.
+void Sheet::compute( std::size_t n ) {
+    Node & node = m_nodes[n];
+    Cell cell;
+    if ( not node.defined )
+        cell.issue = Issue::UNDEFINED;
+    else if ( node.in_cycle )
+        cell.issue = Issue::CYCLE;
+    else if ( node.status.type != Parser::ResultType::OK ) {
+        cell.issue = Issue::NONE;
+        cell.result = BaresManager::Result{ node.status, 0 };
+    }
+    else {
+        cell.issue = Issue::NONE;
+        // The inputs are in the order of their first use: the leftmost one without a value is reported.
+        for ( std::size_t k {0}; k < node.inputs.size(); k++ ) {
+            const Node & input = m_nodes[ node.inputs[k] ];
+            if ( input.cell.has_value() ) continue;
+            cell.issue = input.defined ? Issue::NO_VALUE : Issue::UNDEFINED;
+            cell.at_col = node.input_cols[k];
+            cell.other = node.inputs[k];
+            break;
+        }
+        if ( cell.issue == Issue::NONE ) {
+            // As BaresManager::calculate(), with the names in place of their values.
+            thread_local std::vector< Parser::input_int_type > operands;
+            operands.resize( node.depth );
+            std::size_t size {0};
+            Parser::input_int_type result {0};
+            bool division_by_zero { false };
+            for ( const Term & term : node.terms ) {
+                if ( term.op == 0 ) {
+                    Parser::input_int_type value { term.value };
+                    if ( term.input != NO_INPUT ) {
+                        value = m_nodes[ node.inputs[term.input] ].cell.result.value;
+                        if ( term.negate ) value = -value;
+                    }
+                    operands[size++] = value;
+                    continue;
+                }
+                const Parser::input_int_type rhs { operands[--size] };
+                const Parser::input_int_type lhs { operands[--size] };
+                if ( not bares::apply_operator( term.op, lhs, rhs, result ) ) division_by_zero = true;
+                operands[size++] = result;
+            }
+            if ( size == 1 ) result = operands[0];
+            if ( result < std::numeric_limits< Parser::required_int_type >::min() or
+                 result > std::numeric_limits< Parser::required_int_type >::max() )
+                cell.result = BaresManager::Result{ Parser::ResultType{ Parser::ResultType::OVERFLOW_ERROR }, 0 };
+            else
+                cell.result = BaresManager::Result{ Parser::ResultType{ division_by_zero ? Parser::ResultType::DIVISION_BY_ZERO
+                                                                                        : Parser::ResultType::OK },
+                                                    static_cast< Parser::required_int_type >( result ) };
+        }
+    }
+    if ( not ( cell == node.cell ) ) {
+        node.cell = cell;
+        node.changed = m_round;
+    }
+}
+
+/// Computes what is dirty, level by level.
+std::size_t Sheet::recompute( void ) {
+    if ( m_reshaped ) reshape();
+    m_round++;
+    for ( std::size_t n : m_dirty ) schedule( n );
+    m_dirty.clear();
+
+    std::size_t level {0}, computed {0};
+    bool started { false };
+    // Moves on to the next level with work, after scheduling the users of what changed in this one.
+    auto next_level = [&]( void ) noexcept {
+        if ( started ) {
+            auto & bucket = m_buckets[level];
+            for ( std::size_t n : bucket ) {
+                Node & node = m_nodes[n];
+                node.queued = false;
+                if ( node.changed != m_round ) continue;
+                // A cycle does not use its inputs.
+                for ( std::size_t m : node.outputs )
+                    if ( not m_nodes[m].in_cycle ) schedule( m );
+            }
+            computed += bucket.size();
+            bucket.clear();
+            level++;
+        }
+        started = true;
+        while ( level < m_buckets.size() and m_buckets[level].empty() ) level++;
+    };
+    // Computes the share of thread `t` of `threads` of the current level.
+    auto work = [&]( std::size_t t, std::size_t threads ) {
+        const auto & bucket = m_buckets[level];
+        if ( bucket.size() < GRAIN ) threads = 1;
+        if ( t >= threads ) return;
+        const std::size_t first { bucket.size() * t / threads }, last { bucket.size() * ( t + 1 ) / threads };
+        for ( std::size_t i { first }; i < last; i++ ) {
+            compute( bucket[i] );
+            m_nodes[ bucket[i] ].dirty = false;
+        }
+    };
+
+    // Small changes stay on this thread; the others join at the first level with enough work.
+    next_level();
+    while ( level < m_buckets.size() and ( m_n_threads == 1 or m_buckets[level].size() < GRAIN ) ) {
+        work( 0, 1 );
+        next_level();
+    }
+    if ( level == m_buckets.size() ) return computed;
+    // The threads meet at the end of each level, where one of them finds the next.
+    std::barrier sync { static_cast< std::ptrdiff_t >( m_n_threads ), next_level };
+    auto run = [&]( std::size_t t ) {
+        while ( level < m_buckets.size() ) {
+            work( t, m_n_threads );
+            sync.arrive_and_wait();
+        }
+    };
+    std::vector< std::thread > helpers;
+    for ( std::size_t t {1}; t < m_n_threads; t++ ) helpers.emplace_back( run, t );
+    run( 0 );
+    for ( auto & h : helpers ) h.join();
+    return computed;
+}
+
+/// Appends the line that shows a definition.
+void Sheet::append_cell( std::size_t i, std::string & out ) const {
+    const Node & node = m_nodes[i];
+    out += node.name;
+    if ( node.cell.has_value() ) {
+        out += " = ";
+        out += std::to_string( node.cell.result.value );
+        out += '\n';
+        return;
+    }
+    out += ": ";
+    switch ( node.cell.issue ) {
+        case Issue::NONE:
+            BaresManager::append_result( node.cell.result, out );
+            return;
+        case Issue::UNDEFINED:
+            out += node.defined ? "Undefined name \"" + m_nodes[node.cell.other].name + "\" at column ("
+                                      + std::to_string( node.cell.at_col + 1 ) + ")!"
+                                : "Undefined name!";
+            break;
+        case Issue::CYCLE:
+            out += "Circular definition!";
+            break;
+        case Issue::NO_VALUE:
+            out += "Name \"" + m_nodes[node.cell.other].name + "\" at column (" + std::to_string( node.cell.at_col + 1 )
+                   + ") has no value!";
+            break;
+    }
+    out += '\n';
+}
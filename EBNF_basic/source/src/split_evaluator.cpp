@@ -0,0 +1,105 @@
+#include <algorithm> // std::max
+#include <limits>    // std::numeric_limits
+#include <thread>    // std::thread
+#include <vector>    // std::vector
+
+#include "../include/split_evaluator.h"
+
+namespace {
+    /// Tells whether Parser::skip_ws() skips a byte.
+    bool is_space( char c ) {
+        return c == ' ' or ( c >= '\t' and c <= '\r' );
+    }
+}
+
+/// Creates an evaluator.
+SplitEvaluator::SplitEvaluator( std::size_t threads, std::size_t max_depth, std::size_t min_length )
+    : m_n_threads { threads > 0 ? threads : std::max( 1u, std::thread::hardware_concurrency() ) },
+      m_max_depth { max_depth },
+      m_min_length { min_length },
+      m_manager { max_depth } {
+}
+
+/// Picks up to one operator per thread to cut the line before, about evenly spaced.
+/*!
+ * Only a "+" or a "-" outside every parenthesis and right after a term (a digit
+ * or a ")") will do: anywhere else a "-" is the sign of a number. The walk
+ * jumps from each "(" to its partner, so it only reads the outermost level.
+ */
+void SplitEvaluator::find_cuts( const std::string & expr ) {
+    m_cuts.clear();
+    if ( m_n_threads < 2 or expr.size() < m_min_length ) return;
+    m_parens.build( expr );
+    // Unbalanced parentheses: the line is not valid, nothing to gain.
+    if ( not m_parens.balanced() ) return;
+    m_parens.match( expr );
+
+    std::size_t target { expr.size() / m_n_threads };
+    std::size_t k {0};  // The next parenthesis of the index.
+    char last {0};      // The last byte of the outermost level that is not white space.
+    for ( std::size_t i {0}; i < expr.size() and m_cuts.size() + 1 < m_n_threads; i++ ) {
+        const char c { expr[i] };
+        if ( c == '(' ) {
+            // Everything up to the matching ")" is one term.
+            k = m_parens.partner( k );
+            i = m_parens.position( k++ );
+            last = ')';
+            continue;
+        }
+        if ( ( c == '+' or c == '-' ) and i >= target and ( ( last >= '0' and last <= '9' ) or last == ')' ) ) {
+            m_cuts.push_back( i );
+            target = ( m_cuts.size() + 1 ) * ( expr.size() / m_n_threads );
+        }
+        if ( not is_space( c ) ) last = c;
+    }
+}
+
+/// Parse and compute an expression, in pieces if it is long enough.
+BaresManager::Result SplitEvaluator::evaluate( const std::string & expr ) {
+    find_cuts( expr );
+    if ( m_cuts.empty() ) return m_manager.evaluate( expr );
+
+    // Piece 0 is the beginning of the line; the others start with their operator.
+    const std::size_t n_pieces { m_cuts.size() + 1 };
+    std::vector< BaresManager::Piece > pieces( n_pieces );
+    auto compute = [&]( std::size_t j, BaresManager & manager ) {
+        if ( j == 0 )
+            pieces[j] = manager.evaluate_piece( expr.substr( 0, m_cuts[0] ) );
+        else {
+            std::size_t end = j < m_cuts.size() ? m_cuts[j] : expr.size();
+            pieces[j] = manager.evaluate_piece( "0" + expr.substr( m_cuts[j - 1], end - m_cuts[j - 1] ) );
+        }
+    };
+    std::vector< std::thread > threads;
+    for ( std::size_t j {1}; j < n_pieces; j++ )
+        threads.emplace_back( [&, j]() {
+            BaresManager manager { m_max_depth };
+            compute( j, manager );
+        } );
+    compute( 0, m_manager );
+    for ( auto & t : threads ) t.join();
+
+    // Sums wrap around, like every operation of the expression.
+    unsigned long long total {0};
+    bool division_by_zero { false };
+    for ( std::size_t j {0}; j < n_pieces; j++ ) {
+        const BaresManager::Piece & piece = pieces[j];
+        if ( piece.status.type == Parser::ResultType::DIVISION_BY_ZERO ) {
+            division_by_zero = true;
+            // The first piece has no operation before it; the others cannot tell which result it was.
+            if ( j > 0 and piece.borrowed ) return m_manager.evaluate( expr );
+        }
+        // Some piece is not valid: let the whole line tell where.
+        else if ( piece.status.type != Parser::ResultType::OK )
+            return m_manager.evaluate( expr );
+        total += static_cast< unsigned long long >( piece.value );
+    }
+
+    const auto value = static_cast< Parser::input_int_type >( total );
+    if ( value < std::numeric_limits< Parser::required_int_type >::min() or
+         value > std::numeric_limits< Parser::required_int_type >::max() )
+        return BaresManager::Result{ Parser::ResultType{ Parser::ResultType::OVERFLOW_ERROR }, 0 };
+    return BaresManager::Result{ Parser::ResultType{ division_by_zero ? Parser::ResultType::DIVISION_BY_ZERO
+                                                                      : Parser::ResultType::OK },
+                                 static_cast< Parser::required_int_type >( value ) };
+}
@@ -0,0 +1,248 @@
+#include <cctype> // std::isspace()
+#include <limits> // std::numeric_limits
+
+#include "../include/stream_parser.h"
+#include "../include/arithmetic.h"
+
+namespace {
+    /// Numbers are not read beyond this value: anything bigger is out of range anyway.
+    constexpr Parser::input_int_type NUMBER_CAP { 1000000 };
+
+    /// Tells whether a byte is one of the binary operators.
+    bool is_operator( char c ) {
+        return c == '+' or c == '-' or c == '*' or c == '/' or c == '%' or c == '^';
+    }
+}
+
+/// Creates a parser waiting for the first line.
+StreamParser::StreamParser( std::size_t max_depth ) : m_max_depth{ max_depth } {
+    reset();
+}
+
+/// Gets ready for a new line.
+void StreamParser::reset( void ) {
+    m_state = state_t::TERM;
+    m_col = 0;
+    m_begin = 0;
+    m_at_start = true;
+    m_after_op = false;
+    m_outer_after_op = false;
+    m_depth = 0;
+    m_negative = false;
+    m_number = 0;
+    m_result = Parser::ResultType{ Parser::ResultType::OK };
+    m_operators.clear();
+    m_operands.clear();
+    m_last = 0;
+    m_division_by_zero = false;
+}
+
+/// Records an error, turning it into the one Parser reports.
+/*!
+ * `level` is the nesting depth of the expression whose term failed. Inside
+ * parentheses, Parser replaces any error by an ill formed integer
+ * at the beginning of the last token; and a failed term after an operator is a
+ * missing term.
+ */
+void StreamParser::fail( code_t code, size_type col, std::size_t level ) {
+    bool after_op { m_after_op };
+    // Too deep nesting is reported as it is, at the offending "(".
+    if ( level > 0 and code != Parser::ResultType::NESTING_TOO_DEEP ) {
+        code = Parser::ResultType::ILL_FORMED_INTEGER;
+        col = m_begin;
+        after_op = m_outer_after_op;
+    }
+    if ( code == Parser::ResultType::ILL_FORMED_INTEGER and after_op )
+        code = Parser::ResultType::MISSING_TERM;
+    m_result = Parser::ResultType{ code, col };
+    m_state = state_t::FAILED;
+}
+
+/// Applies the operator on top of the stack to the two operands on top of the other one.
+void StreamParser::reduce( void ) {
+    char op = m_operators.pop();
+    Parser::input_int_type rhs = m_operands.pop();
+    Parser::input_int_type lhs = m_operands.pop();
+    // A division by zero keeps the previous result, as BaresManager::calculate() does.
+    if ( not bares::apply_operator( op, lhs, rhs, m_last ) )
+        m_division_by_zero = true;
+    m_operands.push( m_last );
+}
+
+/// Pushes an operator, applying first the pending ones of the same or higher precedence.
+void StreamParser::push_operator( char op ) {
+    while ( not m_operators.empty() and bares::precedence( op ) <= bares::precedence( m_operators.top() ) )
+        reduce();
+    m_operators.push( op );
+}
+
+/// Opens a nested expression, unless there are too many already.
+void StreamParser::open_parenthesis( void ) {
+    if ( m_depth >= m_max_depth ) {
+        fail( Parser::ResultType::NESTING_TOO_DEEP, m_col, m_depth );
+        return;
+    }
+    if ( m_depth == 0 ) m_outer_after_op = m_after_op;
+    m_depth++;
+    m_operators.push( '(' );
+    m_after_op = false;
+    m_state = state_t::TERM;
+}
+
+/// Applies everything back to the matching "(" and drops it.
+void StreamParser::close_parenthesis( void ) {
+    while ( m_operators.top() != '(' )
+        reduce();
+    m_operators.pop();
+}
+
+/// Pushes the number just read, unless it is out of range.
+bool StreamParser::end_number( void ) {
+    Parser::input_int_type value = m_negative ? -m_number : m_number;
+    if ( value < std::numeric_limits< Parser::required_int_type >::min() or
+         value > std::numeric_limits< Parser::required_int_type >::max() ) {
+        fail( Parser::ResultType::INTEGER_OUT_OF_RANGE, m_begin, m_depth );
+        return false;
+    }
+    m_operands.push( value );
+    m_state = state_t::AFTER;
+    return true;
+}
+
+/// Consumes one byte of a line.
+void StreamParser::step( char c ) {
+    switch ( m_state ) {
+        case state_t::TERM:
+            if ( std::isspace( c ) ) break;
+            m_at_start = false;
+            m_begin = m_col;
+            if ( c == '0' ) {
+                m_operands.push( 0 );
+                m_state = state_t::AFTER;
+            }
+            else if ( c >= '1' and c <= '9' ) {
+                m_negative = false;
+                m_number = c - '0';
+                m_state = state_t::NUMBER;
+            }
+            else if ( c == '-' )
+                m_state = state_t::MINUS;
+            else if ( c == '(' )
+                open_parenthesis();
+            else
+                fail( Parser::ResultType::ILL_FORMED_INTEGER, m_col, m_depth );
+            break;
+
+        case state_t::MINUS:
+            if ( c >= '1' and c <= '9' ) {
+                m_negative = true;
+                m_number = c - '0';
+                m_state = state_t::NUMBER;
+            }
+            else if ( c == '(' )
+                open_parenthesis(); // Like Parser, a "-" right before a "(" is dropped.
+            else
+                fail( Parser::ResultType::ILL_FORMED_INTEGER, m_col, m_depth );
+            break;
+
+        case state_t::NUMBER:
+            if ( c >= '0' and c <= '9' ) {
+                if ( m_number < NUMBER_CAP ) m_number = m_number * 10 + ( c - '0' );
+                break;
+            }
+            if ( not end_number() ) break;
+            [[fallthrough]];
+
+        case state_t::AFTER:
+            if ( std::isspace( c ) ) break;
+            if ( is_operator( c ) ) {
+                push_operator( c );
+                m_after_op = true;
+                m_state = state_t::TERM;
+            }
+            else if ( m_depth == 0 )
+                fail( Parser::ResultType::EXTRANEOUS_SYMBOL, m_col, 0 );
+            else {
+                m_begin = m_col;
+                if ( c == ')' ) {
+                    close_parenthesis();
+                    m_depth--;
+                }
+                else
+                    fail( Parser::ResultType::MISSING_CLOSING, m_col, m_depth - 1 );
+            }
+            break;
+
+        case state_t::FAILED:
+            break;
+    }
+    m_col++;
+}
+
+/// Finishes the current line and hands its result to the sink.
+void StreamParser::end_line( const sink_type & sink ) {
+    BaresManager::Result res { Parser::ResultType{ Parser::ResultType::OK }, 0 };
+    switch ( m_state ) {
+        case state_t::TERM:
+            m_begin = m_col;
+            if ( m_at_start )
+                fail( Parser::ResultType::UNEXPECTED_END_OF_EXPRESSION, m_col, 0 );
+            else
+                fail( Parser::ResultType::ILL_FORMED_INTEGER, m_col, m_depth );
+            break;
+        case state_t::MINUS:
+            fail( Parser::ResultType::ILL_FORMED_INTEGER, m_col, m_depth );
+            break;
+        case state_t::NUMBER:
+            if ( not end_number() ) break;
+            [[fallthrough]];
+        case state_t::AFTER:
+            if ( m_depth > 0 ) {
+                m_begin = m_col;
+                fail( Parser::ResultType::MISSING_CLOSING, m_col, m_depth - 1 );
+            }
+            break;
+        case state_t::FAILED:
+            break;
+    }
+
+    if ( m_state == state_t::FAILED )
+        res.status = m_result;
+    else {
+        while ( not m_operators.empty() )
+            reduce();
+        Parser::input_int_type value = m_operands.top();
+        if ( value < std::numeric_limits< Parser::required_int_type >::min() or
+             value > std::numeric_limits< Parser::required_int_type >::max() )
+            res.status = Parser::ResultType{ Parser::ResultType::OVERFLOW_ERROR };
+        else {
+            if ( m_division_by_zero )
+                res.status = Parser::ResultType{ Parser::ResultType::DIVISION_BY_ZERO };
+            res.value = static_cast< Parser::required_int_type >( value );
+        }
+    }
+    sink( res );
+    reset();
+}
+
+/// Parses the next piece of the input.
+void StreamParser::feed( std::string_view chunk, const sink_type & sink ) {
+    for ( std::size_t i {0}; i < chunk.size(); i++ ) {
+        if ( chunk[i] == '\n' )
+            end_line( sink );
+        else if ( m_state == state_t::FAILED ) {
+            // Nothing else in a failed line matters: jump to its line break.
+            auto brk = chunk.find( '\n', i );
+            if ( brk == std::string_view::npos ) brk = chunk.size();
+            m_col += static_cast< size_type >( brk - i );
+            i = brk - 1;
+        }
+        else
+            step( chunk[i] );
+    }
+}
+
+/// Ends the input: a last line without a line break still counts, an empty one does not.
+void StreamParser::finish( const sink_type & sink ) {
+    if ( m_col > 0 ) end_line( sink );
+}
@@ -0,0 +1,176 @@
+/**
+ * @file bench.cpp
+ * @brief Measures how long each evaluation engine takes on a corpus.
+ *
+ * Usage: bares_bench [corpus] [repetitions]
+ *
+ * Every valid line of the corpus (the standard input if no file is given) is
+ * compiled once, then evaluated `repetitions` times by each engine, and once
+ * more by a coroutine each, through the BatchEvaluator. The lines are then
+ * joined into a single expression, whose digits are changed one at a time by
+ * the IncrementalEvaluator.
+ */
+
+#include <algorithm> // std::min
+#include <chrono>   // std::chrono::steady_clock
+#include <coroutine> // std::suspend_never
+#include <exception> // std::terminate
+#include <fstream>  // std::ifstream
+#include <iomanip>  // std::setw
+#include <iostream> // std::cout
+#include <memory>   // std::unique_ptr
+#include <string>   // std::string, std::getline
+#include <vector>   // std::vector
+
+#include "../include/bares_manager.h"
+#include "../include/program.h"
+#include "../include/program_bundle.h"
+#include "../include/jit.h"
+#include "../include/ast.h"
+#include "../include/incremental_evaluator.h"
+#include "../include/async_evaluator.h"
+
+namespace {
+    /// Runs a function `reps` times over `n` items and reports the time per evaluation.
+    template < typename Eval >
+    void measure( const char * name, std::size_t n, std::size_t reps, Eval eval ) {
+        long long checksum {0};
+        auto start = std::chrono::steady_clock::now();
+        for ( std::size_t r {0}; r < reps; r++ )
+            for ( std::size_t i {0}; i < n; i++ ) {
+                BaresManager::Result res = eval( i );
+                checksum += res.status.type + res.value;
+            }
+        std::chrono::duration< double, std::nano > elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << std::left << std::setw( 10 ) << name << std::right << std::fixed << std::setprecision( 1 )
+                  << std::setw( 10 ) << elapsed.count() / static_cast< double >( n * reps ) << " ns/eval"
+                  << "   (checksum " << checksum << ")\n";
+    }
+
+    /// A coroutine that starts at once and that nobody waits for.
+    struct Detached {
+        struct promise_type {
+            Detached get_return_object( void ) { return {}; }
+            std::suspend_never initial_suspend( void ) noexcept { return {}; }
+            std::suspend_never final_suspend( void ) noexcept { return {}; }
+            void return_void( void ) { /* empty */ }
+            void unhandled_exception( void ) { std::terminate(); }
+        };
+    };
+
+    /// Awaits the result of an expression and adds it to the checksum.
+    Detached await_one( const std::string & expr, long long & checksum ) {
+        BaresManager::Result res = co_await bares::evaluate_async( expr );
+        checksum += res.status.type + res.value;
+    }
+}
+
+int main( int argc, char * argv[] ) {
+    std::ifstream file;
+    if ( argc > 1 ) {
+        file.open( argv[1] );
+        if ( not file ) {
+            std::cerr << "Cannot open \"" << argv[1] << "\".\n";
+            return EXIT_FAILURE;
+        }
+    }
+    std::istream & in = argc > 1 ? file : std::cin;
+    std::size_t reps = argc > 2 ? std::stoul( argv[2] ) : 10;
+
+    BaresManager bm;
+    std::vector< std::string > lines;
+    std::vector< Program > programs;
+    CodeArena arena; // Keeps the code of all programs together.
+    std::vector< std::unique_ptr< JitProgram > > jits;
+    std::vector< std::unique_ptr< Ast > > trees;
+    std::string line;
+    Program program;
+    while ( std::getline( in, line ) ) {
+        auto status = bm.compile( line, program ).type;
+        if ( status != Parser::ResultType::OK and status != Parser::ResultType::DIVISION_BY_ZERO ) continue;
+        lines.push_back( line );
+        programs.push_back( program );
+        jits.emplace_back( new JitProgram{ program, &arena } );
+        trees.emplace_back( new Ast );
+        bm.build_ast( line, *trees.back() );
+    }
+    if ( lines.empty() ) {
+        std::cerr << "No valid expression in the corpus.\n";
+        return EXIT_FAILURE;
+    }
+    std::cout << lines.size() << " expressions, " << reps << " repetitions"
+              << ( jits[0]->native() ? "" : ", no native code (the JIT uses the interpreter)" ) << ".\n";
+
+    // The reference evaluation parses every time, so it gets fewer repetitions.
+    measure( "evaluate", lines.size(), 1, [&]( std::size_t i ) { return bm.evaluate( lines[i] ); } );
+    {
+        // One coroutine per line, all suspended until their batch is evaluated.
+        long long checksum {0};
+        auto start = std::chrono::steady_clock::now();
+        for ( const std::string & l : lines ) await_one( l, checksum );
+        bares::flush_async();
+        std::chrono::duration< double, std::nano > elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << std::left << std::setw( 10 ) << "async" << std::right << std::fixed << std::setprecision( 1 )
+                  << std::setw( 10 ) << elapsed.count() / static_cast< double >( lines.size() ) << " ns/eval"
+                  << "   (checksum " << checksum << ", " << BatchEvaluator::local().batches() << " batches)\n";
+    }
+    measure( "bytecode", programs.size(), reps, [&]( std::size_t i ) { return programs[i].run(); } );
+    measure( "jit", jits.size(), reps, [&]( std::size_t i ) { return jits[i]->run(); } );
+
+    // The same programs in a bundle: opening it (and checking it) is all a startup would pay.
+    ProgramBundle::Writer writer;
+    for ( const Program & p : programs ) writer.add( p );
+    std::string image;
+    writer.append_to( image );
+    auto open_start = std::chrono::steady_clock::now();
+    ProgramBundle bundle { image.data(), image.size() };
+    std::chrono::duration< double, std::milli > open_time = std::chrono::steady_clock::now() - open_start;
+    measure( "bundle", bundle.size(), reps, [&]( std::size_t i ) { return bundle.run( i ); } );
+    std::cout << "bundle: " << image.size() << " bytes, opened and checked in " << std::fixed << std::setprecision( 2 )
+              << open_time.count() << " ms.\n";
+    measure( "ast", trees.size(), reps, [&]( std::size_t i ) { return trees[i]->evaluate(); } );
+
+    // What the trees cost in memory, and what sharing equal subexpressions saved.
+    std::size_t terms {0}, nodes {0}, bytes {0};
+    for ( const auto & tree : trees ) {
+        terms += tree->terms();
+        nodes += tree->size();
+        bytes += tree->memory();
+    }
+    std::cout << "ast: " << nodes << " nodes for " << terms << " terms, " << bytes << " bytes ("
+              << std::setprecision( 1 ) << static_cast< double >( bytes ) / static_cast< double >( nodes )
+              << " per node, " << sizeof( Ast::Node ) << " in the arena).\n";
+
+    // One long expression, edited a digit at a time as if it were typed.
+    std::string joined;
+    for ( const std::string & l : lines ) {
+        if ( bm.evaluate( l ).status.type != Parser::ResultType::OK ) continue; // No division by zero to fall back on.
+        if ( not joined.empty() ) joined += " + ";
+        joined += '(' + l + ')';
+    }
+    std::vector< std::size_t > digits;
+    for ( std::size_t i {0}; i < joined.size(); i++ )
+        if ( joined[i] >= '1' and joined[i] <= '9' ) digits.push_back( i );
+    if ( digits.empty() ) return EXIT_SUCCESS;
+    IncrementalEvaluator inc;
+    inc.set( joined );
+    const std::size_t edits { std::min< std::size_t >( digits.size(), 1000 * reps ) };
+    std::size_t reparsed {0};
+    auto edit_start = std::chrono::steady_clock::now();
+    for ( std::size_t e {0}; e < edits; e++ ) {
+        const std::size_t at { digits[e * digits.size() / edits] };
+        const char digit { static_cast< char >( '1' + ( joined[at] - '0' ) % 9 ) };
+        joined[at] = digit;
+        inc.edit( at, 1, std::string_view{ &digit, 1 } );
+        reparsed += inc.reparsed();
+    }
+    std::chrono::duration< double, std::micro > edit_time = std::chrono::steady_clock::now() - edit_start;
+    auto full_start = std::chrono::steady_clock::now();
+    bm.evaluate( joined );
+    std::chrono::duration< double, std::micro > full_time = std::chrono::steady_clock::now() - full_start;
+    std::cout << "incremental: " << joined.size() << " characters, " << std::setprecision( 2 )
+              << edit_time.count() / static_cast< double >( edits ) << " us per edit of a digit, "
+              << static_cast< double >( reparsed ) / static_cast< double >( edits ) << " groups parsed each ("
+              << full_time.count() << " us to evaluate it whole).\n";
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,238 @@
+/**
+ * @file load.cpp
+ * @brief Measures the throughput and the latency of a running `bares --serve`.
+ *
+ * Usage: bares_load <socket> [corpus] [clients] [window] [seconds]
+ *
+ * Each client is a thread with a connection of its own. It sends `window`
+ * requests (the lines of the corpus, the standard input if no file is given,
+ * in turn) without waiting, then reads their responses, and starts over until
+ * the time is up. Every response is checked against a local evaluation. The
+ * latency a client sees goes from sending a window to getting each response.
+ */
+
+#include <algorithm>    // std::min, std::max
+#include <cerrno>       // errno
+#include <chrono>       // std::chrono::steady_clock
+#include <cstring>      // std::memcpy, std::strerror
+#include <fstream>      // std::ifstream
+#include <functional>   // std::cref, std::ref
+#include <iomanip>      // std::setprecision
+#include <iostream>     // std::cout
+#include <stdexcept>    // std::runtime_error
+#include <string>       // std::string, std::getline
+#include <string_view>  // std::string_view
+#include <thread>       // std::thread
+#include <vector>       // std::vector
+#include <sys/socket.h> // socket(), connect(), recv(), send()
+#include <sys/un.h>     // sockaddr_un
+#include <unistd.h>     // close()
+
+#include "../include/bares_manager.h"
+#include "../include/latency.h"
+#include "../include/wire.h"
+
+namespace {
+    using clock_type = std::chrono::steady_clock;
+
+    /// Nanoseconds of a monotonic clock.
+    std::uint64_t now_ns( void ) {
+        return static_cast< std::uint64_t >( std::chrono::duration_cast< std::chrono::nanoseconds >(
+            clock_type::now().time_since_epoch() ).count() );
+    }
+
+    /// Reports a system call that failed.
+    [[noreturn]] void fail( const char * what, int err ) {
+        throw std::runtime_error( std::string{ what } + ": " + std::strerror( err ) );
+    }
+
+    /// A blocking connection to the server.
+    class Connection {
+        public:
+            /// Connects to the socket of a server.
+            explicit Connection( const std::string & path ) {
+                sockaddr_un addr {};
+                addr.sun_family = AF_UNIX;
+                if ( path.size() >= sizeof( addr.sun_path ) ) throw std::runtime_error( "The path of the socket is too long." );
+                std::memcpy( addr.sun_path, path.data(), path.size() );
+                m_fd = socket( AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0 );
+                if ( m_fd < 0 ) fail( "socket", errno );
+                if ( connect( m_fd, reinterpret_cast< sockaddr * >( &addr ), sizeof( addr ) ) != 0 ) {
+                    const int err { errno };
+                    close( m_fd );
+                    fail( path.c_str(), err );
+                }
+            }
+            /// Closes the connection.
+            ~Connection() { close( m_fd ); }
+            /// Turn off copy constructor.
+            Connection( const Connection & ) = delete;
+            /// Turn off assignment operator.
+            Connection & operator=( const Connection & ) = delete;
+
+            /// Sends all the bytes.
+            void send_all( const std::string & bytes ) {
+                for ( std::size_t done {0}; done < bytes.size(); ) {
+                    const ssize_t w = send( m_fd, bytes.data() + done, bytes.size() - done, MSG_NOSIGNAL );
+                    if ( w < 0 and errno == EINTR ) continue;
+                    if ( w < 0 ) fail( "send", errno );
+                    done += static_cast< std::size_t >( w );
+                }
+            }
+
+            /// Takes the next `n` bytes that came, waiting for them; they stay valid until the next call.
+            const char * take( std::size_t n ) {
+                if ( m_end - m_pos < n ) {
+                    m_buffer.erase( 0, m_pos );
+                    m_end -= m_pos;
+                    m_pos = 0;
+                    if ( m_buffer.size() < std::max< std::size_t >( n, 1u << 16 ) ) m_buffer.resize( std::max< std::size_t >( n, 1u << 16 ) );
+                    while ( m_end < n ) {
+                        const ssize_t r = recv( m_fd, m_buffer.data() + m_end, m_buffer.size() - m_end, 0 );
+                        if ( r < 0 and errno == EINTR ) continue;
+                        if ( r < 0 ) fail( "recv", errno );
+                        if ( r == 0 ) throw std::runtime_error( "The server closed the connection." );
+                        m_end += static_cast< std::size_t >( r );
+                    }
+                }
+                const char * p { m_buffer.data() + m_pos };
+                m_pos += n;
+                return p;
+            }
+
+            /// Takes the next response, and gives what follows its length.
+            std::string_view response( void ) {
+                const std::size_t n { static_cast< std::size_t >( wire::get< 4 >( take( wire::LENGTH_SIZE ) ) ) };
+                return std::string_view{ take( n ), n };
+            }
+
+        private:
+            int m_fd;             //!< The socket.
+            std::string m_buffer; //!< What was received.
+            std::size_t m_pos {0}; //!< Where the bytes not taken yet start.
+            std::size_t m_end {0}; //!< Where they end.
+    };
+
+    /// What a client did.
+    struct Client {
+        LatencyHistogram latency;     //!< From sending a window to getting each response.
+        std::uint64_t requests {0};   //!< Responses received.
+        std::uint64_t mismatches {0}; //!< Responses that differ from the local evaluation.
+        std::string error;            //!< Why it stopped early, if it did.
+    };
+
+    /// Tells whether two results carry the same code, column and value.
+    bool same_result( const BaresManager::Result & a, const BaresManager::Result & b ) {
+        return a.status.type == b.status.type and a.value == b.value
+               and ( not BaresManager::has_column( a.status.type ) or a.status.at_col == b.status.at_col );
+    }
+
+    /// Sends windows of requests until the time is up.
+    void drive( const std::string & path, const std::vector< std::string > & lines,
+                const std::vector< BaresManager::Result > & expected, std::size_t first, std::size_t window,
+                clock_type::time_point until, Client & self ) {
+        try {
+            Connection conn { path };
+            std::string out;
+            std::vector< std::size_t > sent( window );
+            std::size_t next { first };
+            while ( clock_type::now() < until ) {
+                out.clear();
+                for ( std::size_t k {0}; k < window; k++ ) {
+                    sent[k] = next;
+                    wire::append_request( lines[next], out );
+                    next = next + 1 == lines.size() ? 0 : next + 1;
+                }
+                const std::uint64_t start { now_ns() };
+                conn.send_all( out );
+                for ( std::size_t k {0}; k < window; k++ ) {
+                    std::string_view r = conn.response();
+                    if ( r.size() != wire::RESULT_SIZE ) throw std::runtime_error( "A response is not a result." );
+                    self.latency.add( now_ns() - start );
+                    if ( not same_result( wire::read_result( r.data() ), expected[sent[k]] ) ) self.mismatches++;
+                }
+                self.requests += window;
+            }
+        }
+        catch ( const std::exception & e ) {
+            self.error = e.what();
+        }
+    }
+}
+
+int main( int argc, char * argv[] ) {
+    if ( argc < 2 ) {
+        std::cerr << "Usage: " << argv[0] << " <socket> [corpus] [clients] [window] [seconds]\n";
+        return EXIT_FAILURE;
+    }
+    const std::string path { argv[1] };
+    std::ifstream file;
+    if ( argc > 2 ) {
+        file.open( argv[2] );
+        if ( not file ) {
+            std::cerr << "Cannot open \"" << argv[2] << "\".\n";
+            return EXIT_FAILURE;
+        }
+    }
+    std::istream & in = argc > 2 ? file : std::cin;
+    const std::size_t n_clients = argc > 3 ? std::max< std::size_t >( std::stoul( argv[3] ), 1 ) : 4;
+    const std::size_t window = argc > 4 ? std::min< std::size_t >( std::max< std::size_t >( std::stoul( argv[4] ), 1 ), 1u << 16 ) : 64;
+    const double seconds = argc > 5 ? std::stod( argv[5] ) : 5.0;
+
+    // Every response is checked against the reference evaluation.
+    BaresManager bm;
+    std::vector< std::string > lines;
+    std::vector< BaresManager::Result > expected;
+    std::string line;
+    while ( std::getline( in, line ) ) {
+        if ( line.size() > wire::MAX_REQUEST ) continue;
+        expected.push_back( bm.evaluate( line ) );
+        lines.push_back( line );
+    }
+    if ( lines.empty() ) {
+        std::cerr << "The corpus is empty.\n";
+        return EXIT_FAILURE;
+    }
+
+    std::vector< Client > clients( n_clients );
+    std::vector< std::thread > threads;
+    const auto start = clock_type::now();
+    const auto until = start + std::chrono::duration_cast< clock_type::duration >( std::chrono::duration< double >( seconds ) );
+    for ( std::size_t i {0}; i < n_clients; i++ )
+        threads.emplace_back( drive, std::cref( path ), std::cref( lines ), std::cref( expected ),
+                              lines.size() * i / n_clients, window, until, std::ref( clients[i] ) );
+    for ( auto & t : threads ) t.join();
+    std::chrono::duration< double > elapsed = clock_type::now() - start;
+
+    LatencyHistogram latency;
+    std::uint64_t requests {0}, mismatches {0};
+    for ( const Client & c : clients ) {
+        if ( not c.error.empty() ) {
+            std::cerr << "A client stopped: " << c.error << '\n';
+            return EXIT_FAILURE;
+        }
+        latency.merge( c.latency );
+        requests += c.requests;
+        mismatches += c.mismatches;
+    }
+    std::cout << n_clients << " clients, window " << window << ", " << std::fixed << std::setprecision( 1 )
+              << elapsed.count() << " s: " << requests << " requests, " << std::setprecision( 0 )
+              << static_cast< double >( requests ) / elapsed.count() << " per second, " << mismatches << " mismatches.\n";
+    std::string text;
+    latency.append_summary( text );
+    std::cout << "client: " << text;
+
+    // What the server measured, from the round that read each request to its response.
+    try {
+        Connection conn { path };
+        std::string request;
+        wire::put< 4 >( wire::STATS, request );
+        conn.send_all( request );
+        std::cout << "server: " << conn.response();
+    }
+    catch ( const std::exception & e ) {
+        std::cerr << e.what() << '\n';
+        return EXIT_FAILURE;
+    }
+    return mismatches == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}